@@ -67,8 +67,31 @@ void createLogger(int level, std::string filename)
 	Logger::instance("spikeyhal.python.toLog_deprecated", level, filename, true);
 }
 
+#ifndef WITHOUT_HARDWARE
+//! homogeneous Poisson stimulus appended to a spike train, see StimulusGenerator::poisson
+void stimulusPoisson(StimulusGenerator& g, const std::vector<int>& addr,
+                     const std::vector<double>& rate, uint start, uint duration, PySpikeTrain& st,
+                     double refractory)
+{
+	g.poisson(std::vector<uint>(addr.begin(), addr.end()), rate, start, duration, st, refractory);
+}
+
+//! rate-modulated Poisson stimulus appended to a spike train, see
+//! StimulusGenerator::inhomogeneous
+void stimulusInhomogeneous(StimulusGenerator& g, const std::vector<int>& addr,
+                           const std::vector<std::vector<double>>& rate, uint start, uint binwidth,
+                           PySpikeTrain& st, double refractory)
+{
+	g.inhomogeneous(std::vector<uint>(addr.begin(), addr.end()), rate, start, binwidth, st,
+	                refractory);
+}
+#endif // WITHOUT_HARDWARE
+
 // default argument handling
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(pyspikey_overloads_autocalib, autocalib, 0, 2)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(expstats_overloads_tojson, toJson, 0, 1)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(pyspikey_overloads_quiesce, quiesce, 0, 1)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(pyspikey_overloads_calibrateTiming, calibrateTiming, 0, 3)
 
 // python-module supported by BOOST library
 BOOST_PYTHON_MODULE(pyhal_c_interface_s1v2)
@@ -123,9 +146,18 @@ BOOST_PYTHON_MODULE(pyhal_c_interface_s1v2)
 	    .def(vector_indexing_suite<std::vector<std::vector<double>>>());
 	
 #ifndef WITHOUT_HARDWARE
+	//! python access to the stimulus generator, seed and time unit (seconds) as arguments
+	class_<StimulusGenerator>("StimulusGenerator", init<uint64_t, double>())
+	    .def("poisson", &stimulusPoisson)
+	    .def("inhomogeneous", &stimulusInhomogeneous)
+	    .add_property("seed", &StimulusGenerator::getSeed, &StimulusGenerator::setSeed)
+	    .add_property("timeunit", &StimulusGenerator::getTimeunit,
+	                  &StimulusGenerator::setTimeunit);
+
 	//! python access to spike trains
 	class_<PySpikeTrain>("SpikeTrain")
 	    .add_property("data", &PySpikeTrain::get, &PySpikeTrain::set)
+	    .def("merge", &PySpikeTrain::merge)
 	    .def("writeToFile", &PySpikeTrain::writeToFile)
 	    .def("readFromFile", &PySpikeTrain::readFromFile);
 
@@ -190,12 +222,80 @@ BOOST_PYTHON_MODULE(pyhal_c_interface_s1v2)
 	    .def("intClear", &PySC_Mem::intClear)
 	    .def("minTimebin", &PySC_Mem::minTimebin)
 	    .def("stime", &PySC_Mem::stime)
-	    .def("getWorkStationName", &PySC_Mem::getWorkStationName);
+	    .def("getWorkStationName", &PySC_Mem::getWorkStationName)
+	    .def("getStats", &PySC_Mem::getStats)
+	    .def("resetStats", &PySC_Mem::resetStats)
+	    .def("setStatsLog", &PySC_Mem::setStatsLog)
+	    .def("setPredictIdle", &PySC_Mem::setPredictIdle)
+	    .def("setReorderWindow", &PySC_Mem::setReorderWindow)
+	    .def("getReorderWindow", &PySC_Mem::getReorderWindow)
+	    .def("startTelemetry", &PySC_Mem::startTelemetry)
+	    .def("stopTelemetry", &PySC_Mem::stopTelemetry)
+	    .def("telemetry", &PySC_Mem::telemetry);
+
+	//! python access to per experiment timing and counters
+	class_<ExpStats>("ExpStats")
+	    .def("seconds", &ExpStats::stageSeconds)
+	    .def("total", &ExpStats::total)
+	    .def("toJson", &ExpStats::toJson, expstats_overloads_tojson(args("station")))
+	    .def_readonly("evencoded", &ExpStats::evencoded)
+	    .def_readonly("evdropped", &ExpStats::evdropped)
+	    .def_readonly("evshifted", &ExpStats::evshifted)
+	    .def_readonly("pbwords", &ExpStats::pbwords)
+	    .def_readonly("usbbytes", &ExpStats::usbbytes)
+	    .def_readonly("polls", &ExpStats::polls)
+	    .def_readonly("recwords", &ExpStats::recwords)
+	    .def_readonly("evdecoded", &ExpStats::evdecoded)
+	    .def_readonly("evambiguous", &ExpStats::evambiguous)
+	    .def_readonly("evlate", &ExpStats::evlate)
+	    .def_readonly("wakeups", &ExpStats::wakeups)
+	    .def_readonly("prederr", &ExpStats::prederr)
+	    .def_readonly("restarts", &ExpStats::restarts)
+	    .def_readonly("gap", &ExpStats::gap)
+	    .def_readonly("gapmax", &ExpStats::gapmax)
+	    .def_readonly("reactmax", &ExpStats::reactmax);
+	enum_<ExpStats::Stage>("ExpStage")
+	    .value("encode", ExpStats::encode)
+	    .value("flush", ExpStats::flush)
+	    .value("run", ExpStats::run)
+	    .value("wait", ExpStats::wait)
+	    .value("receive", ExpStats::receive);
+
+	//! python access to the link capacity analysis of spike trains
+	class_<LinkReport>("LinkReport")
+	    .def_readonly("events", &LinkReport::events)
+	    .def_readonly("dropped", &LinkReport::dropped)
+	    .def_readonly("shifted", &LinkReport::shifted)
+	    .def_readonly("commands", &LinkReport::commands)
+	    .def_readonly("words", &LinkReport::words)
+	    .def_readonly("duration", &LinkReport::duration)
+	    .def_readonly("maxpending", &LinkReport::maxpending)
+	    .def_readonly("maxpendingbuf", &LinkReport::maxpendingbuf)
+	    .def_readonly("end", &LinkReport::end)
+	    .def_readonly("minend", &LinkReport::minend);
+
+	class_<CITiming>("CITiming")
+	    .def_readonly("revision", &CITiming::revision)
+	    .def_readonly("clockper", &CITiming::clockper)
+	    .def_readwrite("synram", &CITiming::synram)
+	    .def_readwrite("synramnext", &CITiming::synramnext)
+	    .def_readwrite("synread", &CITiming::synread)
+	    .def_readwrite("pram", &CITiming::pram)
+	    .def_readwrite("ar", &CITiming::ar)
+	    .def_readwrite("chain", &CITiming::chain);
 
 	//! python access to spikey class
 	class_<PySpikey>("Spikey", init<boost::shared_ptr<PySC_Mem>, float, uint, uint, std::string>())
+	    .def(init<boost::shared_ptr<PySC_Mem>, float, uint, uint, std::string, std::string>())
+	    .def("warmAttached", &PySpikey::warmAttached)
+	    .def("invalidateState", &PySpikey::invalidateState)
 	    .def("config", &PySpikey::config)
 	    .def("interruptActivity", &PySpikey::interruptActivity)
+	    .def("quiesce", &PySpikey::quiesce, pyspikey_overloads_quiesce(args("wait")))
+	    .def("getTiming", &PySpikey::getTiming, return_value_policy<copy_const_reference>())
+	    .def("setTiming", &PySpikey::setTiming)
+	    .def("calibrateTiming", &PySpikey::calibrateTiming,
+	         pyspikey_overloads_calibrateTiming(args("file", "margin", "repeat")))
 	    .def("getTemp", &PySpikey::getTemp)
 	    .def("autocalib", &PySpikey::autocalib,
 	         pyspikey_overloads_autocalib(args("cfg"), "vout autocalib"))
@@ -205,6 +305,9 @@ BOOST_PYTHON_MODULE(pyhal_c_interface_s1v2)
 	    .def("calibParam", &PySpikey::calibParam)
 	    .def("clearPlaybackMem", &PySpikey::clearPlaybackMem)
 	    .def("sendSpikeTrain", &PySpikey::sendSpikeTrain)
+	    .def("analyzeSpikeTrain", &PySpikey::analyzeSpikeTrain)
+	    .def("enableSpikeIndex", &PySpikey::enableSpikeIndex)
+	    .def("spikeIndex", &PySpikey::spikeIndex)
 	    .def("Run", &PySpikey::Run)
 	    .def("waitPbFinished", &PySpikey::waitPbFinished)
 	    .def("resendSpikeTrain", &PySpikey::resendSpikeTrain)
@@ -4,6 +4,9 @@
 #include "spikey2_lowlevel_includes.h"
 #include "pysc_mem.h"
 
+#define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
+#include <numpy/arrayobject.h>
+
 // shortcut namespace
 using namespace spikey2;
 
@@ -35,3 +38,75 @@ std::string PySC_Mem::getWorkStationName()
 {
 	return SC_Mem::getWorkStationName();
 }
+
+ExpStats PySC_Mem::getStats()
+{
+	return SC_Mem::getStats();
+}
+
+void PySC_Mem::resetStats()
+{
+	SC_Mem::resetStats();
+}
+
+void PySC_Mem::setStatsLog(std::string filename)
+{
+	SC_Mem::setStatsLog(filename);
+}
+
+void PySC_Mem::setPredictIdle(bool on)
+{
+	SC_Mem::setPredictIdle(on);
+}
+
+void PySC_Mem::setReorderWindow(uint n)
+{
+	SC_Mem::setReorderWindow(n);
+}
+
+uint PySC_Mem::getReorderWindow()
+{
+	return SC_Mem::getReorderWindow();
+}
+
+void PySC_Mem::startTelemetry(uint periodms, std::vector<int> channels)
+{
+	getSCTRL()->startTelemetry(periodms, vector<uint>(channels.begin(), channels.end()));
+}
+
+void PySC_Mem::stopTelemetry()
+{
+	getSCTRL()->stopTelemetry();
+}
+
+boost::python::dict PySC_Mem::telemetry()
+{
+	using namespace boost::python;
+
+	vector<TelemetrySample> h = getSCTRL()->telemetryHistory();
+	npy_intp n = h.size();
+	npy_intp channels = n ? h[0].adc.size() : 0;
+	npy_intp dims[] = {n, channels};
+	object time(handle<>(PyArray_SimpleNew(1, dims, NPY_DOUBLE)));
+	object temperature(handle<>(PyArray_SimpleNew(1, dims, NPY_FLOAT)));
+	object supply(handle<>(PyArray_SimpleNew(1, dims, NPY_FLOAT)));
+	object adc(handle<>(PyArray_SimpleNew(2, dims, NPY_FLOAT)));
+	double* t = static_cast<double*>(PyArray_DATA((PyArrayObject*)time.ptr()));
+	float* temp = static_cast<float*>(PyArray_DATA((PyArrayObject*)temperature.ptr()));
+	float* sup = static_cast<float*>(PyArray_DATA((PyArrayObject*)supply.ptr()));
+	float* a = static_cast<float*>(PyArray_DATA((PyArrayObject*)adc.ptr()));
+	for (npy_intp i = 0; i < n; ++i) {
+		t[i] = h[i].time;
+		temp[i] = h[i].temperature;
+		sup[i] = h[i].supply;
+		for (npy_intp c = 0; c < channels; ++c)
+			*a++ = h[i].adc[c];
+	}
+
+	dict d;
+	d["time"] = time;
+	d["temperature"] = temperature;
+	d["supply"] = supply;
+	d["adc"] = adc;
+	return d;
+}
@@ -15,4 +15,16 @@ public:
 	int minTimebin();
 	int stime();
 	std::string getWorkStationName();
+	ExpStats getStats();
+	void resetStats();
+	void setStatsLog(std::string filename);
+	void setPredictIdle(bool on);
+	void setReorderWindow(uint n);
+	uint getReorderWindow();
+	//! samples temperature, supply voltage and the slow ADC channels in the background
+	void startTelemetry(uint periodms, std::vector<int> channels);
+	void stopTelemetry();
+	//! recorded telemetry as dict of numpy arrays: time, temperature, supply, adc (samples x
+	//! channels)
+	boost::python::dict telemetry();
 };
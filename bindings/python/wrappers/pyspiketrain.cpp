@@ -4,6 +4,7 @@
 #include "common.h"
 #include "idata.h"
 #include "spikeyconfig.h"
+#include "stimulus.h"
 
 #include "pyspiketrain.h"
 
@@ -80,6 +81,25 @@ void PySpikeTrain::set(vector<vector<int>>& vec)
 }
 
 
+void PySpikeTrain::merge(boost::python::list trains)
+{
+	// same bin masking as set(), the events are read in place
+	uint n = boost::python::len(trains);
+	vector<const IData*> begin(n), end(n);
+	for (uint i = 0; i < n; ++i) {
+		const vector<IData>& d = boost::python::extract<PySpikeTrain&>(trains[i])().d;
+		begin[i] = d.data();
+		end[i] = begin[i] + d.size();
+	}
+	try {
+		SpikeMerger(512, true).merge(begin, end, *this);
+	} catch (std::runtime_error& e) {
+		PyErr_SetString(PyExc_ValueError, e.what());
+		boost::python::throw_error_already_set();
+	}
+}
+
+
 bool PySpikeTrain::writeToFile(string filename)
 {
 	return SpikeTrain::writeToFile(filename);
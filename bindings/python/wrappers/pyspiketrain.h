@@ -16,6 +16,8 @@ public:
 	boost::python::object get(void);
 	//! fill data with 2-d array
 	void set(std::vector<std::vector<int>>& arr);
+	//! replace data by the time-sorted merge of a list of spike trains, e.g. one per source
+	void merge(boost::python::list trains);
 
 	bool writeToFile(string filename);
 	bool readFromFile(string filename);
@@ -19,14 +19,10 @@ using namespace std;
 
 
 PySpikey::PySpikey(boost::shared_ptr<PySC_Mem> comm, float clockper, uint chipid, uint spikeyNr,
-                   string calibfile)
-    : SpikeyCalibratable(comm, clockper, chipid, spikeyNr, calibfile), _lastRunWasSTDP(false)
+                   string calibfile, string statefile)
+    : SpikeyCalibratable(comm, statefile, clockper, chipid, spikeyNr, calibfile),
+      _lastRunWasSTDP(false)
 {
-	// this weight array contains just zeros and is used to temporarily set all synaptic weights to
-	// zero
-	zero_weight_array.resize(
-	    SpikeyConfig::num_blocks * SpikeyConfig::num_neurons * SpikeyConfig::num_presyns, 0);
-
 	_correlationInformation.resize(256);
 	_synapseWeights.resize(256);
 	_synapseWeightsOld.resize(256);
@@ -87,6 +83,50 @@ void PySpikey::recSpikeTrain(PySpikeTrain& st)
 		SpikeyCalibratable::recSpikeTrain(st, false);
 }
 
+void PySpikey::enableSpikeIndex(bool on, uint numneurons, uint isibins, uint isibinwidth)
+{
+	if (on)
+		setSpikeIndex(
+		    boost::shared_ptr<SpikeIndex>(new SpikeIndex(numneurons, isibins, isibinwidth)));
+	else
+		setSpikeIndex(boost::shared_ptr<SpikeIndex>());
+}
+
+// copies v into a new numpy array of shape (rows, v.size() / rows)
+static boost::python::object toNumpy(const vector<uint>& v, npy_intp rows = 0)
+{
+	using namespace boost::python;
+	int num_dims = rows ? 2 : 1;
+	npy_intp dims[] = {rows ? rows : static_cast<npy_intp>(v.size()),
+	                   rows ? static_cast<npy_intp>(v.size() / rows) : 0};
+	object a(handle<>(PyArray_SimpleNew(num_dims, dims, NPY_UINT)));
+	std::copy(v.begin(), v.end(), static_cast<uint*>(PyArray_DATA((PyArrayObject*)a.ptr())));
+	return a;
+}
+
+boost::python::dict PySpikey::spikeIndex()
+{
+	boost::shared_ptr<SpikeIndex> idx = getSpikeIndex();
+	if (!idx) {
+		PyErr_SetString(PyExc_RuntimeError, "Spike index not enabled, see enableSpikeIndex");
+		boost::python::throw_error_already_set();
+	}
+	boost::python::dict d;
+	d["count"] = toNumpy(idx->count);
+	d["first"] = toNumpy(idx->first);
+	d["last"] = toNumpy(idx->last);
+	d["isi"] = toNumpy(idx->isi, idx->numNeurons());
+	d["offset"] = toNumpy(idx->offset);
+	d["times"] = toNumpy(idx->times);
+	d["outofrange"] = idx->outofrange;
+	return d;
+}
+
+LinkReport PySpikey::analyzeSpikeTrain(const PySpikeTrain& st, bool dropmod)
+{
+	return SpikeyCalibratable::analyzeSpikeTrain(st, dropmod);
+}
+
 // config spikey depending on valid flags in spikeyconfig
 // order is:
 // dac -> param -> chip -> rowconfig -> colconfig -> synapses
@@ -157,30 +197,12 @@ void PySpikey::config(boost::shared_ptr<PySpikeyConfig> cfg, bool updateChip, bo
 
 void PySpikey::interruptActivity(boost::shared_ptr<PySpikeyConfig> original_cfg)
 {
-	// cout << "Interrupting all possibly remaining spiking activity from previous experiments!" <<
-	// endl;
-	// buffer update flags
-	SpikeyConfig::SCupdate validBuffer = (SpikeyConfig::SCupdate)original_cfg->valid;
-	// buffer synaptic weights
-	valarray<ubyte> weightBuffer = original_cfg->weight;
-
-	// temporarily manipulate update flags
-	original_cfg->valid = (SpikeyConfig::SCupdate)(0 | SpikeyConfig::ud_weight);
-	// temporarily set all weights to zero
-	original_cfg->weight = zero_weight_array;
-
-	// transfer zero-weight array
-	SpikeyCalibratable::config(original_cfg);
-	// wait for 100 us, which - assuming a speedup factor of 10.000 - corresponds to 1 s in
-	// biological time
-	// this is more than any reasonable neural or synaptic time constant, i.e. every activity should
-	// die out
-	usleep(100);
-
-	// re-establish original configuration
-	original_cfg->weight = weightBuffer;
-	SpikeyCalibratable::config(original_cfg);
-	original_cfg->valid = validBuffer;
+	// original_cfg has been written by config, its row configuration is used if Spikey no longer
+	// knows the one on the chip
+	quiesce(10000, original_cfg);
+	Flush();
+	Run();
+	waitPbFinished();
 }
 
 /**
@@ -313,6 +335,9 @@ void PySpikey::checkSynRam(uint maxrows, uint maxcols, uint loops)
 	uint tpcsec = 30 / clockper;
 	uint tdel = 6 + tsense + tpcsec;
 
+	// weights on the chip will differ from the last configuration
+	invalidateState();
+
 	// get the synapse control object
 	boost::shared_ptr<SynapseControl> synapse_control = getSC();
 
@@ -361,6 +386,9 @@ void PySpikey::checkSynRam(uint maxrows, uint maxcols, uint loops)
 
 void PySpikey::processCorrFlags(synapseRect rect)
 {
+	// the LUT updates the weights
+	invalidateState();
+
 	// automatic processing - timing checked (TP, 17.08.2015)
 	synapse_control->proc_corr(rect.rowMin, rect.rowMax, true,
 	                           (timings.tdel + 2 * (timings.tpcorperiod + 4 * 64)) *
@@ -458,9 +486,7 @@ void PySpikey::readWeights(synapseRect rect)
 {
 	for (int row = rect.rowMin; row <= rect.rowMax; row++) {
 		for (int col = (rect.colMin % 64); col <= (rect.colMax % 64); col++) {
-			synapse_control->read_sram(row, col, timings.tsense * 5 * 2);
-			// ECM: this used to be tsense*5, could be minized to 23? (TODO)
-			// tmjs used tdel, but this triggers errors!
+			synapse_control->read_sram(row, col, timing.synread); // see calibrateTiming
 		}
 		synapse_control->close(); // close row
 	}
@@ -540,6 +566,9 @@ void PySpikey::sendSpikeTrainWithSTDP(const PySpikeTrain& st, PySpikeTrain& stou
                                       uint minRow, uint maxRow, uint minCol, uint maxCol,
                                       bool changeWeights, bool verbose)
 {
+	// weights on the chip will differ from the last configuration
+	if (changeWeights)
+		invalidateState();
 
 	// get SlowControl object for state machine reset
 	// boost::shared_ptr<SC_Mem> membus = boost::dynamic_pointer_cast<SC_Mem>(bus);
@@ -665,7 +694,7 @@ void PySpikey::sendSpikeTrainWithSTDP(const PySpikeTrain& st, PySpikeTrain& stou
 	// mute all outputs (after dummy spike) => fixes status data reads/spike race condition
 	for (uint i = 0; i < hw_const->event_outs(); i++)
 		setCCBit(hw_const->cr_eout_rst() + i, true);
-	writeCC(100); // adds additional delay, TODO: this should be "chain delay" (=> smaller than 100)
+	writeCC(timing.chain);
 
 	// TP: see two previous comments by TP
 	// pccont = false; //stop continuous STDP update controller
@@ -794,6 +823,7 @@ void PySpikey::sendSpikeTrainWithSTDP(const PySpikeTrain& st, PySpikeTrain& stou
 		if (et != NULL) {
 			et->d = *(mem->eev(chip())); // copy error events
 			mem->eev(chip())->clear();   // clear error events
+			mem->eshift(chip())->clear();
 		}
 	}
 }
@@ -806,6 +836,9 @@ void PySpikey::benchmarkSTDPDrift()
 	uint tpcsec = 60 / clockper;  //  20ns    |  20ns
 	uint tpcorperiod = 360;       //          | 252ns 2*tdel
 
+	// time register, LUT and weights on the chip will differ from the last configuration
+	invalidateState();
+
 	// get the synapse control object
 	boost::shared_ptr<SynapseControl> synapse_control = getSC();
 
@@ -896,6 +929,7 @@ void PySpikey::benchmarkSTDPDrift()
 		// check if correct subclass used as bus
 		// mem->rcvd(chip())->clear();
 		mem->eev(chip())->clear(); // clear error events
+		mem->eshift(chip())->clear();
 	}
 }
 
@@ -15,8 +15,9 @@ class PySpikey : public SpikeyCalibratable
 {
 
 public:
+	//! statefile: attach to an initialized chip if possible, see Spikey, empty to always initialize
 	PySpikey(boost::shared_ptr<PySC_Mem> comm, float clockper = 10.0, uint chipid = 0,
-	         uint spikeyNr = 0, string calibfile = "spikeycalib.xml");
+	         uint spikeyNr = 0, string calibfile = "spikeycalib.xml", string statefile = "");
 
 	//! playback memory reset
 	void clearPlaybackMem();
@@ -27,6 +28,13 @@ public:
 	//! the last transmitted spiketrain (st.state==invalid) or (st.adr) is sent and the received
 	//data collected in 'st'
 	void recSpikeTrain(PySpikeTrain& st);
+	//! predicts drops, input buffer occupancy and length of sendSpikeTrain(st) without sending it
+	LinkReport analyzeSpikeTrain(const PySpikeTrain& st, bool dropmod);
+	//! recSpikeTrain builds a per-neuron index and statistics of the received spikes if enabled
+	void enableSpikeIndex(bool on, uint numneurons, uint isibins, uint isibinwidth);
+	//! per-neuron index of the last received spike train as dict of numpy arrays: count, first,
+	//! last, isi (neurons x bins), offset and times
+	boost::python::dict spikeIndex();
 	/*! loads values into spikey according to update flags
 	   confdata must be valid until Spikey is destroyed or new reference is passed */
 	void config(boost::shared_ptr<PySpikeyConfig> cfg, bool updateChip, bool updateDAC,
@@ -145,8 +153,7 @@ public:
 	//! returns the revision number of the currently used Spikey chip
 	int revision() { return hw_const->revision(); };
 
-	//! Interrupts possible remaining activity from previous experiments by temporariliy setting all
-	//synaptic weights to zero
+	//! Interrupts possible remaining activity from previous experiments, see Spikey::quiesce
 	void interruptActivity(boost::shared_ptr<PySpikeyConfig> original_cfg);
 
 	//! setup fast USB ADC
@@ -169,7 +176,6 @@ private:
 	std::vector<std::vector<int>> _weightsForPython;
 	std::vector<std::vector<double>> _voltagesForPython;
 	std::vector<double> _ibtestValuesForPython;
-	valarray<ubyte> zero_weight_array;
 
 	/* stdp specific stuff */
 	struct synapseRect {
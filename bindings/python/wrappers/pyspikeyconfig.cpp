@@ -554,7 +554,7 @@ void PySpikeyConfig::clearRowConfig()
 
 vector<int> PySpikeyConfig::weight_wrapper()
 {
-	valarray<ubyte> w = weight;
+	const valarray<ubyte>& w = weight.get();
 	vector<int> result(w.size());
 	// put all the strings inside the python list
 	for (int i = 0; i < w.size(); ++i) {
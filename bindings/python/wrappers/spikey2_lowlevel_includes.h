@@ -16,6 +16,9 @@
 #include XQUOTE(SPIKEYHALPATH/sncomm.h)
 #include XQUOTE(SPIKEYHALPATH/spikenet.h)
 #include XQUOTE(SPIKEYHALPATH/sc_sctrl.h)
+#include XQUOTE(SPIKEYHALPATH/sc_emulator.h)
+#include XQUOTE(SPIKEYHALPATH/sc_chipmodel.h)
+#include XQUOTE(SPIKEYHALPATH/sc_trace.h)
 #include XQUOTE(SPIKEYHALPATH/sc_pbmem.h)
 #include XQUOTE(SPIKEYHALPATH/ctrlif.h)
 #include XQUOTE(SPIKEYHALPATH/synapse_control.h) // synapse control class
@@ -23,6 +26,8 @@
 #include XQUOTE(SPIKEYHALPATH/spikeyconfig.h)
 #include XQUOTE(SPIKEYHALPATH/spikeyvoutcalib.h)
 #include XQUOTE(SPIKEYHALPATH/spikey.h)
+#include XQUOTE(SPIKEYHALPATH/spikeyscheduler.h)
+#include XQUOTE(SPIKEYHALPATH/stimulus.h)
 #include XQUOTE(SPIKEYHALPATH/spikeycalibratable.h)
 
 
@@ -1,5 +1,7 @@
 #include "common.h"
 
+#include <chrono>
+
 ostream& binout(ostream& in, uint64_t u, uint max)
 {
 	for (int i = max - 1; i >= 0; --i)
@@ -26,3 +28,9 @@ int number_set_bits(uint value)
 	}
 	return counter;
 }
+
+double monotonicTime()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch())
+	    .count();
+}
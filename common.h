@@ -61,6 +61,9 @@ void bin_bits(uint number_int, std::vector<uint>& err_bits);
 //! Count number of ones in binary representation.
 int number_set_bits(uint number_int);
 
+//! Monotonic time in seconds since an arbitrary start, for measuring intervals.
+double monotonicTime();
+
 // helper function that generates a binary mask from an msb bit definition
 inline uint64_t makemask(uint msb)
 {
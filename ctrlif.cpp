@@ -12,19 +12,16 @@ static log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("HAL.Ifc");
 
 using namespace spikey2;
 
-void data_block::retrieve(void)
+uint64_t CIReply::get()
 {
-	if (!in_memory) {
-		if (prev != NULL) {
-			LOG4CXX_DEBUG(logger,
-			              "data_block::retrieve: Trying to retrieve previous data_block in list.");
-			prev->retrieve();
-		}
-		for (uint i = 0; i < size; i++) {
-		}
-	} else {
-		LOG4CXX_DEBUG(logger, "data_block::retrieve: Data already in memory. Doing nothing.");
+	Spikenet* sp = ci->getSp();
+	if (!done && sp->bus->waitReply(*this, sp->chip()) != SpikenetComm::ok) {
+		string msg = "CIReply::get: answer of read " + to_str(seq) + " not received";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
 	}
+	ci->checkAnswer(answer);
+	return answer.data();
 }
 
 void ControlInterface::flush()
@@ -62,31 +59,38 @@ SpikenetComm::Commstate ControlInterface::rcv_data(uint64_t& data)
 		string msg = "ControlInterface::rcv_data: !ok result from Receive!";
 		dbg(Logger::ERROR) << msg << Logger::flush;
 		throw std::runtime_error(msg);
-	} else {
-		// check if correct data is in queue
-		if ((d.cmd() & (0xf ^ sp->hw_const->ci_errori())) != get_cicmd()) {
-			string msg = "ControlInterface::rcv_data: Invalid CI command type!";
-			dbg(Logger::ERROR) << msg << " Expected: 0x" << hex << get_cicmd() << " - Got: 0x"
-			                   << (d.cmd() & (0xf ^ sp->hw_const->ci_errori())) << Logger::flush;
-			result = SpikenetComm::readfailed;
-			throw std::runtime_error(msg);
-		}
-
-		// check for command error flag (i.e. Spikey was still busy when receiving the command)
-		if (d.cmd() & sp->hw_const->ci_errori()) {
-			string msg = "ControlInterface::rcv_data: Error flag set!";
-			dbg(Logger::ERROR) << msg << " Command was 0x" << hex
-			                   << (d.cmd() & (0xf ^ sp->hw_const->ci_errori())) << Logger::flush;
-			result = SpikenetComm::readfailed;
-			throw std::runtime_error(msg);
-		}
 	}
+	checkAnswer(d);
 
 	LOG4CXX_TRACE(logger, "ControlInterface::rcv_data: data (hex): " << hex << d.data());
 	data = d.data(); // copy back read data
 	return result;
 }
 
+void ControlInterface::checkAnswer(const IData& d)
+{
+	// check if correct data is in queue
+	if ((d.cmd() & (0xf ^ sp->hw_const->ci_errori())) != get_cicmd()) {
+		string msg = "ControlInterface::rcv_data: Invalid CI command type!";
+		dbg(Logger::ERROR) << msg << " Expected: 0x" << hex << get_cicmd() << " - Got: 0x"
+		                   << (d.cmd() & (0xf ^ sp->hw_const->ci_errori())) << Logger::flush;
+		throw std::runtime_error(msg);
+	}
+
+	// check for command error flag (i.e. Spikey was still busy when receiving the command)
+	if (d.cmd() & sp->hw_const->ci_errori()) {
+		string msg = "ControlInterface::rcv_data: Error flag set!";
+		dbg(Logger::ERROR) << msg << " Command was 0x" << hex
+		                   << (d.cmd() & (0xf ^ sp->hw_const->ci_errori())) << Logger::flush;
+		throw std::runtime_error(msg);
+	}
+}
+
+CIFuture ControlInterface::reply()
+{
+	return sp->bus->expectReply(this);
+}
+
 bool ControlInterface::check(uint64_t data, uint64_t mask, uint64_t val)
 {
 	if (rcv_data(data) != SpikenetComm::ok)
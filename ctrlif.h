@@ -6,48 +6,34 @@ namespace spikey2
 
 class Spikenet; // forward declaration
 
-class data_block
-{
-private:
-	data_block* prev;
-	data_block* next;         //!< pointers to other data_blocks in list
-	vector<uint64_t> payload; //!< contains data read from Spikey
-	bool in_memory;           //!< payload contains valid data?
-	uint startoffs;           //!< "global" offset relative to the currently built pbmem program
-	uint size;                //!< size of this block
+class ControlInterface;
 
-protected:
-	::Logger& dbg;
+//! Answer of a control interface read, see ControlInterface::reply. The bus routes each answer to
+//! its reply by the sequence number of the read, so replies can be consumed in any order and
+//! independent of reads via ControlInterface::rcv_data.
+class CIReply
+{
+	friend class SC_Mem;
 
 public:
-	data_block(data_block* prev) : prev(prev), dbg(::Logger::instance())
-	{
-		if (dynamic_cast<data_block*>(prev)) {
-			prev->set_next(this);
-			startoffs = prev->get_soff() + prev->get_size();
-		} else {
-			startoffs = 0;
-		}
-		size = 0;
-		in_memory = false;
-		payload.clear();
-	};
+	CIReply(ControlInterface* ci, uint seq) : ci(ci), seq(seq), done(false){};
 
-	void set_prev(data_block* p) { prev = p; };
-	void set_next(data_block* n) { next = n; };
+	//! answer already decoded
+	bool ready() const { return done; };
+	//! sequence number of the read within the playback memory program
+	uint sequence() const { return seq; };
+	//! returns the answer, decoding the received data up to it if necessary. Throws if it is not
+	//! received or has the error flag set, like ControlInterface::rcv_data.
+	uint64_t get();
 
-	data_block* get_prev(void) { return prev; };
-	data_block* get_next(void) { return next; };
-
-	uint get_soff(void) { return startoffs; };
-	uint get_size(void) { return size; };
-
-	void add(void) { payload.push_back(static_cast<uint64_t>(0)); };
-
-	void retrieve(void);
-	uint64_t get(uint index);
+private:
+	ControlInterface* ci;
+	uint seq;
+	bool done;
+	IData answer;
+};
 
-}; // end class data_block
+typedef boost::shared_ptr<CIReply> CIFuture;
 
 // abstract base class for all control interfaces in spikenet
 class ControlInterface
@@ -71,6 +57,11 @@ public:
 	void read_cmd(uint64_t, uint del); // issue read command to testbench
 	SpikenetComm::Commstate rcv_idata(IData**); // check for received data
 	SpikenetComm::Commstate rcv_data(uint64_t&); // check for received data
+	//! returns a handle to the answer of the read command just issued via this interface, to be
+	//! received independent of the order of other reads
+	CIFuture reply();
+	//! throws if d is not a valid answer for this interface
+	void checkAnswer(const IData& d);
 	void flush(void); // clear send buffers
 
 	// type of control interface
@@ -716,6 +716,15 @@ public:
 
 	virtual uint fifo_reset_delay() const = 0; //  clock cycles to wait until FIFOs are reset
 	                                           //  (because analog reset, not aligned to clock)
+
+	// control interface timing model, see CITiming::model: each delay consists of clock cycles of
+	// the digital logic and the settling time of the analog circuits in ns
+
+	virtual uint tm_synram_cycles() const = 0; //  synapse ram access, first access of a row
+	virtual float tm_synram_ns() const = 0;    //  (without tsense)
+	virtual uint tm_synramnext_cycles() const = 0; //  further accesses to the open row
+	virtual float tm_synread_ns() const = 0;       //  synapse ram read incl. sense amplifiers
+	virtual uint tm_pram_cycles() const = 0;       //  parameter ram access (PramControl::write_pd)
 };
 
 #endif
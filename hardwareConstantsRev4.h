@@ -587,6 +587,12 @@ public:
 
 	uint fifo_reset_delay() const { return 5; }
 
+	uint tm_synram_cycles() const { return 6; }
+	float tm_synram_ns() const { return 40.0; }
+	uint tm_synramnext_cycles() const { return 2; }
+	float tm_synread_ns() const { return 1000.0; }
+	uint tm_pram_cycles() const { return 6; }
+
 	uint sg_sc_muxw() const { return 2; }
 	uint sg_sc_mux10m_pos() const { return 0; }
 	uint sg_sc_mux432_pos() const { return 4; }
@@ -555,6 +555,12 @@ public:
 
 	uint fifo_reset_delay() const { return 5; }
 
+	uint tm_synram_cycles() const { return 6; }
+	float tm_synram_ns() const { return 40.0; }
+	uint tm_synramnext_cycles() const { return 2; }
+	float tm_synread_ns() const { return 1000.0; }
+	uint tm_pram_cycles() const { return 6; }
+
 	// deprecated - only there to be not pure virtual...
 	uint sg_scleds() const { return 28; }
 	uint sg_scbsm_pos() const { return 8; }
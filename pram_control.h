@@ -440,6 +440,10 @@ public:
 	}
 	virtual uint get_cicmd() { return sp->hw_const->ci_areadouti(); } // ci subtype
 
+	// *** default delay of chain accesses, see CITiming::ar
+	void setDelay(int del) { scdelay = del; };
+	int getDelay() { return scdelay; };
+
 	// numbers inside chain are identical to parameter_ram definitions above
 	const int voutl;
 	const int voutr;
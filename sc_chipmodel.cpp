@@ -0,0 +1,433 @@
+// behavioral model of the Spikey chip for SC_Emulator
+
+#include "common.h" // library includes
+#include "idata.h"
+#include "sncomm.h"
+#include "spikenet.h"
+#include "sc_sctrl.h"
+#include "sc_emulator.h"
+#include "sc_chipmodel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+static log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("HAL.Model");
+
+using namespace spikey2;
+
+// no spike or input yet
+static const double never = -1e30;
+// neuron steps per window below which a single thread is faster than starting several
+static const double minthreadwork = 1 << 16;
+
+ChipModelParams::ChipModelParams()
+    : dt(5.0),
+      clkns(5.0),
+      taum(1000.0),
+      ileakref(0.2),
+      tausyn(30.0),
+      gmax(1.0),
+      drvioutref(1.0),
+      tref(100.0),
+      taurec(20000.0),
+      stpstep(0.2),
+      taustdp(2000.0),
+      corrthresh(1.0),
+      dacimax(2.5 * 1023 / 1024),
+      rconv(1.0),
+      fbdelay(2),
+      outlatency(6), // loopback latency of SC_Emulator
+      threads(0)
+{
+}
+
+SC_ChipModel::SC_ChipModel(uint time, uint chipversion, const ChipModelParams& p)
+    : SC_Emulator(time, chipversion),
+      par(p),
+      weight(num_blocks * num_rows * num_neurons, 0),
+      rowcfg(num_blocks * num_rows, 0),
+      colcfg(num_blocks * num_neurons, 0),
+      pram(1 << hw_const->pr_paraddr_width(), 0),
+      lut(32),
+      nreset(false),
+      eoutrst(0),
+      neuron(num_blocks * num_neurons),
+      causal(num_blocks * num_rows * num_neurons, 0),
+      acausal(num_blocks * num_rows * num_neurons, 0),
+      driver(num_blocks * num_rows),
+      tsim(0),
+      nsoffs(0),
+      lastout(hw_const->event_outs(), never),
+      numspikes(0),
+      numsteps(0),
+      settled(false)
+{
+	for (uint i = 0; i < lut.size(); i++)
+		lut[i] = i & 0xf; // keep the weights
+	for (uint n = 0; n < neuron.size(); n++) {
+		neuron[n].v = neuron[n].ge = neuron[n].gi = 0;
+		neuron[n].refrac = neuron[n].lastpost = never;
+	}
+	for (uint d = 0; d < driver.size(); d++) {
+		driver[d].lastpre = never;
+		driver[d].stp = 0;
+	}
+	LOG4CXX_INFO(logger, "Using behavioral chip model");
+}
+
+uint SC_ChipModel::getWeight(uint n, uint r)
+{
+	return weight[((n / num_neurons) * num_rows + r) * num_neurons + n % num_neurons];
+}
+
+double SC_ChipModel::getVoltage(uint n)
+{
+	return neuron[n].v;
+}
+
+//******** control interface ********
+
+void SC_ChipModel::processEvent(uint64_t time, uint addr)
+{
+	uint drv = ((addr >> 8) & 1) * num_rows + (addr & 0xff);
+	Input in = {time * par.clkns / (1 << hw_const->sg_efinewidth()) + nsoffs, drv};
+	uint sel = rowcfg[drv] & (hw_const->sc_sdd_is0() | hw_const->sc_sdd_is1());
+	if (sel == hw_const->sc_sdd_evin())
+		pending.insert(std::upper_bound(pending.begin(), pending.end(), in), in);
+	// the next row may take the input of this one
+	in.drv++;
+	if (in.drv % num_rows && (rowcfg[in.drv] & (hw_const->sc_sdd_is0() | hw_const->sc_sdd_is1())) ==
+	                             hw_const->sc_sdd_prev())
+		pending.insert(std::upper_bound(pending.begin(), pending.end(), in), in);
+}
+
+void SC_ChipModel::ciWrite(uint cmd, uint64_t data)
+{
+	SC_Emulator::ciWrite(cmd, data);
+	// the neurons run with the old configuration up to now
+	simulate(ns(chipClk()));
+	settled = false;
+
+	if (cmd == hw_const->ci_synrami()) {
+		uint sub = data & mmw(hw_const->sc_commandwidth());
+		uint64_t d = data >> hw_const->sc_commandwidth();
+		if (sub == hw_const->sc_cmd_ctrl()) {
+			nreset = !((d >> hw_const->sc_sreg_nresetb()) & 1);
+		} else if (sub == hw_const->sc_cmd_plut()) {
+			uint adr = d & mmw(hw_const->sc_aw());
+			if (adr < lut.size())
+				lut[adr] = (d >> hw_const->sc_aw()) & 0xf;
+		} else if (sub == hw_const->sc_cmd_syn()) {
+			uint adr = d & mmw(hw_const->sc_aw());
+			uint val = d >> hw_const->sc_aw();
+			uint row = adr >> (hw_const->sc_colmsb() + 1);
+			uint col = adr & mmw(hw_const->sc_colmsb() + 1);
+			if (adr & (1 << hw_const->sc_neuronconfigbit())) {
+				// 4 bits of neuron col + 64*p in each block
+				for (uint b = 0; b < num_blocks; b++)
+					for (uint p = 0; p < 3; p++)
+						colcfg[b * num_neurons + col + 64 * p] =
+						    (val >> ((b == 0 ? 12 : 0) + 4 * p)) & 0xf;
+			} else if (adr & (1 << hw_const->sc_rowconfigbit())) {
+				row &= 0xff;
+				rowcfg[row] = val & 0xff;
+				rowcfg[num_rows + row] = (val >> 8) & 0xff;
+			} else if (row < num_rows) {
+				for (uint b = 0; b < num_blocks; b++)
+					for (uint p = 0; p < 3; p++)
+						weight[(b * num_rows + row) * num_neurons + col + 64 * p] =
+						    (val >> ((b == 0 ? 12 : 0) + 4 * p)) & 0xf;
+			}
+		} else if (sub == hw_const->sc_cmd_pcor() || sub == hw_const->sc_cmd_pcorc()) {
+			processCorrelation(d & mmw(hw_const->sc_aw()), (d >> hw_const->sc_aw()) & 0xff);
+		}
+	} else if (cmd == hw_const->ci_paramrami()) {
+		if (((data >> hw_const->pr_cmd_pos()) & mmw(hw_const->pr_cmd_width())) ==
+		    hw_const->pr_cmd_ram())
+			pram[(data >> hw_const->pr_paraddr_pos()) & mmw(hw_const->pr_paraddr_width())] =
+			    (data >> hw_const->pr_dacval_pos()) & mmw(hw_const->pr_dacval_width());
+	} else if (cmd == hw_const->ci_controli()) {
+		if ((data & mmw(hw_const->cr_sel_width())) == hw_const->cr_sel_control())
+			eoutrst = (data >> (hw_const->cr_pos() + hw_const->cr_eout_rst())) &
+			          mmw(hw_const->event_outs());
+	}
+}
+
+uint64_t SC_ChipModel::ciRead(uint cmd, uint64_t data)
+{
+	if (cmd == hw_const->ci_synrami()) {
+		uint sub = data & mmw(hw_const->sc_commandwidth());
+		uint adr = (data >> hw_const->sc_commandwidth()) & mmw(hw_const->sc_aw());
+		uint row = adr >> (hw_const->sc_colmsb() + 1);
+		uint col = adr & mmw(hw_const->sc_colmsb() + 1);
+		// weights may have been changed by the correlation processing
+		if (sub == hw_const->sc_cmd_syn() &&
+		    !(adr & ((1 << hw_const->sc_rowconfigbit()) | (1 << hw_const->sc_neuronconfigbit()))) &&
+		    row < num_rows) {
+			uint64_t val = 0;
+			for (uint b = 0; b < num_blocks; b++)
+				for (uint p = 0; p < 3; p++)
+					val |= (uint64_t)weight[(b * num_rows + row) * num_neurons + col + 64 * p]
+					       << ((b == 0 ? 12 : 0) + 4 * p);
+			return sub | (((uint64_t)adr | val << hw_const->sc_aw()) << hw_const->sc_commandwidth());
+		}
+	}
+	return SC_Emulator::ciRead(cmd, data);
+}
+
+void SC_ChipModel::chipSync(uint64_t from, uint64_t to)
+{
+	double until = ns(from);
+	if (!pending.empty())
+		until = std::max(until, pending.back().t);
+	simulate(until);
+	// continue with the same model time after the chip time has been set
+	nsoffs += (double(from) - double(to)) * par.clkns;
+}
+
+void SC_ChipModel::programEnd()
+{
+	double until = ns(chipClk());
+	if (!pending.empty())
+		until = std::max(until, pending.back().t);
+	// let the last inputs take effect
+	simulate(until + par.tausyn);
+}
+
+//******** neurons ********
+
+SC_ChipModel::NeuronPar SC_ChipModel::neuronPar(uint n)
+{
+	uint b = n / num_neurons, i = n % num_neurons;
+	uint base = (b == 0 ? hw_const->pr_adr_neuron0start() : hw_const->pr_adr_neuron1start()) + 4 * i;
+	uint vout = (b == 0 ? hw_const->pr_adr_voutlstart() : hw_const->pr_adr_voutrstart()) + 2 * (i & 1);
+	NeuronPar p;
+	// vout k of the even/odd neurons is vout 2k/2k+1, stored as voltage DAC and bias each
+	p.ei = current(pram[vout + 4 * 0]) * par.rconv;
+	p.el = current(pram[vout + 4 * 1]) * par.rconv;
+	p.er = current(pram[vout + 4 * 2]) * par.rconv;
+	p.ex = current(pram[vout + 4 * 3]) * par.rconv;
+	p.vt = current(pram[vout + 4 * 8]) * par.rconv;
+	double ileak = par.dacimax - current(pram[base]);
+	p.taum = par.taum * par.ileakref / std::max(ileak, 1e-3);
+	p.fire = pram[base + 1] > 0;
+	p.record = colcfg[n] & hw_const->sc_ncd_evout();
+	return p;
+}
+
+bool SC_ChipModel::feedback()
+{
+	uint mask = hw_const->sc_sdd_is0() | hw_const->sc_sdd_is1();
+	for (uint d = 0; d < rowcfg.size(); d++) {
+		uint sel = rowcfg[d] & mask;
+		if (sel == hw_const->sc_sdd_in0() || sel == hw_const->sc_sdd_in1())
+			return true;
+	}
+	return false;
+}
+
+void SC_ChipModel::simulate(double until)
+{
+	if (until <= tsim)
+		return;
+	if (settled && pending.empty()) {
+		tsim = until;
+		return;
+	}
+
+	bool fb = feedback();
+	vector<NeuronPar> np(neuron.size());
+	for (uint n = 0; n < np.size(); n++)
+		np[n] = neuronPar(n);
+	double window = fb ? std::max(1u, par.fbdelay) * par.clkns : until - tsim;
+	uint mask = hw_const->sc_sdd_is0() | hw_const->sc_sdd_is1();
+
+	while (tsim < until) {
+		double t1 = std::min(until, tsim + window);
+
+		// synapse driver inputs of this window with short term plasticity
+		vector<double> pre(driver.size());
+		for (uint d = 0; d < driver.size(); d++)
+			pre[d] = driver[d].lastpre;
+		vector<SynEvent> ev;
+		uint k = 0;
+		for (; k < pending.size() && pending[k].t < t1; k++) {
+			Driver& d = driver[pending[k].drv];
+			uint cfg = rowcfg[pending[k].drv];
+			SynEvent e = {std::max(pending[k].t, tsim), pending[k].drv, 0,
+			              (cfg & hw_const->sc_sdd_seni()) && !(cfg & hw_const->sc_sdd_senx())};
+			double eff = 1;
+			if (cfg & hw_const->sc_sdd_enstdf()) {
+				if (d.lastpre > never)
+					d.stp *= exp(-(e.t - d.lastpre) / par.taurec);
+				eff = (cfg & hw_const->sc_sdd_dep()) ? 1 - d.stp : 1 + d.stp;
+				d.stp += par.stpstep * (1 - d.stp);
+			}
+			uint base = (e.drv < num_rows ? hw_const->pr_adr_syn0start()
+			                              : hw_const->pr_adr_syn1start()) +
+			            4 * (e.drv % num_rows);
+			if (cfg & (hw_const->sc_sdd_senx() | hw_const->sc_sdd_seni()))
+				e.g = par.gmax * current(pram[base]) / par.drvioutref * eff;
+			d.lastpre = e.t;
+			ev.push_back(e);
+		}
+		pending.erase(pending.begin(), pending.begin() + k);
+
+		// neurons are independent within a window
+		uint nthreads = par.threads ? par.threads : std::max(1u, std::thread::hardware_concurrency());
+		double work = (t1 - tsim) / par.dt * neuron.size() + ev.size() * neuron.size();
+		nthreads = std::min<double>(nthreads, std::max(1.0, work / minthreadwork));
+		vector<vector<Spike> > spk(nthreads);
+		vector<uint64_t> steps(nthreads, 0);
+		vector<uint> active(nthreads, 0);
+		if (nthreads == 1) {
+			active[0] = integrate(0, neuron.size(), tsim, t1, ev, np, pre, spk[0], steps[0]);
+		} else {
+			vector<std::thread> workers;
+			uint chunk = (neuron.size() + nthreads - 1) / nthreads;
+			for (uint i = 0; i < nthreads; i++) {
+				uint first = std::min<uint>(i * chunk, neuron.size());
+				uint last = std::min<uint>(first + chunk, neuron.size());
+				workers.push_back(std::thread([&, i, first, last]() {
+					active[i] = integrate(first, last, tsim, t1, ev, np, pre, spk[i], steps[i]);
+				}));
+			}
+			for (uint i = 0; i < workers.size(); i++)
+				workers[i].join();
+		}
+		vector<Spike> spikes;
+		uint notrest = 0;
+		for (uint i = 0; i < nthreads; i++) {
+			spikes.insert(spikes.end(), spk[i].begin(), spk[i].end());
+			numsteps += steps[i];
+			notrest += active[i];
+		}
+		std::sort(spikes.begin(), spikes.end());
+		numspikes += spikes.size();
+		settled = !notrest;
+
+		// feedback to the synapse drivers of the same (in0) or adjacent block (in1)
+		for (uint s = 0; s < spikes.size() && fb; s++) {
+			uint b = spikes[s].n / num_neurons, i = spikes[s].n % num_neurons;
+			for (uint r = i; r < num_rows; r += num_neurons)
+				for (uint bb = 0; bb < num_blocks; bb++) {
+					uint sel = rowcfg[bb * num_rows + r] & mask;
+					if ((sel == hw_const->sc_sdd_in0() && bb == b) ||
+					    (sel == hw_const->sc_sdd_in1() && bb != b)) {
+						Input in = {spikes[s].t + par.fbdelay * par.clkns, bb * num_rows + r};
+						pending.insert(std::upper_bound(pending.begin(), pending.end(), in), in);
+					}
+				}
+		}
+		output(spikes);
+		tsim = t1;
+	}
+}
+
+uint SC_ChipModel::integrate(uint first, uint last, double t0, double t1,
+                             const vector<SynEvent>& ev, const vector<NeuronPar>& np,
+                             const vector<double>& pre0, vector<Spike>& spikes, uint64_t& steps)
+{
+	uint notrest = 0;
+	double decsyn = exp(-par.dt / par.tausyn);
+	for (uint n = first; n < last; n++) {
+		uint b = n / num_neurons, i = n % num_neurons;
+		Neuron& s = neuron[n];
+		const NeuronPar& p = np[n];
+		double rest = nreset ? p.er : p.el;
+		vector<double> pre(pre0.begin() + b * num_rows, pre0.begin() + (b + 1) * num_rows);
+		uint e = 0;
+		double t = t0;
+		while (t < t1) {
+			double tn = std::min(t + par.dt, t1);
+			for (; e < ev.size() && ev[e].t < tn; e++) {
+				const SynEvent& x = ev[e];
+				if (x.drv / num_rows != b)
+					continue;
+				uint r = x.drv % num_rows, idx = x.drv * num_neurons + i;
+				if (s.lastpost > never)
+					acausal[idx] += exp(-(x.t - s.lastpost) / par.taustdp);
+				pre[r] = x.t;
+				double g = weight[idx] / 15.0 * x.g;
+				if (x.inh)
+					s.gi += g;
+				else
+					s.ge += g;
+			}
+			// nothing happens until the next input
+			if (s.ge < 1e-9 && s.gi < 1e-9 && fabs(s.v - rest) < 1e-6 && t >= s.refrac) {
+				double next = e < ev.size() ? ev[e].t : t1;
+				double skip = t0 + floor((next - t0) / par.dt) * par.dt;
+				if (skip > t) {
+					t = std::min(skip, t1);
+					continue;
+				}
+			}
+
+			double h = tn - t;
+			if (nreset || tn <= s.refrac) {
+				s.v = p.er;
+			} else {
+				double gt = 1 + s.ge + s.gi;
+				double vinf = (p.el + s.ge * p.ex + s.gi * p.ei) / gt;
+				double vold = s.v;
+				s.v = vinf + (s.v - vinf) * exp(-h * gt / p.taum);
+				if (p.fire && s.v >= p.vt && vold < p.vt) {
+					double ts = t + (p.vt - vold) / (s.v - vold) * h;
+					s.v = p.er;
+					s.refrac = ts + par.tref;
+					s.lastpost = ts;
+					for (uint r = 0; r < num_rows; r++)
+						if (pre[r] > never)
+							causal[(b * num_rows + r) * num_neurons + i] +=
+							    exp(-(ts - pre[r]) / par.taustdp);
+					Spike sp = {ts, n, p.record};
+					spikes.push_back(sp);
+				}
+			}
+			double dec = h == par.dt ? decsyn : exp(-h / par.tausyn);
+			s.ge *= dec;
+			s.gi *= dec;
+			steps++;
+			t = tn;
+		}
+		if (s.ge >= 1e-9 || s.gi >= 1e-9 || fabs(s.v - rest) >= 1e-6 || t1 < s.refrac)
+			notrest++;
+	}
+	return notrest;
+}
+
+void SC_ChipModel::output(vector<Spike>& spikes)
+{
+	for (uint s = 0; s < spikes.size(); s++) {
+		if (!spikes[s].rec)
+			continue;
+		uint b = spikes[s].n / num_neurons, i = spikes[s].n % num_neurons;
+		uint pe = b * 3 + i / 64;
+		if ((eoutrst >> pe) & 1)
+			continue;
+		// one event per clock cycle and priority encoder
+		double t = std::max(spikes[s].t, lastout[pe] + par.clkns);
+		lastout[pe] = t;
+		double time = (t - nsoffs) / par.clkns * (1 << hw_const->sg_efinewidth());
+		if (time < 0)
+			continue;
+		recordEvent((uint64_t)time + (par.outlatency << hw_const->sg_efinewidth()), (b << 8) | i);
+	}
+}
+
+void SC_ChipModel::processCorrelation(uint startrow, uint stoprow)
+{
+	for (uint b = 0; b < num_blocks; b++)
+		for (uint r = startrow; r <= stoprow && r < num_rows; r++)
+			for (uint i = 0; i < num_neurons; i++) {
+				uint idx = (b * num_rows + r) * num_neurons + i;
+				if (causal[idx] >= par.corrthresh && causal[idx] >= acausal[idx])
+					weight[idx] = lut[16 + weight[idx]];
+				else if (acausal[idx] >= par.corrthresh)
+					weight[idx] = lut[weight[idx]];
+				causal[idx] = acausal[idx] = 0;
+			}
+	LOG4CXX_TRACE(logger, "SC_ChipModel::processCorrelation rows " << startrow << "-" << stoprow);
+}
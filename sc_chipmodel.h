@@ -0,0 +1,153 @@
+// behavioral model of the Spikey chip for SC_Emulator
+
+namespace spikey2
+{
+
+//! Parameters of SC_ChipModel. The chip is not calibrated, so the defaults only give the order of
+//! magnitude of the hardware, in hardware time (ns) and in units of the leakage conductance.
+struct ChipModelParams
+{
+	double dt;         //!< integration step in ns
+	double clkns;      //!< duration of one clock cycle of the emulator (IData time >> 4) in ns
+	double taum;       //!< membrane time constant in ns at leakage current ileakref
+	double ileakref;   //!< leakage current of taum in uA
+	double tausyn;     //!< decay time constant of the synaptic conductances in ns
+	double gmax;       //!< conductance of weight 15 at driver current drvioutref
+	double drvioutref; //!< synapse driver output current of gmax in uA
+	double tref;       //!< refractory time in ns
+	double taurec;     //!< recovery time constant of short term plasticity in ns
+	double stpstep;    //!< fraction of the inactive partition added per spike of a STP driver
+	double taustdp;    //!< time constant of the STDP correlation measurement in ns
+	double corrthresh; //!< accumulated correlation at which the LUT is applied to a synapse
+	double dacimax;    //!< full scale current of the parameter DACs in uA
+	double rconv;      //!< conversion of vout DAC currents to voltages in V/uA
+	uint fbdelay;      //!< delay of feedback connections in clock cycles
+	uint outlatency;   //!< delay of output events to the record memory in clock cycles
+	uint threads;      //!< number of threads for the neurons, 0 for one per core
+
+	ChipModelParams();
+};
+
+//! Drop-in replacement of the chip behind SC_Emulator for running configurations and spike trains
+//! without hardware. The state of the chip is decoded from the control interface commands of the
+//! playback memory program: synapse ram (weights, row and column configuration, STDP LUT),
+//! parameter ram (ileak, icb, synapse driver currents, vouts) and the control registers. Input
+//! events drive conductance based leaky integrate-and-fire neurons through the synapse drivers
+//! (excitatory/inhibitory, short term depression/facilitation), output spikes pass the priority
+//! encoders and are recorded like on the hardware. The correlation processing commands update the
+//! weights according to the LUT.
+//! The input select of a synapse driver r (sc_sdd_in0/in1) connects it to neuron r % 192 of the
+//! same or the adjacent block instead of the external input, sc_sdd_prev to the input of row r-1.
+//! Without feedback the neurons of a whole program are integrated independently by several
+//! threads, with feedback in windows of fbdelay.
+//! Usage: new SC_Mem(boost::shared_ptr<SC_SlowCtrl>(new SC_ChipModel()))
+class SC_ChipModel : public SC_Emulator
+{
+public:
+	SC_ChipModel(uint time = 0, uint chipversion = 5, const ChipModelParams& p = ChipModelParams());
+
+	const ChipModelParams& getParams() { return par; };
+	void setParams(const ChipModelParams& p) { par = p; };
+
+	//! current weight of the synapse of neuron n (0..383) and synapse driver row r (0..255)
+	uint getWeight(uint n, uint r);
+	//! membrane voltage in V of neuron n
+	double getVoltage(uint n);
+	//! output spikes and integration steps since construction
+	uint64_t numSpikes() { return numspikes; };
+	uint64_t numSteps() { return numsteps; };
+
+	enum {
+		num_blocks = 2,
+		num_rows = 256,   // synapse drivers per block
+		num_neurons = 192 // neurons per block
+	};
+
+protected:
+	virtual void processEvent(uint64_t time, uint addr);
+	virtual void ciWrite(uint cmd, uint64_t data);
+	virtual uint64_t ciRead(uint cmd, uint64_t data);
+	virtual void chipSync(uint64_t from, uint64_t to);
+	virtual void programEnd();
+
+private:
+	ChipModelParams par;
+
+	// configuration as written to the chip
+	vector<uint8_t> weight; // [block][row][neuron]
+	vector<uint> rowcfg;    // [block][row], see sc_sdd_*
+	vector<uint> colcfg;    // [block][neuron], see sc_ncd_*
+	vector<uint> pram;      // DAC value by parameter address
+	vector<uint> lut;       // STDP LUT: acausal [0..15], causal [16..31]
+	bool nreset;            // neurons held in reset
+	uint eoutrst;           // priority encoders with reset output buffer
+
+	struct Neuron
+	{
+		double v, ge, gi; // membrane voltage, excitatory and inhibitory conductance
+		double refrac;    // end of refractory period
+		double lastpost;  // last spike, for STDP
+	};
+	vector<Neuron> neuron;
+	vector<float> causal, acausal; // correlation of each synapse, [block][row][neuron]
+
+	struct Driver
+	{
+		double lastpre; // last input, for STDP and STP
+		double stp;     // inactive partition of STP
+	};
+	vector<Driver> driver; // [block][row]
+
+	// input of a synapse driver at time t (ns)
+	struct Input
+	{
+		double t;
+		uint drv;
+		bool operator<(const Input& o) const { return t < o.t; };
+	};
+	vector<Input> pending; // not yet simulated input, sorted
+	double tsim;           // time up to which the neurons are simulated, in ns
+	double nsoffs;         // ns of chip time 0, changed by syncs to keep the model time continuous
+	vector<double> lastout; // last output event time of each priority encoder
+	uint64_t numspikes, numsteps;
+
+	// parameters of one neuron decoded from the parameter ram
+	struct NeuronPar
+	{
+		double el, er, vt, ex, ei, taum;
+		bool fire;   // comparator biased
+		bool record; // event output enabled
+	};
+	// a synapse driver input after short term plasticity
+	struct SynEvent
+	{
+		double t;
+		uint drv;
+		double g; // conductance of weight 15
+		bool inh;
+	};
+	struct Spike
+	{
+		double t;
+		uint n;
+		bool rec; // event output of the neuron enabled
+		bool operator<(const Spike& o) const { return t < o.t || (t == o.t && n < o.n); };
+	};
+	bool settled; // all neurons at rest, i.e. time without input can be skipped
+
+	double ns(uint64_t clk) { return clk * par.clkns + nsoffs; };
+	double current(uint dac) { return dac / 1023.0 * par.dacimax; };
+	NeuronPar neuronPar(uint n);
+	bool feedback(); // any driver connected to a neuron
+	// integrates all neurons up to time until (ns)
+	void simulate(double until);
+	// integrates neurons [first, last) over [t0, t1) with the driver inputs ev and the last input
+	// of each driver before t0 in pre, appends their spikes, returns the neurons not at rest
+	uint integrate(uint first, uint last, double t0, double t1, const vector<SynEvent>& ev,
+	               const vector<NeuronPar>& np, const vector<double>& pre, vector<Spike>& spikes,
+	               uint64_t& steps);
+	void output(vector<Spike>& spikes); // priority encoders and record memory
+	void processCorrelation(uint startrow, uint stoprow);
+};
+
+} // end of namespace spikey2
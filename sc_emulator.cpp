@@ -0,0 +1,470 @@
+// software model of the FlySpi FPGA playback memory and the Spikey command interface
+
+#include "common.h" // library includes
+#include "idata.h"
+#include "sncomm.h"
+#include "spikenet.h"
+#include "sc_sctrl.h"
+#include "sc_emulator.h"
+
+#include <algorithm>
+
+static log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("HAL.Emu");
+
+using namespace spikey2;
+
+// record memory is located in the second memory module (512MB, 64bit aligned), see SC_Mem
+static const uint recoffs = (1 << 26);
+// duration of one clk cycle in realtime mode, see SC_SlowCtrl::pbEvt for the actual clock
+static const double clkperiod = 5e-9;
+
+SC_Emulator::SC_Emulator(uint time, uint chipversion)
+    : SC_SlowCtrl("SC_Emulator", time, chipversion),
+      recbase(0),
+      curradr(0),
+      curwadr(0),
+      numsyncs(0),
+      arshift(0),
+      ctrlreg(0),
+      busyuntil(0),
+      cierror(false),
+      clk(0),
+      clkoffs(0),
+      lbenable(true),
+      realtime(false),
+      idlenotify(false),
+      runend(0),
+      runwadr(0),
+      temperature(40.0),
+      supplyvoltage(5.0),
+      numwords(0),
+      numcycles(0),
+      numinevents(0),
+      numrecwords(0)
+{
+	lblatency = 2 * hw_const->el_depth() + hw_const->el_offset();
+	// the first CI read answer contains no valid data, must not be mistaken for a time stamp
+	ciansw_cmd = hw_const->ci_loopbacki();
+	ciansw_data = 0;
+	LOG4CXX_INFO(logger, "Using playback memory emulator instead of hardware (Spikey "
+	                         << chipversion << ")");
+}
+
+//******** hardware access ********
+
+SpikenetComm::Commstate SC_Emulator::writeSC(uint data, uint addr)
+{
+	BusLock lock = lockBus();
+	LOG4CXX_TRACE(logger, "SC_Emulator::writeSC address:" << hex << addr << " data:" << hex
+	                                                      << data);
+	screg[addr & 0xfff] = data;
+	return ok;
+}
+
+SpikenetComm::Commstate SC_Emulator::readSC(uint& data, uint addr)
+{
+	BusLock lock = lockBus();
+	data = screg[addr & 0xfff];
+	if ((addr & 0xfff) == hw_const->sg_scsendidle())
+		data &= ~(1 << hw_const->sg_scsyncerr_pos()); // no sync errors
+	LOG4CXX_TRACE(logger, "SC_Emulator::readSC address:" << hex << addr << " data:0x" << hex
+	                                                     << data);
+	return ok;
+}
+
+SpikenetComm::Commstate SC_Emulator::writePBC(uint data, uint addr)
+{
+	BusLock lock = lockBus();
+	LOG4CXX_TRACE(logger, "SC_Emulator::writePBC address:" << hex << addr << " data:" << hex
+	                                                       << data);
+	addr &= 0xfff;
+	if (addr == hw_const->sg_sc_status()) {
+		if (data & (1 << hw_const->sg_sb_reset_ramsm())) {
+			curradr = pbcreg[hw_const->sg_sc_radr()] & mmw(hw_const->sg_sc_radrw());
+			curwadr = pbcreg[hw_const->sg_sc_wadr()] & mmw(hw_const->sg_sc_wadrw());
+		}
+		if (data & (1 << hw_const->sg_sb_start_ramsm()))
+			execute();
+	} else
+		pbcreg[addr] = data;
+	return ok;
+}
+
+SpikenetComm::Commstate SC_Emulator::readPBC(uint& data, uint addr)
+{
+	BusLock lock = lockBus();
+	addr &= 0xfff;
+	if (addr == hw_const->sg_sc_rwadr()) {
+		// program is executed instantly, in realtime mode results are hidden until it would have
+		// finished
+		if (running())
+			data = runwadr & mmw(hw_const->sg_sc_wadrw());
+		else
+			data = (curwadr & mmw(hw_const->sg_sc_wadrw())) | (1 << hw_const->sg_sc_isidle()) |
+			       (1 << hw_const->sg_sc_wtim());
+	} else if (addr == hw_const->sg_sc_rradr())
+		data = curradr;
+	else if (addr == hw_const->sg_sc_syncs())
+		data = numsyncs;
+	else if (addr == hw_const->sg_sc_status())
+		data = 0;
+	else
+		data = pbcreg[addr];
+	LOG4CXX_TRACE(logger, "SC_Emulator::readPBC address:" << hex << addr << " data:0x" << hex
+	                                                      << data);
+	return ok;
+}
+
+void SC_Emulator::writeMem(uint adr, const uint64_t* data, uint num)
+{
+	BusLock lock = lockBus();
+	LOG4CXX_TRACE(logger, "SC_Emulator::writeMem address:" << hex << adr << " size:" << dec
+	                                                       << num);
+	if (adr + num > pbmem.size())
+		pbmem.resize(adr + num);
+	std::copy(data, data + num, pbmem.begin() + adr);
+}
+
+void SC_Emulator::readMem(uint adr, uint num, vector<uint64_t>& buf)
+{
+	BusLock lock = lockBus();
+	LOG4CXX_TRACE(logger, "SC_Emulator::readMem address:" << hex << adr << " size:" << dec << num);
+	for (uint i = 0; i < num; i++) {
+		uint a = adr + i;
+		if (a >= recoffs) { // record memory
+			a -= recoffs;
+			buf.push_back((a >= recbase && a - recbase < recmem.size()) ? recmem[a - recbase] : 0);
+		} else
+			buf.push_back(a < pbmem.size() ? pbmem[a] : 0);
+	}
+}
+
+void SC_Emulator::writeDelcfg(uint data)
+{
+	LOG4CXX_TRACE(logger, "SC_Emulator::writeDelcfg data:" << hex << data);
+}
+
+void SC_Emulator::writeDac(const SBData& d)
+{
+	LOG4CXX_TRACE(logger, "SC_Emulator::writeDac " << d);
+}
+
+void SC_Emulator::readAdc(SBData& d, uint channel)
+{
+	BusLock lock = lockBus();
+	// channel 0 measures half of the supply voltage, nothing is connected to the others
+	d.setADvalue(channel == 0 ? supplyvoltage / 2.0 : 0.0);
+}
+
+float SC_Emulator::getTemp()
+{
+	BusLock lock = lockBus();
+	return temperature;
+}
+
+//******** playback memory model ********
+
+uint64_t& SC_Emulator::pbmemAt(uint adr)
+{
+	if (adr >= pbmem.size())
+		pbmem.resize(adr + 1);
+	return pbmem[adr];
+}
+
+// decodes the playback memory words as generated by pbSync, pbEvtdel, pbCI, pbEvtcmd and pbEvtpct
+void SC_Emulator::execute()
+{
+	uint numread = (pbcreg[hw_const->sg_sc_numread()] & mmw(hw_const->sg_sc_numreadw())) * 2;
+	uint end = curradr + numread;
+	LOG4CXX_DEBUG(logger, "SC_Emulator::execute: executing 0x" << hex << numread
+	                                                           << " words from address 0x"
+	                                                           << curradr);
+
+	numwords = 0;
+	numinevents = 0;
+	runwadr = curwadr;
+	rec.clear();
+	clkoffs = -(int64_t)clk;
+
+	while (curradr < end) {
+		uint64_t w = pbmemAt(curradr++);
+		numwords++;
+		if (w & 1ULL) { // event packet without event command
+			LOG4CXX_WARN(logger, "SC_Emulator::execute: unexpected event packet at 0x"
+			                         << hex << (curradr - 1));
+			clk += 2;
+			continue;
+		}
+		uint com = w & mmw(hw_const->sg_ev_comw());
+		if (com == hw_const->sg_ev_rdcom_ec()) {
+			// event command, followed by numpackets event packets; takes time+1 bus cycles
+			uint cycles = ((w >> hw_const->sg_ev_time()) & mmw(hw_const->sg_ev_timew())) + 1;
+			uint numpackets = (w >> hw_const->sg_ev_numev()) & mmw(hw_const->sg_ev_numevw());
+			uint lastmask = (w >> hw_const->sg_ev_evmask()) & mmw(hw_const->sg_ev_evmaskw());
+			uint64_t cstart = clk;
+			for (uint p = 0; p < numpackets && curradr < end; p++) {
+				uint64_t e = pbmemAt(curradr++);
+				numwords++;
+				uint64_t ptime = cstart + 2 * (p + 1); // time the packet is sent to the chip
+				for (uint s = 0; s < hw_const->ev_perpacket(); s++) {
+					if (p == numpackets - 1 && !(lastmask & (1 << s)))
+						continue;
+					uint evtime = (e >> (s * hw_const->sg_ev_evsize() + hw_const->sg_ev_evbase())) &
+					              mmw(hw_const->sg_etimewidth() + hw_const->sg_efinewidth());
+					uint addr = (e >> (hw_const->sg_datawidth() - hw_const->sg_eadrwidth() +
+					                   s * hw_const->sg_ev_evsize() + hw_const->sg_ev_evbase())) &
+					            mmw(hw_const->sg_eadrwidth());
+					// the chip delivers the event at the next occurrence of its 8 bit time stamp
+					uint64_t evclk =
+					    ptime + (((evtime >> hw_const->sg_efinewidth()) - ptime) &
+					             mmw(hw_const->sg_etimewidth()));
+					numinevents++;
+					processEvent((evclk << hw_const->sg_efinewidth()) |
+					                 (evtime & mmw(hw_const->sg_efinewidth())),
+					             addr);
+				}
+			}
+			clk = cstart + 2 * cycles;
+		} else if (com == hw_const->sg_ev_rdcom_ci()) {
+			uint rw = (w >> hw_const->sg_ev_cidata()) & 1;
+			uint cmd = (w >> (hw_const->sg_ev_cidata() + 1)) & mmw(hw_const->ci_cmd_width());
+			uint64_t data = (w >> (hw_const->sg_ev_cidata() + hw_const->ci_cmd_width() + 1)) &
+			                mmw(hw_const->sg_ev_cidataw());
+			if (cmd == hw_const->ci_synci()) {
+				// the controller needs 6 cycles to load the counter, see SC_SlowCtrl::pbSync
+				int64_t order = clk + clkoffs;
+				chipSync(clk, (data & mmw(hw_const->sg_systimewidth())) - 6);
+				clk = (data & mmw(hw_const->sg_systimewidth())) - 6;
+				clkoffs = order - clk;
+				busyuntil = 0;
+				numsyncs++;
+				RecEntry r = {(uint64_t)order, recsync, 0, 0};
+				rec.push_back(r);
+			} else if (clk < busyuntil) {
+				LOG4CXX_DEBUG(logger, "SC_Emulator::execute: CI command 0x"
+				                          << hex << cmd << " dropped, chip busy");
+				cierror = true;
+				if (rw == hw_const->ci_readi()) {
+					RecEntry r = {clk + clkoffs + 2 * hw_const->sg_chain_latency(), recci,
+					              ((ciansw_data & mmw(hw_const->sg_ev_cidataw()))
+					               << (hw_const->sg_ev_cidata() + hw_const->ci_cmd_width() + 1)) |
+					                  (ciansw_cmd << (hw_const->sg_ev_cidata() + 1)) |
+					                  (hw_const->ci_readi() << hw_const->sg_ev_cidata()),
+					              0};
+					rec.push_back(r);
+					ciansw_cmd = cmd | hw_const->ci_errori();
+					ciansw_data = data;
+					cierror = false;
+				}
+			} else if (rw == hw_const->ci_readi()) {
+				// the answer of a read command contains the result of the previous one
+				RecEntry r = {clk + clkoffs + 2 * hw_const->sg_chain_latency(), recci,
+				              ((ciansw_data & mmw(hw_const->sg_ev_cidataw()))
+				               << (hw_const->sg_ev_cidata() + hw_const->ci_cmd_width() + 1)) |
+				                  (ciansw_cmd << (hw_const->sg_ev_cidata() + 1)) |
+				                  (hw_const->ci_readi() << hw_const->sg_ev_cidata()),
+				              0};
+				rec.push_back(r);
+				ciansw_cmd = cierror ? (cmd | hw_const->ci_errori()) : cmd;
+				ciansw_data = ciRead(cmd, data);
+				cierror = false;
+			} else
+				ciWrite(cmd, data);
+			if (cmd != hw_const->ci_synci() && clk >= busyuntil) {
+				uint sub, addr;
+				ciAddress(cmd, data, sub, addr);
+				map<uint64_t, uint>::iterator b = busycycles.find(cikey(cmd, sub, 0));
+				if (b != busycycles.end())
+					busyuntil = clk + 2 * b->second;
+			}
+			clk += 2;
+		} else {
+			LOG4CXX_WARN(logger, "SC_Emulator::execute: unknown command 0x" << hex << w << " at 0x"
+			                                                                << (curradr - 1));
+			clk += 2;
+		}
+	}
+	programEnd();
+	numcycles = clk + clkoffs;
+	runend = monotonicTime() + numcycles * clkperiod;
+
+	serialize();
+}
+
+bool SC_Emulator::running()
+{
+	return realtime && monotonicTime() < runend;
+}
+
+bool SC_Emulator::waitIdleNotify(uint timeout)
+{
+	if (!idlenotify)
+		return false;
+	double wait = realtime ? runend - monotonicTime() : 0;
+	if (wait * 1e6 > timeout)
+		return false;
+	if (wait > 0)
+		usleep((useconds_t)(wait * 1e6));
+	return true;
+}
+
+// unused event slots get an invalid address, (addr & 0xff) >= 192 is ignored by translate
+static const uint64_t invalidaddr = 0xff;
+
+uint64_t SC_Emulator::eventPacket(const vector<RecEntry>& ev)
+{
+	uint64_t w = 1; // lsb marks event packet
+	for (uint s = 0; s < hw_const->ev_perpacket(); s++) {
+		uint64_t evtime = s < ev.size() ? ev[s].data : 0;
+		uint64_t addr = s < ev.size() ? ev[s].addr : invalidaddr;
+		w |= ((evtime & mmw(hw_const->sg_etimewidth() + hw_const->sg_efinewidth()))
+		      << (s * hw_const->sg_ev_evsize() + hw_const->sg_ev_evbase())) |
+		     ((addr & mmw(hw_const->sg_eadrwidth()))
+		      << (hw_const->sg_datawidth() - hw_const->sg_eadrwidth() +
+		          s * hw_const->sg_ev_evsize() + hw_const->sg_ev_evbase()));
+	}
+	return w;
+}
+
+// writes time stamps, events and CI answers to the record memory; a time stamp is inserted
+// whenever translate() could not reconstruct the time of the following event from the previous one
+void SC_Emulator::serialize()
+{
+	std::stable_sort(rec.begin(), rec.end());
+
+	vector<uint64_t> words;
+	vector<RecEntry> packet;
+	bool needstamp = true;
+	uint64_t lastevclk = 0;
+
+	for (uint i = 0; i < rec.size(); i++) {
+		const RecEntry& r = rec[i];
+		if (r.kind != recevent) {
+			if (packet.size())
+				words.push_back(eventPacket(packet));
+			packet.clear();
+			if (r.kind == recci)
+				words.push_back(r.data);
+			else
+				needstamp = true;
+			continue;
+		}
+
+		uint64_t evclk = r.data >> hw_const->sg_efinewidth();
+		// wrap arounds of the 8 bit event time can only be detected for distances below 128
+		if (evclk < lastevclk || evclk - lastevclk >= (1u << (hw_const->sg_etimewidth() - 1)))
+			needstamp = true;
+		if (packet.size() == hw_const->ev_perpacket() || (needstamp && packet.size())) {
+			words.push_back(eventPacket(packet));
+			packet.clear();
+		}
+		if (needstamp) {
+			// time stamp has to be later than the event, but less than one wrap around
+			words.push_back(((evclk + 1) & mmw(hw_const->sg_systimewidth()))
+			                    << (hw_const->sg_ev_cidata() + hw_const->ci_cmd_width() + 1) |
+			                (hw_const->ci_synci() << (hw_const->sg_ev_cidata() + 1)));
+			needstamp = false;
+		}
+		packet.push_back(r);
+		lastevclk = evclk;
+	}
+	if (packet.size())
+		words.push_back(eventPacket(packet));
+
+	// the FPGA completes the last DDR cycle with a dummy entry
+	if (words.size() % 2)
+		words.push_back(eventPacket(vector<RecEntry>()));
+
+	numrecwords = words.size();
+	LOG4CXX_DEBUG(logger, "SC_Emulator::serialize: " << dec << numinevents << " input events, "
+	                                                 << numrecwords << " record words, "
+	                                                 << numcycles << " cycles");
+	if (recmem.empty())
+		recbase = curwadr;
+	if (curwadr < recbase) {
+		recmem.insert(recmem.begin(), recbase - curwadr, 0);
+		recbase = curwadr;
+	}
+	if (curwadr - recbase + words.size() > recmem.size())
+		recmem.resize(curwadr - recbase + words.size());
+	std::copy(words.begin(), words.end(), recmem.begin() + (curwadr - recbase));
+	curwadr += words.size();
+	rec.clear();
+}
+
+//******** chip model ********
+
+void SC_Emulator::processEvent(uint64_t time, uint addr)
+{
+	if (lbenable)
+		recordEvent(time + (lblatency << hw_const->sg_efinewidth()), addr);
+}
+
+void SC_Emulator::recordEvent(uint64_t time, uint addr)
+{
+	RecEntry r = {(time >> hw_const->sg_efinewidth()) + clkoffs, recevent, time, addr};
+	rec.push_back(r);
+}
+
+// key for register map: CI command, sub command and address
+uint64_t SC_Emulator::cikey(uint cmd, uint sub, uint addr)
+{
+	return ((uint64_t)cmd << 48) | ((uint64_t)sub << 32) | addr;
+}
+
+void SC_Emulator::ciAddress(uint cmd, uint64_t data, uint& sub, uint& addr)
+{
+	sub = 0;
+	addr = 0;
+	if (cmd == hw_const->ci_synrami()) {
+		sub = data & mmw(hw_const->sc_commandwidth());
+		if (sub == hw_const->sc_cmd_syn() || sub == hw_const->sc_cmd_plut())
+			addr = (data >> hw_const->sc_commandwidth()) & mmw(hw_const->sc_aw());
+	} else if (cmd == hw_const->ci_paramrami()) {
+		sub = (data >> hw_const->pr_cmd_pos()) & mmw(hw_const->pr_cmd_width());
+		if (sub == hw_const->pr_cmd_ram())
+			addr = (data >> hw_const->pr_ramaddr_pos()) & mmw(hw_const->pr_ramaddr_width());
+		else if (sub == hw_const->pr_cmd_lut())
+			addr = (data >> hw_const->pr_lutadr_pos()) & mmw(hw_const->pr_lutadr_width());
+	}
+}
+
+void SC_Emulator::ciWrite(uint cmd, uint64_t data)
+{
+	LOG4CXX_TRACE(logger, "SC_Emulator::ciWrite cmd:" << hex << cmd << " data:" << data);
+	if (cmd == hw_const->ci_controli()) {
+		if ((data & mmw(hw_const->cr_sel_width())) == hw_const->cr_sel_control())
+			ctrlreg = (data >> hw_const->cr_pos()) & mmw(hw_const->cr_width());
+	} else if (cmd == hw_const->ci_areadouti()) {
+		arshift = data;
+	} else {
+		uint sub, addr;
+		ciAddress(cmd, data, sub, addr);
+		cireg[cikey(cmd, sub, addr)] = data;
+	}
+}
+
+uint64_t SC_Emulator::ciRead(uint cmd, uint64_t data)
+{
+	LOG4CXX_TRACE(logger, "SC_Emulator::ciRead cmd:" << hex << cmd << " data:" << data);
+	if (cmd == hw_const->ci_loopbacki())
+		return (~data) & mmm(52);
+	if (cmd == hw_const->ci_controli()) {
+		uint sel = data & mmw(hw_const->cr_sel_width());
+		if (sel == hw_const->cr_sel_control())
+			return (ctrlreg << hw_const->cr_pos()) | sel;
+		return sel; // no fifo errors
+	}
+	if (cmd == hw_const->ci_areadouti()) {
+		uint64_t res = arshift;
+		arshift = data;
+		// ar_maxlen is too small by 1 in Spikey4
+		return (hw_const->revision() == 4) ? (res >> 1) : res;
+	}
+	uint sub, addr;
+	ciAddress(cmd, data, sub, addr);
+	map<uint64_t, uint64_t>::iterator it = cireg.find(cikey(cmd, sub, addr));
+	if (it != cireg.end())
+		return it->second;
+	return data; // never written: all data bits are zero
+}
@@ -0,0 +1,142 @@
+// software model of the FlySpi FPGA playback memory and the Spikey command interface
+
+namespace spikey2
+{
+
+//! Replaces the Vmodule hardware access of SC_SlowCtrl by an in-process model of the playback and
+//! record memory and the spikey_sei command decoder. The playback memory program is executed when
+//! startPlayback() is called. Input events are looped back with a configurable latency, CI reads
+//! are answered from a register model of the chip and everything is written to the record memory
+//! in the format expected by SC_SlowCtrl::translate().
+//! Usage: boost::shared_ptr<SC_Mem> mem(new SC_Mem(boost::shared_ptr<SC_SlowCtrl>(new
+//! SC_Emulator())));
+class SC_Emulator : public SC_SlowCtrl
+{
+public:
+	SC_Emulator(uint time = 0, uint chipversion = 5);
+	virtual ~SC_Emulator() { stopTelemetry(); };
+
+	// hardware access of SC_SlowCtrl
+	virtual Commstate writeSC(uint data, uint addr);
+	virtual Commstate readSC(uint& data, uint addr);
+	virtual Commstate writePBC(uint data, uint addr);
+	virtual Commstate readPBC(uint& data, uint addr);
+	virtual void writeMem(uint adr, const uint64_t* data, uint num);
+	virtual void readMem(uint adr, uint num, vector<uint64_t>& buf);
+	virtual void writeDelcfg(uint data);
+	virtual void writeDac(const SBData&);
+	virtual void readAdc(SBData& d, uint channel = 1);
+	virtual float getTemp();
+	virtual bool waitIdleNotify(uint timeout);
+
+	//! latency of the event loopback in 400MHz clock cycles, defaults to the latency assumed by
+	//! SC_SlowCtrl::pbEvt for sent events
+	void setLoopbackLatency(uint clk) { lblatency = clk; };
+	uint getLoopbackLatency() { return lblatency; };
+	//! disable to execute the program without any events returned
+	void setLoopback(bool enable) { lbenable = enable; };
+	//! memory accesses of CI command cmd with subcommand sub (as decoded by the chip model) keep
+	//! the chip busy for cycles CI clock cycles. Commands received while busy are dropped and the
+	//! next read answer has the error flag set. Default 0, i.e. any delay is sufficient.
+	void setBusyCycles(uint cmd, uint sub, uint cycles) { busycycles[cikey(cmd, sub, 0)] = cycles; };
+	//! report the playback memory busy until the program would have finished on the hardware,
+	//! otherwise programs finish instantly
+	void setRealtime(bool enable) { realtime = enable; };
+	//! provide an idle notification by waitIdleNotify(), only useful in realtime mode
+	void setIdleNotify(bool enable) { idlenotify = enable; };
+
+	void setTemp(float t)
+	{
+		BusLock lock = lockBus();
+		temperature = t;
+	};
+	void setSupplyVoltage(float v)
+	{
+		BusLock lock = lockBus();
+		supplyvoltage = v;
+	};
+
+	// statistics of the last executed playback memory program
+	uint64_t executedWords() { return numwords; };
+	uint64_t executedCycles() { return numcycles; }; //!< duration in 400MHz clock cycles
+	uint64_t inputEvents() { return numinevents; };
+	uint64_t recordWords() { return numrecwords; };
+
+protected:
+	//! called for each event that is sent to the chip at its absolute time (IData time format,
+	//! i.e. 400MHz cycles << 4 | time bin); loops it back by default
+	virtual void processEvent(uint64_t time, uint addr);
+	//! puts an event produced by the chip at absolute time (IData time format) to the record memory
+	void recordEvent(uint64_t time, uint addr);
+
+	//! command interface model of the chip: write access
+	virtual void ciWrite(uint cmd, uint64_t data);
+	//! command interface model of the chip: read access, returns the answer data
+	virtual uint64_t ciRead(uint cmd, uint64_t data);
+
+	//! called before a sync sets the chip time from clock cycle from to to
+	virtual void chipSync(uint64_t /*from*/, uint64_t /*to*/) {}
+	//! called at the end of each playback memory program before the records are serialized
+	virtual void programEnd() {}
+	//! chip time in 400MHz clock cycles of the word being executed
+	uint64_t chipClk() const { return clk; };
+
+private:
+	// one entry of the record memory before serialization
+	enum RecKind { recevent, recci, recsync };
+	struct RecEntry {
+		uint64_t order; // 400MHz clock cycles since start of playback memory program
+		RecKind kind;
+		uint64_t data; // event time (IData time format) or CI answer word
+		uint addr;
+		bool operator<(const RecEntry& o) const { return order < o.order; }
+	};
+
+	void execute(); // execute playback memory program
+	static uint64_t cikey(uint cmd, uint sub, uint addr);
+	void ciAddress(uint cmd, uint64_t data, uint& sub, uint& addr); // decode memory access
+	void serialize(); // write recorded entries to record memory
+	uint64_t eventPacket(const vector<RecEntry>& ev); // record memory word for up to three events
+	uint64_t& pbmemAt(uint adr);
+	bool running(); // realtime mode: program still running
+
+	// memory
+	vector<uint64_t> pbmem; // playback memory, starting at address 0
+	vector<uint64_t> recmem; // record memory, starting at address recbase
+	uint recbase;
+
+	// playback memory control registers
+	map<uint, uint> pbcreg;
+	uint curradr, curwadr; // running read and write address
+	uint numsyncs;
+
+	// slow control registers
+	map<uint, uint> screg;
+
+	// chip model
+	map<uint64_t, uint64_t> cireg; // last written CI data by command and address
+	uint64_t arshift;              // analog readout shift register
+	uint64_t ctrlreg;              // chip control register
+	uint ciansw_cmd;               // pending CI read answer
+	uint64_t ciansw_data;
+	map<uint64_t, uint> busycycles; // see setBusyCycles
+	uint64_t busyuntil;             // clk at which the last memory access has finished
+	bool cierror;                   // command dropped since the last read
+
+	// playback state
+	uint64_t clk;      // FPGA/chip time in 400MHz cycles
+	int64_t clkoffs;   // offset between clk and order of record entries
+	vector<RecEntry> rec;
+
+	uint lblatency;
+	bool lbenable;
+	bool realtime, idlenotify;
+	double runend; // realtime mode: monotonicTime at which the program finishes
+	uint runwadr;  // realtime mode: write address at start of program
+	float temperature;
+	float supplyvoltage;
+
+	uint64_t numwords, numcycles, numinevents, numrecwords;
+};
+
+} // end of namespace spikey2
@@ -0,0 +1,288 @@
+// disassembler and profiler of playback memory programs
+
+#include "common.h" // library includes
+#include "idata.h"
+#include "sncomm.h"
+#include "sc_pbdisasm.h"
+
+static log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("HAL.PbDis");
+
+using namespace spikey2;
+
+PbProfile::PbProfile()
+    : total(0), numwords(0), numevents(0), numciwrites(0), numcireads(0), numsyncs(0)
+{
+	for (uint c = 0; c < numcat; c++) {
+		cycles[c] = 0;
+		words[c] = 0;
+	}
+}
+
+const char* PbProfile::name(Category c)
+{
+	static const char* names[] = {"delays", "ci", "events", "stdp", "syncs"};
+	return c < numcat ? names[c] : "unknown";
+}
+
+void PbProfile::print(std::ostream& o) const
+{
+	std::ios::fmtflags flags = o.flags();
+	o << dec << left << setw(12) << "category" << right << setw(14) << "cycles" << setw(8)
+	  << "%" << setw(10) << "words" << endl;
+	for (uint c = 0; c < numcat; c++)
+		o << left << setw(12) << name((Category)c) << right << setw(14) << cycles[c] << setw(8)
+		  << fixed << setprecision(1) << (total ? 100.0 * cycles[c] / total : 0.0) << setw(10)
+		  << words[c] << endl;
+	o << left << setw(12) << "total" << right << setw(14) << total << setw(8) << "" << setw(10)
+	  << numwords << endl;
+	o << numevents << " events, " << numciwrites << " CI writes, " << numcireads << " CI reads, "
+	  << numsyncs << " syncs" << endl;
+	for (std::map<std::string, uint64_t>::const_iterator i = cicycles.begin();
+	     i != cicycles.end(); i++)
+		o << left << setw(12) << ("ci " + i->first) << right << setw(14) << i->second << endl;
+	o.flags(flags);
+}
+
+std::string PbProfile::toJson() const
+{
+	std::ostringstream o;
+	o << "{\"total_cycles\": " << total << ", \"words\": " << numwords;
+	for (uint c = 0; c < numcat; c++)
+		o << ", \"" << name((Category)c) << "_cycles\": " << cycles[c] << ", \""
+		  << name((Category)c) << "_words\": " << words[c];
+	o << ", \"events\": " << numevents << ", \"ci_writes\": " << numciwrites
+	  << ", \"ci_reads\": " << numcireads << ", \"syncs\": " << numsyncs;
+	for (std::map<std::string, uint64_t>::const_iterator i = cicycles.begin();
+	     i != cicycles.end(); i++)
+		o << ", \"ci_" << i->first << "_cycles\": " << i->second;
+	o << "}";
+	return o.str();
+}
+
+// follows SC_Emulator::execute, but in bus cycles
+void PbDisassembler::decode(const vector<uint64_t>& prog, vector<PbInstr>& out) const
+{
+	out.clear();
+	out.reserve(prog.size());
+	uint64_t clk = 0;
+	for (uint a = 0; a < prog.size(); a++) {
+		uint64_t w = prog[a];
+		PbInstr i = {a, w, PbInstr::invalid, clk, 1, 0, 0, 0};
+		uint com = w & mmw(hw_const->sg_ev_comw());
+		if (w & 1ULL) {
+			// event packet without event command
+		} else if (com == hw_const->sg_ev_rdcom_ec()) {
+			// the vhdl code takes one cycle to decode the command
+			i.cycles = ((w >> hw_const->sg_ev_time()) & mmw(hw_const->sg_ev_timew())) + 1;
+			i.data = i.cycles - 1;
+			uint numpackets = (w >> hw_const->sg_ev_numev()) & mmw(hw_const->sg_ev_numevw());
+			uint lastmask = (w >> hw_const->sg_ev_evmask()) & mmw(hw_const->sg_ev_evmaskw());
+			i.kind = numpackets ? PbInstr::evcmd : PbInstr::delay;
+			i.cmd = numpackets;
+			uint c = out.size();
+			out.push_back(i);
+			for (uint p = 0; p < numpackets; p++) {
+				if (a + 1 >= prog.size() || !(prog[a + 1] & 1ULL)) {
+					LOG4CXX_WARN(logger, "PbDisassembler: event command at 0x"
+					                         << hex << i.adr << " lacks packets");
+					out[c].kind = PbInstr::invalid;
+					break;
+				}
+				a++;
+				uint n = hw_const->ev_perpacket();
+				if (p == numpackets - 1) {
+					n = 0;
+					for (uint s = 0; s < hw_const->ev_perpacket(); s++)
+						n += (lastmask >> s) & 1;
+				}
+				PbInstr e = {a, prog[a], PbInstr::evpacket, clk + p + 1, 0, 0, 0, n};
+				out.push_back(e);
+				out[c].numev += n;
+			}
+			clk += i.cycles;
+			continue;
+		} else if (com == hw_const->sg_ev_rdcom_ci()) {
+			uint rw = (w >> hw_const->sg_ev_cidata()) & 1;
+			i.cmd = (w >> (hw_const->sg_ev_cidata() + 1)) & mmw(hw_const->ci_cmd_width());
+			i.data = (w >> (hw_const->sg_ev_cidata() + hw_const->ci_cmd_width() + 1)) &
+			         mmw(hw_const->sg_ev_cidataw());
+			if (i.cmd == hw_const->ci_synci())
+				i.kind = PbInstr::sync;
+			else
+				i.kind = rw == hw_const->ci_readi() ? PbInstr::ciread : PbInstr::ciwrite;
+		}
+		out.push_back(i);
+		clk += i.cycles;
+	}
+}
+
+PbProfile::Category PbDisassembler::category(const PbInstr& i) const
+{
+	switch (i.kind) {
+		case PbInstr::ciwrite:
+		case PbInstr::ciread:
+			if (i.cmd == hw_const->ci_synrami()) {
+				uint sub = i.data & mmw(hw_const->sc_commandwidth());
+				if (sub == hw_const->sc_cmd_cor_read() || sub == hw_const->sc_cmd_pcor() ||
+				    sub == hw_const->sc_cmd_pcorc())
+					return PbProfile::stdp;
+			}
+			return PbProfile::ci;
+		case PbInstr::sync:
+			return PbProfile::syncs;
+		case PbInstr::evcmd:
+		case PbInstr::evpacket:
+			return PbProfile::events;
+		default:
+			return PbProfile::delays;
+	}
+}
+
+PbProfile PbDisassembler::profile(const vector<PbInstr>& instr) const
+{
+	PbProfile p;
+	const PbInstr* last = NULL; // last CI command or sync, if directly preceding
+	for (uint k = 0; k < instr.size(); k++) {
+		const PbInstr& i = instr[k];
+		PbProfile::Category c = category(i);
+		if (i.kind == PbInstr::delay && last != NULL) {
+			// spacing of the preceding command
+			c = category(*last);
+			if (last->kind != PbInstr::sync)
+				p.cicycles[ciName(last->cmd)] += i.cycles;
+		}
+		p.cycles[c] += i.cycles;
+		p.words[c]++;
+		p.total += i.cycles;
+		p.numwords++;
+
+		last = NULL;
+		switch (i.kind) {
+			case PbInstr::evcmd:
+				p.numevents += i.numev;
+				break;
+			case PbInstr::ciwrite:
+			case PbInstr::ciread:
+				(i.kind == PbInstr::ciread ? p.numcireads : p.numciwrites)++;
+				p.cicycles[ciName(i.cmd)] += i.cycles;
+				last = &i;
+				break;
+			case PbInstr::sync:
+				p.numsyncs++;
+				last = &i;
+				break;
+			default:
+				break;
+		}
+	}
+	return p;
+}
+
+PbProfile PbDisassembler::profile(const vector<uint64_t>& prog) const
+{
+	vector<PbInstr> instr;
+	decode(prog, instr);
+	return profile(instr);
+}
+
+std::string PbDisassembler::ciName(uint cmd) const
+{
+	if (cmd == hw_const->ci_synci())
+		return "sync";
+	if (cmd == hw_const->ci_loopbacki())
+		return "loopback";
+	if (cmd == hw_const->ci_paramrami())
+		return "pram";
+	if (cmd == hw_const->ci_controli())
+		return "control";
+	if (cmd == hw_const->ci_synrami())
+		return "synram";
+	if (cmd == hw_const->ci_areadouti())
+		return "aroutput";
+	if (cmd == hw_const->ci_evloopbacki())
+		return "evloopback";
+	if (cmd == hw_const->ci_dummycmdi())
+		return "dummy";
+	return "cmd" + to_str(cmd);
+}
+
+std::string PbDisassembler::mnemonic(const PbInstr& i) const
+{
+	std::ostringstream o;
+	switch (i.kind) {
+		case PbInstr::delay:
+			o << "delay " << dec << i.cycles;
+			break;
+		case PbInstr::evcmd:
+			o << "evcmd packets " << dec << i.cmd << " events " << i.numev << " cycles "
+			  << i.cycles;
+			break;
+		case PbInstr::evpacket:
+			o << "  events";
+			for (uint s = 0; s < i.numev; s++) {
+				uint evtime = (i.word >> (s * hw_const->sg_ev_evsize() + hw_const->sg_ev_evbase())) &
+				              mmw(hw_const->sg_etimewidth() + hw_const->sg_efinewidth());
+				uint addr = (i.word >> (hw_const->sg_datawidth() - hw_const->sg_eadrwidth() +
+				                        s * hw_const->sg_ev_evsize() + hw_const->sg_ev_evbase())) &
+				            mmw(hw_const->sg_eadrwidth());
+				o << " " << dec << addr << "@0x" << hex << evtime;
+			}
+			break;
+		case PbInstr::ciwrite:
+		case PbInstr::ciread:
+			o << (i.kind == PbInstr::ciread ? "ci read  " : "ci write ") << left << setw(10)
+			  << ciName(i.cmd) << " 0x" << hex << i.data;
+			if (i.cmd == hw_const->ci_synrami())
+				o << " sub " << dec << (i.data & mmw(hw_const->sc_commandwidth()));
+			if (category(i) == PbProfile::stdp)
+				o << " (stdp)";
+			break;
+		case PbInstr::sync:
+			o << "sync 0x" << hex << (i.data & mmw(hw_const->sg_systimewidth()));
+			break;
+		default:
+			o << "invalid";
+	}
+	return o.str();
+}
+
+void PbDisassembler::print(const vector<uint64_t>& prog, std::ostream& o) const
+{
+	vector<PbInstr> instr;
+	decode(prog, instr);
+	std::ios::fmtflags flags = o.flags();
+	char fill = o.fill();
+	for (uint k = 0; k < instr.size(); k++) {
+		const PbInstr& i = instr[k];
+		o << hex << right << setfill('0') << setw(6) << i.adr << setfill(' ') << dec << setw(11)
+		  << i.start << "  " << hex << setfill('0') << setw(16) << i.word << setfill(' ') << "  "
+		  << mnemonic(i) << endl;
+	}
+	o.fill(fill);
+	o.flags(flags);
+}
+
+bool PbDisassembler::save(std::string filename, const vector<uint64_t>& prog, uint revision)
+{
+	ofstream o(filename.c_str());
+	if (!o.good())
+		return false;
+	o << "revision " << revision << endl;
+	o << hex;
+	for (uint a = 0; a < prog.size(); a++)
+		o << prog[a] << endl;
+	return o.good();
+}
+
+bool PbDisassembler::load(std::string filename, vector<uint64_t>& prog, uint& revision)
+{
+	ifstream i(filename.c_str());
+	std::string key;
+	if (!i.good() || !(i >> key >> revision) || key != "revision")
+		return false;
+	prog.clear();
+	uint64_t w;
+	while (i >> hex >> w)
+		prog.push_back(w);
+	return i.eof();
+}
@@ -0,0 +1,84 @@
+// disassembler and profiler of playback memory programs
+
+namespace spikey2
+{
+
+//! One decoded playback memory word, see PbDisassembler
+struct PbInstr
+{
+	enum Kind {
+		delay,    //!< event command without packets, i.e. a NOP, see SC_SlowCtrl::pbEvtdel
+		evcmd,    //!< event command followed by event packets, see SC_SlowCtrl::pbEvtcmd
+		evpacket, //!< up to three events, see SC_SlowCtrl::pbEvtpct
+		ciwrite,  //!< control interface write, see SC_SlowCtrl::pbCI
+		ciread,   //!< control interface read
+		sync,     //!< system time synchronization, see SC_SlowCtrl::pbSync
+		invalid   //!< event packet without event command or truncated event command
+	};
+
+	uint adr;       //!< address relative to the program start
+	uint64_t word;  //!< raw playback memory word
+	Kind kind;
+	uint64_t start; //!< bus cycle at which the word is executed, relative to the program start
+	uint cycles;    //!< bus cycles until the next word is executed (0 for event packets)
+	uint cmd;       //!< CI command or sub command (ci, sync)
+	uint64_t data;  //!< CI data, sync time or event command time
+	uint numev;     //!< events of an event packet or command
+};
+
+//! Breakdown of the duration of a playback memory program, in bus cycles. Delays directly
+//! following a CI command or a sync are the spacing of that command and are counted for it.
+struct PbProfile
+{
+	enum Category {
+		delays = 0, // waiting, e.g. between events or for the end of an experiment
+		ci,         // control interface traffic except STDP
+		events,     // event commands including their packets
+		stdp,       // correlation readout and processing of the synapse ram
+		syncs,      // system time synchronization
+		numcat
+	};
+
+	uint64_t cycles[numcat]; //!< bus cycles per category
+	uint64_t words[numcat];  //!< playback memory words per category
+	uint64_t total;          //!< program duration in bus cycles
+	uint64_t numwords;
+	uint64_t numevents, numciwrites, numcireads, numsyncs;
+	std::map<std::string, uint64_t> cicycles; //!< bus cycles per CI command incl. spacing
+
+	PbProfile();
+	static const char* name(Category c);
+	//! table of the categories and CI commands
+	void print(std::ostream& o) const;
+	std::string toJson() const;
+};
+
+//! Decodes playback memory programs as generated by SC_SlowCtrl (from sdrambuf, the SDRAM or a
+//! file saved by SC_SlowCtrl::setProgramDump) into instructions with their cycle costs.
+//! Offline tool: tools/pbDisasm.
+class PbDisassembler
+{
+public:
+	PbDisassembler(boost::shared_ptr<HardwareConstants> hw) : hw_const(hw){};
+
+	void decode(const vector<uint64_t>& prog, vector<PbInstr>& out) const;
+	PbProfile profile(const vector<uint64_t>& prog) const;
+	PbProfile profile(const vector<PbInstr>& instr) const;
+	//! listing with one line per word: address, start cycle, raw word and mnemonic
+	void print(const vector<uint64_t>& prog, std::ostream& o) const;
+	std::string mnemonic(const PbInstr& i) const;
+	//! name of CI command cmd, e.g. "synram"
+	std::string ciName(uint cmd) const;
+
+	//! program file: chip revision and one hex word per line
+	static bool save(std::string filename, const vector<uint64_t>& prog, uint revision);
+	//! returns false if the file does not exist or is corrupt
+	static bool load(std::string filename, vector<uint64_t>& prog, uint& revision);
+
+private:
+	boost::shared_ptr<HardwareConstants> hw_const;
+
+	PbProfile::Category category(const PbInstr& i) const;
+};
+
+} // end of namespace spikey2
@@ -6,8 +6,11 @@
 #include "spikenet.h"
 #include "sc_sctrl.h"
 #include "sc_pbmem.h"
+#include "ctrlif.h"
+#include "synapse_control.h"
+#include "pram_control.h"
+#include "spikeyconfig.h"
 
-#include <boost/date_time/posix_time/posix_time.hpp>
 
 static log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("HAL.SCM");
 
@@ -16,13 +19,119 @@ using namespace spikey2;
 // init this global const... ugly...
 const IData SpikenetComm::emptydata;
 
+// completion wait of the playback memory, see SC_Mem::pollIdle()
+static const double stimeperiod = 10e-9; // stime counts 100MHz cycles, see SC_SlowCtrl::pbEvt
+static const double idlemargin = 200e-6; // wake up at least this early before predicted end
+static const uint minbackoff = 10, maxbackoff = 1000; // poll intervals in us
+
+// ***** ExpStats *****
+
+void ExpStats::reset()
+{
+	for (uint i = 0; i < numstages; i++)
+		seconds[i] = 0;
+	evencoded = evdropped = evshifted = pbwords = usbbytes = polls = recwords = evdecoded =
+	    evambiguous = evlate = wakeups = 0;
+	prederr = 0;
+	restarts = 0;
+	gap = gapmax = reactmax = 0;
+}
+
+bool ExpStats::empty() const
+{
+	return total() == 0 && evencoded == 0 && pbwords == 0 && recwords == 0;
+}
+
+double ExpStats::total() const
+{
+	double t = 0;
+	for (uint i = 0; i < numstages; i++)
+		t += seconds[i];
+	return t;
+}
+
+const char* ExpStats::stageName(uint s)
+{
+	static const char* names[numstages] = {"encode", "flush", "run", "wait", "receive"};
+	return s < numstages ? names[s] : "";
+}
+
+std::string ExpStats::toJson(const std::string& station) const
+{
+	std::ostringstream o;
+	o << "{";
+	if (!station.empty())
+		o << "\"station\": \"" << station << "\", ";
+	for (uint i = 0; i < numstages; i++)
+		o << "\"" << stageName(i) << "_s\": " << seconds[i] << ", ";
+	o << "\"events_encoded\": " << evencoded << ", \"events_dropped\": " << evdropped
+	  << ", \"events_shifted\": " << evshifted << ", \"pb_words\": " << pbwords
+	  << ", \"usb_bytes\": " << usbbytes << ", \"polls\": " << polls
+	  << ", \"rec_words\": " << recwords << ", \"events_decoded\": " << evdecoded
+	  << ", \"events_ambiguous\": " << evambiguous << ", \"events_late\": " << evlate
+	  << ", \"wakeups\": " << wakeups << ", \"prediction_error_s\": " << prederr
+	  << ", \"restarts\": " << restarts << ", \"restart_gap_s\": " << gap
+	  << ", \"restart_gap_max_s\": " << gapmax << ", \"reaction_max_s\": " << reactmax << "}";
+	return o.str();
+}
+
+// adds the elapsed time of its scope to one stage, time accounted to other stages in between
+// (e.g. waitIdle called from Receive) is excluded
+class StageTimer
+{
+	ExpStats& stats;
+	ExpStats::Stage stage;
+	double start;
+	double other;
+
+public:
+	StageTimer(ExpStats& s, ExpStats::Stage st)
+	    : stats(s),
+	      stage(st),
+	      start(monotonicTime()),
+	      other(s.total())
+	{
+	}
+	~StageTimer()
+	{
+		stats.seconds[stage] += monotonicTime() - start - (stats.total() - other);
+	}
+};
+
 SC_Mem::SC_Mem(uint time, std::string workstation)
     : SpikenetComm("sc_pbmem"), inrec(false), insend(false), flushed(false)
 {
 	sc = boost::shared_ptr<SC_SlowCtrl>(new SC_SlowCtrl(time, workstation));
+	init();
+}
+
+SC_Mem::SC_Mem(boost::shared_ptr<SC_SlowCtrl> sctrl)
+    : SpikenetComm("sc_pbmem"), sc(sctrl), inrec(false), insend(false), flushed(false)
+{
+	init();
+}
+
+SC_Mem::~SC_Mem()
+{
+	logStats();
+}
+
+void SC_Mem::init()
+{
+	pbcycles = 0;
+	pbduration = 0;
+	runstart = 0;
+	predictidle = true;
+	spindexchip = 0;
+	reorderwin = 0;
+	streampb = streamrec = 0;
+	segadr = segnum = segchip = segstart = segread = 0;
+	idleseen = 0;
+	segduration = 0;
+
 	updateHwConst(sc->getChipVersion());
 
-	sc->spyctrl->write(0xb, 0); // make sure, fpga loopback is deactivated
+	sc->writeSC(0, 0xb); // make sure, fpga loopback is deactivated
 
 	initChip();
 	intClear();
@@ -58,6 +167,7 @@ SpikenetComm::Commstate SC_Mem::Send(Mode mode, IData data, uint del, uint chip,
 	if (!insend) { // start send
 		sc->setPbradr(wadr); // wadr is the first empty address in playbackmem
 		insend = true;
+		pbcycles = 0;
 	}
 
 	// continue send
@@ -69,10 +179,13 @@ SpikenetComm::Commstate SC_Mem::Send(Mode mode, IData data, uint del, uint chip,
 			} else {
 				pbTrans(); // send collected events
 				sc->pbCI(mode, data, del + basedelay);
+				lastread = -1;
 				if ((mode & mutex) == read) {
 					sendidx++;
+					lastread = data.cmd();
 					// dbg(::Logger::DEBUG3) << "SC_Mem::Send sendidx now: " << sendidx;
 				}
+				pbcycles += basedelay + del;
 				setStime(stime() + basedelay + del); // keep track of simulation time only when
 				                                     // performing ci accesses
 				// (ag): systime increments due to event packing are calculated within sc-pbEvt!
@@ -93,12 +206,14 @@ SpikenetComm::Commstate SC_Mem::Send(Mode mode, IData data, uint del, uint chip,
 			sc->pbCI(SpikenetComm::read, dummy, sc->getMaxChainDelay());
 			sendidx++;
 			skip.push(sendidx);
+			lastread = -1;
 
 			if (del == 0)
 				syncdel = sc->getSyncMax();
 			else
 				syncdel = basedelay + del;
 			sc->pbSync(stime(), syncdel, syncoffset);
+			pbcycles += syncdel + (syncoffset >> 1);
 			setStime(stime() + syncdel + (syncoffset >> 1));
 			break;
 	}
@@ -114,6 +229,66 @@ SpikenetComm::Commstate SC_Mem::Send(Mode mode, IData data, uint del, uint chip,
 SpikenetComm::Commstate SC_Mem::Receive(Mode mode, IData& data, uint chip)
 {
 	static_cast<void>(mode);
+	if (!unclaimed.empty()) {
+		data = unclaimed.front();
+		unclaimed.pop_front();
+		return ok;
+	}
+	while (true) {
+		Commstate result = receiveAnswer(data, chip);
+		if (result != ok || !route(data))
+			return result;
+	}
+}
+
+boost::shared_ptr<CIReply> SC_Mem::expectReply(ControlInterface* ci)
+{
+	if (!insend || lastread != (int)ci->get_cicmd()) {
+		string msg = "SC_Mem::expectReply: last command sent was no read of this interface";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	// answer of the read has index sendidx, see receiveAnswer
+	boost::shared_ptr<CIReply> r(new CIReply(ci, sendidx));
+	replies[sendidx] = r;
+	lastread = -1;
+	return r;
+}
+
+SpikenetComm::Commstate SC_Mem::waitReply(CIReply& r, uint chip)
+{
+	map<uint, boost::shared_ptr<CIReply> >::iterator p = replies.find(r.sequence());
+	if (p == replies.end() || p->second.get() != &r) {
+		LOG4CXX_ERROR(logger, "SC_Mem::waitReply: read " << r.sequence()
+		                                                  << " not pending, memory cleared?");
+		return readfailed;
+	}
+	while (!r.ready()) {
+		IData data;
+		Commstate result = receiveAnswer(data, chip);
+		if (result != ok)
+			return result;
+		if (!route(data))
+			unclaimed.push_back(data); // keep for Receive
+	}
+	return ok;
+}
+
+bool SC_Mem::route(const IData& data)
+{
+	map<uint, boost::shared_ptr<CIReply> >::iterator p = replies.find(answeridx);
+	if (p == replies.end())
+		return false;
+	p->second->answer = data;
+	p->second->done = true;
+	replies.erase(p);
+	return true;
+}
+
+// returns the next answer of a CI read, events received on the way are decoded
+SpikenetComm::Commstate SC_Mem::receiveAnswer(IData& data, uint chip)
+{
+	StageTimer timer(stats, ExpStats::receive);
 
 	if (flushed) {
 		LOG4CXX_ERROR(logger, "SC_Mem::Receive: Incomplete flush of playback memory!");
@@ -225,30 +400,9 @@ SpikenetComm::Commstate SC_Mem::Receive(Mode mode, IData& data, uint chip)
 		if (rmvadr > recupto) {
 			LOG4CXX_TRACE(logger, "SC_Mem::Receive: readBlock from 0x"
 			                          << hex << recupto << ", size (int): " << (rmvadr - recupto));
-			uint maxchunksize = sc->getMaxChunkSize();
-			uint chunks = ((rmvadr - recupto) * 2) / maxchunksize + 1;
-			uint chunkstart = recupto * 2; // spikey addresses (rmvadr, radr, ...) are 64bit
-			                               // aligned, but vbuf 32bit
-			uint chunksize = 0;
-			for (uint chunk = 0; chunk < chunks; chunk++) {
-				// cut addresses to fit in chunks
-				uint virtChunksize = (rmvadr - recupto) * 2 - (chunkstart - recupto * 2);
-				if (virtChunksize > maxchunksize)
-					chunksize = maxchunksize;
-				else
-					chunksize = virtChunksize;
-				// dbg(::Logger::DEBUG3) << hex << "SC_Mem::Receive: recupto: " << recupto << ",
-				// rmvadr: " << rmvadr << ", chunks: " << chunks << ", chunkstart: " << chunkstart
-				// << ", chunksize: " << chunksize << endl;
-				Vbufuint_p recbuf = sc->mem->readBlock(chunkstart, chunksize);
-				for (uint i = 0; i < (chunksize / 2); i++) {
-					uint64_t temp = 0;
-					temp = (uint64_t)recbuf[2 * i] & 0xffffffff;
-					temp |= (uint64_t)recbuf[2 * i + 1] << 32;
-					readbuf.push_back(temp);
-				}
-				chunkstart = chunkstart + chunksize;
-			}
+			sc->readMem(recupto, rmvadr - recupto, readbuf);
+			stats.recwords += rmvadr - recupto;
+			stats.usbbytes += (rmvadr - recupto) * sizeof(uint64_t);
 			recupto = rmvadr;
 		}
 		rdata = readbuf[radr - (roffs + adcsize)];
@@ -269,12 +423,12 @@ SpikenetComm::Commstate SC_Mem::Receive(Mode mode, IData& data, uint chip)
 		if (data.isEmpty())
 			continue; // received a system time update event, skipping
 		if (data.isEvent()) {
-			rcvev[chip].push_back(data); // first event
+			decoded(data, chip); // first event
 			// get all three events from the rdata word
 			while (evmask) {
 				sc->translate(rdata, data, evmask);
 				if (data.isEvent())
-					rcvev[chip].push_back(data);
+					decoded(data, chip);
 			}
 			continue;
 		}
@@ -287,17 +441,69 @@ SpikenetComm::Commstate SC_Mem::Receive(Mode mode, IData& data, uint chip)
 			continue;
 		}
 		// received all data
+		answeridx = recidx;
 		recidx++;
 		break;
 	}
+	drainWindow(chip);
 	return ok;
 }
 
+static bool latertime(const IData& a, const IData& b)
+{
+	return a.time() > b.time();
+}
+
+void SC_Mem::decoded(const IData& data, uint chip)
+{
+	stats.evdecoded++;
+	if (sc->lastWrapAmbiguous()) {
+		stats.evambiguous++;
+		ambev[chip].push_back(data);
+	}
+	if (!reorderwin) {
+		emit(data, chip);
+		return;
+	}
+	window[chip].push_back(data);
+	push_heap(window[chip].begin(), window[chip].end(), latertime);
+	if (window[chip].size() > reorderwin) {
+		pop_heap(window[chip].begin(), window[chip].end(), latertime);
+		emit(window[chip].back(), chip);
+		window[chip].pop_back();
+	}
+}
+
+void SC_Mem::emit(const IData& data, uint chip)
+{
+	vector<IData>& ev = rcvev[chip];
+	if (reorderwin && !ev.empty() && ev.back().time() > data.time()) {
+		// older than the window, keep the output sorted
+		stats.evlate++;
+		ev.insert(upper_bound(ev.begin(), ev.end(), data,
+		                      [](const IData& a, const IData& b) { return a.time() < b.time(); }),
+		          data);
+	} else
+		ev.push_back(data);
+	if (spindex && chip == spindexchip)
+		spindex->add(data);
+}
+
+void SC_Mem::drainWindow(uint chip)
+{
+	while (!window[chip].empty()) {
+		pop_heap(window[chip].begin(), window[chip].end(), latertime);
+		emit(window[chip].back(), chip);
+		window[chip].pop_back();
+	}
+}
+
 // ends sending
 SpikenetComm::Commstate SC_Mem::Flush(uint chip = 0)
 {
 	LOG4CXX_DEBUG(logger,
 	              "SC_Mem::Flush: flushing playback memory (transferring data to hardware system)");
+	StageTimer timer(stats, ExpStats::flush);
 
 	// first check for memory overflow:
 	if (sc->pbradr() > (wsize - wstart)) {
@@ -326,6 +532,25 @@ SpikenetComm::Commstate SC_Mem::Flush(uint chip = 0)
 	// make pbmem run at least as long as last data has been transferred through daisy chain
 	sc->pbEvtdel(sc->getMaxChainDelay());
 
+	if (streaming) { // upload only, the registers are set when the segment is started
+		if (sc->pbradr() + 1 - wadr > streampb) {
+			string msg = "SC_Mem::Flush: program of segment " + to_str(segments) +
+			             " exceeds its half of the playback memory";
+			LOG4CXX_ERROR(logger, msg);
+			throw std::runtime_error(msg);
+		}
+		segadr = wadr;
+		segnum = sc->uploadSend(wadr);
+		segchip = chip;
+		segduration = pbcycles * stimeperiod;
+		stats.pbwords += segnum;
+		stats.usbbytes += segnum * sizeof(uint64_t);
+		wadr = (wadr == wstart) ? wstart + streampb : wstart; // other half for the next segment
+		flushed = true;
+		insend = false;
+		return ok;
+	}
+
 	// odd values are actually impossible since FPGA completes each pbmem cycle with an even number
 	// of accesses, automatically!
 	if (rstart % 2) {
@@ -338,15 +563,24 @@ SpikenetComm::Commstate SC_Mem::Flush(uint chip = 0)
 	rstart = sc->curwadr() + roffs; // set address of result memory, from where to read data in next
 	                                // flush
 
-	sc->setupPlayback(rstart - roffs, wadr, chip);
-	savePbContent(); // it's ok to save pointer after setupPlayback() has been called.
-	sc->resetPlayback();
+	// register setup, savePbContent and reset in one transaction
+	SC_Transaction t = sc->transaction();
+	sc->setupPlayback(rstart - roffs, wadr, chip, t);
+	stats.pbwords += sc->pbradr() - wadr;
+	stats.usbbytes += (sc->pbradr() - wadr) * sizeof(uint64_t);
+	// it's ok to save pointer after setupPlayback() has been called.
+	savePbContent(t);
+	t.resetPlayback();
+	sc->commit(t);
+	storePbContent(t);
 
 	// curwadr is valid after resetPlayback
 	LOG4CXX_TRACE(logger, "SC_Mem::Flush: receive addr (curwadr): 0x"
 	                          << hex << sc->curwadr() << "; PBM start addr (wadr): 0x" << hex
 	                          << wadr << "; PBM read start addr (radr): 0x" << hex << radr);
 
+	pbduration = pbcycles * stimeperiod; // expected duration of the program
+
 	flushed = true;
 	insend = false;
 	inrec = false;
@@ -358,8 +592,45 @@ SpikenetComm::Commstate SC_Mem::Flush(uint chip = 0)
 SpikenetComm::Commstate SC_Mem::Run()
 {
 	LOG4CXX_DEBUG(logger, "SC_Mem::Run: starting playback memory (triggering network emulation)");
+	if (streaming) {
+		if (!flushed) {
+			string msg = "SC_Mem::Run: no uploaded segment";
+			LOG4CXX_ERROR(logger, msg);
+			throw std::runtime_error(msg);
+		}
+		if (segments > 0) {
+			StageTimer timer(stats, ExpStats::wait);
+			pollIdle();
+			finishSegment();
+		}
+		StageTimer timer(stats, ExpStats::run);
+		// records alternate between the halves, the previous ones are drained meanwhile
+		segstart = segread = roffs + adcsize + (segments % 2) * streamrec;
+		SC_Transaction t = sc->transaction();
+		t.setNumRead(segnum >> 1);
+		t.setRadr(segadr);
+		t.setChipid(segchip);
+		t.setWadr(segstart - roffs);
+		t.resetPlayback();
+		t.startPlayback();
+		sc->commit(t);
+		runstart = monotonicTime();
+		if (segments > 0) {
+			double g = runstart - idleseen;
+			stats.restarts++;
+			stats.gap += g;
+			stats.gapmax = max(stats.gapmax, g);
+			stats.reactmax = max(stats.reactmax, pbduration + g);
+		}
+		pbduration = segduration;
+		flushed = false;
+		segments++;
+		return ok;
+	}
+	StageTimer timer(stats, ExpStats::run);
 
 	sc->startPlayback();
+	runstart = monotonicTime();
 	flushed = false;
 
 	/* optional debug functionality:
@@ -374,56 +645,310 @@ SpikenetComm::Commstate SC_Mem::Run()
 
 // hack!
 void SC_Mem::savePbContent()
+{
+	SC_Transaction t = sc->transaction();
+	savePbContent(t);
+	sc->commit(t);
+	storePbContent(t);
+}
+
+void SC_Mem::savePbContent(SC_Transaction& t)
 {
 	saved_skip = skip;
-	sc->getCurRadr(laststartadr);
-	sc->getNumRead(lastnumread);
+	hlaststartadr = t.getCurRadr();
+	hlastnumread = t.getNumRead();
+}
+
+void SC_Mem::storePbContent(const SC_Transaction& t)
+{
+	laststartadr = t.result(hlaststartadr);
+	lastnumread = t.result(hlastnumread);
 	// cout << "save lsa " << laststartadr << ", lnr " << lastnumread << endl;
 }
 
 void SC_Mem::recallPbContent()
+{
+	SC_Transaction t = sc->transaction();
+	recallPbContent(t);
+	sc->commit(t);
+}
+
+void SC_Mem::recallPbContent(SC_Transaction& t)
 {
 	skip = saved_skip;
-	sc->setRadr(laststartadr);
-	sc->setNumRead(lastnumread);
+	t.setRadr(laststartadr);
+	t.setNumRead(lastnumread);
 	// cout << "read lsa " << laststartadr << ", lnr " << lastnumread << endl;
 }
 
 void SC_Mem::reFlush()
 {
-	bool wtim0, readempty, writeinh, writefull;
-	bool idle = false;
-	while (!idle)
-		sc->getCurWadr(rmvadr, wtim0, idle, readempty, writeinh, writefull);
+	pollIdle();
 
 	if (!insend && !inrec) {
-		recallPbContent();
-		sc->resetPlayback(); // (ag): set all addresses to startup and ramfsm to IDLE.
-		sc->startPlayback();
-
-		while (!idle)
-			sc->getCurWadr(rmvadr, wtim0, idle, readempty, writeinh, writefull);
+		SC_Transaction t = sc->transaction();
+		recallPbContent(t);
+		t.resetPlayback(); // (ag): set all addresses to startup and ramfsm to IDLE.
+		t.startPlayback();
+		sc->commit(t);
+		runstart = monotonicTime(); // same program as before, i.e. pbduration is still valid
+
+		pollIdle();
 	} else {
 		LOG4CXX_ERROR(
 		    logger, "SC_Mem::reFlush: additional transfers issued before reFlush! Doing nothing!");
 	}
 }
 
+// The FPGA has no loop command, so each repetition is restarted from the host. The program stays
+// resident in the playback memory, only the record write pointer is moved behind the results of
+// the previous repetition and the read pointers are restored as for reFlush.
+void SC_Mem::runRepeated(uint n)
+{
+	if (!flushed) {
+		string msg = "SC_Mem::runRepeated: no flushed playback memory program";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	if (n == 0) {
+		string msg = "SC_Mem::runRepeated: no repetitions requested";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	LOG4CXX_DEBUG(logger, "SC_Mem::runRepeated: running playback memory " << n << " times");
+
+	repadr.clear();
+	repadr.push_back(rstart);
+	Run();
+	uint maxrec = 0; // records of the largest repetition so far
+	for (uint i = 1; i < n; i++) {
+		{
+			StageTimer timer(stats, ExpStats::wait);
+			pollIdle();
+		}
+		StageTimer timer(stats, ExpStats::run);
+		uint end = sc->curwadr();
+		maxrec = max(maxrec, end + roffs - repadr.back());
+		// the remaining repetitions are assumed to record at most as much as the previous ones
+		if (end + roffs + uint64_t(n - i) * maxrec > roffs + adcsize + rsize) {
+			repadr.clear();
+			string msg = "SC_Mem::runRepeated: records of " + to_str(n) +
+			             " repetitions exceed the record memory";
+			LOG4CXX_ERROR(logger, msg);
+			throw std::runtime_error(msg);
+		}
+		repadr.push_back(end + roffs);
+		SC_Transaction t = sc->transaction();
+		t.setWadr(end);
+		recallPbContent(t);
+		t.resetPlayback();
+		t.startPlayback();
+		sc->commit(t);
+		runstart = monotonicTime(); // same program, pbduration is still valid
+	}
+}
+
+void SC_Mem::recRepeated(vector<vector<IData> >& ev)
+{
+	if (repadr.empty()) {
+		string msg = "SC_Mem::recRepeated: no repetitions started";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	waitIdle();
+	StageTimer timer(stats, ExpStats::receive);
+
+	uint end = sc->curwadr() + roffs;
+	repadr.push_back(end);
+	if (end > recupto) {
+		sc->readMem(recupto, end - recupto, readbuf);
+		stats.recwords += end - recupto;
+		stats.usbbytes += (end - recupto) * sizeof(uint64_t);
+		recupto = end;
+	}
+
+	ev.assign(repadr.size() - 1, vector<IData>());
+	for (uint r = 0; r + 1 < repadr.size(); r++) {
+		// each repetition starts with the sync time stamp of its program, if any
+		decodeEvents(readbuf.data() + (repadr[r] - (roffs + adcsize)), repadr[r + 1] - repadr[r],
+		             ev[r]);
+	}
+
+	// everything up to the end of the last repetition has been read
+	radr = rmvadr = end;
+	repadr.clear();
+}
+
+void SC_Mem::decodeEvents(const uint64_t* words, uint num, vector<IData>& ev)
+{
+	for (uint a = 0; a < num; a++) {
+		IData data;
+		uint evmask = 7;
+		sc->translate(words[a], data, evmask);
+		if (!data.isEvent())
+			continue; // time stamp or CI answer
+		ev.push_back(data);
+		stats.evdecoded++;
+		while (evmask) {
+			sc->translate(words[a], data, evmask);
+			if (data.isEvent()) {
+				ev.push_back(data);
+				stats.evdecoded++;
+			}
+		}
+	}
+}
+
+// A segment is a complete playback memory program like any other experiment, only its upload
+// overlaps with the execution of the previous one and its records alternate between two halves
+// of the record memory.
+void SC_Mem::startStream(uint pbhalf, uint rechalf)
+{
+	intClear();
+	if (!pbhalf)
+		pbhalf = (wsize - wstart) / 2;
+	if (!rechalf)
+		rechalf = rsize / 2;
+	if (2 * pbhalf > wsize - wstart || 2 * rechalf > rsize || pbhalf % 2 || rechalf % 2) {
+		string msg = "SC_Mem::startStream: invalid size of the memory halves";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	LOG4CXX_DEBUG(logger, "SC_Mem::startStream: 0x" << hex << pbhalf << " playback and 0x"
+	                                                << rechalf << " record words per segment");
+	streampb = pbhalf;
+	streamrec = rechalf;
+	streaming = true;
+}
+
+void SC_Mem::endStream()
+{
+	if (!streaming) {
+		string msg = "SC_Mem::endStream: not streaming";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	if (flushed)
+		LOG4CXX_WARN(logger, "SC_Mem::endStream: uploaded segment " << segments
+		                                                           << " has not been started");
+	if (segments > 0) {
+		StageTimer timer(stats, ExpStats::wait);
+		pollIdle();
+		finishSegment();
+	}
+	streaming = false;
+	flushed = false;
+}
+
+void SC_Mem::finishSegment()
+{
+	uint end = sc->curwadr() + roffs;
+	if (end - segstart > streamrec) {
+		string msg = "SC_Mem::finishSegment: records of segment " + to_str(segments - 1) +
+		             " exceed their half of the record memory";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	if (drainend > drainstart)
+		LOG4CXX_WARN(logger, "SC_Mem::finishSegment: records of segment "
+		                         << (segments - 2) << " have not been drained, discarding them");
+	drainstart = segread; // without the records already returned by pollSegment
+	drainend = end;
+	segread = end;
+}
+
+// Same validity rules as Receive: records are only valid while the playback memory is idle or
+// its timeout counter has expired.
+bool SC_Mem::pollSegment(vector<IData>& ev)
+{
+	if (!streaming || !segments) {
+		string msg = "SC_Mem::pollSegment: no running segment";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	bool wtim0, idle, readempty, writeinh, writefull;
+	uint end;
+	sc->getCurWadr(end, wtim0, idle, readempty, writeinh, writefull);
+	stats.polls++;
+	if (readempty || writeinh || writefull) {
+		string msg = "SC_Mem::pollSegment: ";
+		if (readempty)
+			msg += "FIFO FPGA memory->Spikey ran empty!";
+		else if (writeinh)
+			msg += "FIFO Spikey->FPGA memory had overflow!";
+		else
+			msg += "Spikey->FPGA record memory ran full!";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	if (idle)
+		observedIdle();
+	else if (!wtim0)
+		return false;
+
+	end += roffs;
+	if (end - segstart > streamrec) {
+		string msg = "SC_Mem::pollSegment: records of segment " + to_str(segments - 1) +
+		             " exceed their half of the record memory";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	if (end > segread) {
+		StageTimer timer(stats, ExpStats::receive);
+		vector<uint64_t> buf;
+		sc->readMem(segread, end - segread, buf);
+		stats.recwords += buf.size();
+		stats.usbbytes += buf.size() * sizeof(uint64_t);
+		decodeEvents(buf.data(), buf.size(), ev);
+		segread = end;
+	}
+	return idle;
+}
+
+bool SC_Mem::drainSegment(vector<IData>& ev)
+{
+	if (drainend <= drainstart)
+		return false;
+	StageTimer timer(stats, ExpStats::receive);
+	vector<uint64_t> buf;
+	sc->readMem(drainstart, drainend - drainstart, buf);
+	stats.recwords += buf.size();
+	stats.usbbytes += buf.size() * sizeof(uint64_t);
+	decodeEvents(buf.data(), buf.size(), ev);
+	drainstart = drainend = 0;
+	return true;
+}
+
 // resets all queues, unsend and unreceived data is discarded
 // to make sure all data is transmitted, call rec until eof is reached
 SpikenetComm::Commstate SC_Mem::intClear()
 {
+	// a new experiment starts
+	logStats();
+	stats.reset();
+
 	inrec = false;
 	insend = false;
 	flushed = false;
 	read_issued = false;
 	readbuf.clear();
+	for (uint c = 0; c < maxid; c++) {
+		window[c].clear();
+		ambev[c].clear();
+	}
 
 	sendidx = 0;
 	recidx = 0;
 	while (!skip.empty())
 		skip.pop();
 	skip.push(sendidx); // skip first data package, which is generated by dummy read
+	replies.clear();
+	unclaimed.clear();
+	lastread = -1;
+	answeridx = 0;
+	streaming = false;
+	segments = 0;
+	drainstart = drainend = 0;
 
 	wstart = 0;
 	rstart = roffs + adcsize;
@@ -432,11 +957,13 @@ SpikenetComm::Commstate SC_Mem::intClear()
 	rmvadr = radr;
 	recupto = rmvadr;
 
-	sc->setContIdleOn(); // (ag): the default as no single idle event packets can be sent via pb
-	                     // mem.
 	sc->setPbradr(wadr);
-	sc->setWadr(radr - roffs);
-	sc->resetPlayback(); // has been changed in spikey_sei
+	SC_Transaction t = sc->transaction();
+	t.setContIdleOn(); // (ag): the default as no single idle event packets can be sent via pb
+	                   // mem.
+	t.setWadr(radr - roffs);
+	t.resetPlayback(); // has been changed in spikey_sei
+	sc->commit(t);
 
 	LOG4CXX_TRACE(logger, "SC_Mem::intClear: cleared inrec and insend and flushed");
 	return ok;
@@ -451,7 +978,7 @@ SpikenetComm::Commstate SC_Mem::initChip()
 
 	// turn off idle event packet generation and reset ios
 	sc->setContIdleOff();
-	sc->spydc->write(0, 0x30000000);
+	sc->writeDelcfg(0x30000000);
 
 	this->Send(SpikenetComm::ctrl, d);
 
@@ -466,8 +993,8 @@ SpikenetComm::Commstate SC_Mem::initChip()
 	this->Send(SpikenetComm::ctrl, d);
 
 	// set CAL and RST input of IODELAys once to initialize
-	sc->spydc->write(0, 0x21000000);
-	sc->spydc->write(0, 0x30000000);
+	sc->writeDelcfg(0x21000000);
+	sc->writeDelcfg(0x30000000);
 
 	// set phase select bits
 	this->Send(SpikenetComm::ctrl, p);
@@ -481,14 +1008,14 @@ SpikenetComm::Commstate SC_Mem::initChip()
 	d.setCimode(true);
 	this->Send(SpikenetComm::ctrl, d);
 
-	sc->spydc->write(0, 0x30000000);
+	sc->writeDelcfg(0x30000000);
 	for (uint d = 0; d < sc->getDelayFpgaIn(); d++)
-		sc->spydc->write(0, 0x2013ffff);
+		sc->writeDelcfg(0x2013ffff);
 
 	d.setCimode(false);
 	this->Send(SpikenetComm::ctrl, d);
 
-	sc->spydc->write(0, 0x00000000);
+	sc->writeDelcfg(0x00000000);
 
 	d.setReset(true);
 	this->Send(SpikenetComm::ctrl, d);
@@ -504,29 +1031,72 @@ inline void SC_Mem::pbTrans()
 {
 	uint newstime;
 	if (!pbdat.empty()) {
+		StageTimer timer(stats, ExpStats::encode);
+		size_t modified = sc->eev(0)->size();
+		stats.evencoded += pbdat.size();
 		sc->pbEvt(pbdat, newstime, stime());
+		modified = sc->eev(0)->size() - modified;
+		if (sc->getShiftLate())
+			stats.evshifted += modified;
+		else
+			stats.evdropped += modified;
+		pbcycles += newstime - stime();
 		pbdat.clear();
 		setStime(newstime);
 	}
 }
 
 void SC_Mem::waitIdle()
+{
+	LOG4CXX_TRACE(logger, "Waiting for playback memory to become IDLE...");
+	StageTimer timer(stats, ExpStats::wait);
+
+	pollIdle();
+
+	wadr = sc->pbradr(); // update pointer to free playback mem
+
+	LOG4CXX_TRACE(logger, "waitIdle: PBM now idle: rmvadr = 0x" << hex << rmvadr << ", radr = 0x"
+	                                                            << hex << radr - (roffs + adcsize)
+	                                                            << ", wadr = 0x" << hex << wadr);
+}
+
+// The end of the playback memory program is predicted from its duration in stime. Instead of
+// polling the idle flag via USB during the whole experiment, sleep until shortly before the
+// predicted end, then use the idle notification of the backend, if any, and finally poll with
+// exponentially increasing intervals.
+void SC_Mem::pollIdle()
 {
 	bool wtim0, readempty, writeinh, writefull;
 	bool idle = false;
 
-	LOG4CXX_TRACE(logger, "Waiting for playback memory to become IDLE...");
+	double predicted = runstart + pbduration;
+	if (predictidle && runstart > 0) {
+		double sleep = predicted - monotonicTime() - max(idlemargin, 0.1 * pbduration);
+		if (sleep > 0) {
+			LOG4CXX_TRACE(logger, "SC_Mem::pollIdle: sleeping for " << sleep << "s");
+			usleep((useconds_t)(sleep * 1e6));
+			stats.wakeups++;
+		}
+		if (sc->waitIdleNotify(max_poll_time * 1000))
+			stats.wakeups++;
+	}
 
 	uint polls = 0;
 	uint diff_ms_counter = 0;
-	boost::posix_time::ptime time_start = boost::posix_time::microsec_clock::local_time();
-	while (!idle) {
+	uint backoff = minbackoff;
+	double time_start = monotonicTime();
+	while (true) {
 		sc->getCurWadr(rmvadr, wtim0, idle, readempty, writeinh, writefull);
 		polls++;
+		stats.polls++;
+		if (idle)
+			break;
+		if (predictidle) {
+			usleep(backoff);
+			backoff = min(2 * backoff, maxbackoff);
+		}
 		if (polls % 100 == 0) {
-			boost::posix_time::ptime time_now = boost::posix_time::microsec_clock::local_time();
-			boost::posix_time::time_duration diff = time_now - time_start;
-			long diff_ms = diff.total_milliseconds();
+			long diff_ms = (long)((monotonicTime() - time_start) * 1e3);
 			if (diff_ms / 1000 > diff_ms_counter) {
 				dbg(Logger::WARNING) << "Waited " << diff_ms << "ms (" << polls
 				                     << " polls) for FPGA to get idle (this may happen for high "
@@ -541,9 +1111,27 @@ void SC_Mem::waitIdle()
 		}
 	}
 
-	wadr = sc->pbradr(); // update pointer to free playback mem
+	observedIdle();
+}
 
-	LOG4CXX_TRACE(logger, "waitIdle: PBM now idle: rmvadr = 0x" << hex << rmvadr << ", radr = 0x"
-	                                                            << hex << radr - (roffs + adcsize)
-	                                                            << ", wadr = 0x" << hex << wadr);
+void SC_Mem::observedIdle()
+{
+	// first time the end of the last started program is observed
+	if (runstart > 0) {
+		idleseen = monotonicTime();
+		stats.prederr += idleseen - (runstart + pbduration);
+		runstart = 0;
+	}
+}
+
+void SC_Mem::logStats()
+{
+	if (statslog.empty() || stats.empty())
+		return;
+	ofstream o(statslog.c_str(), ios::app);
+	if (!o.good()) {
+		LOG4CXX_WARN(logger, "SC_Mem::logStats: cannot open " << statslog);
+		return;
+	}
+	o << stats.toJson(getWorkStationName()) << endl;
 }
@@ -10,8 +10,52 @@ class TMSpikeyClass;
 namespace spikey2
 {
 
+class SpikeIndex;
+
 // ***** busmode playback memory *****
 
+//! Wall-clock time and counters of one experiment, i.e. of everything between two calls of
+//! SC_Mem::Clear().
+struct ExpStats
+{
+	enum Stage {
+		encode = 0, // pbEvt
+		flush,      // Flush without encoding, i.e. transfer to playback memory
+		run,        // start of playback memory
+		wait,       // waitIdle
+		receive,    // Receive without waiting, i.e. readback and translate
+		numstages
+	};
+	double seconds[numstages];
+
+	uint64_t evencoded, // events passed to pbEvt
+	    evdropped,      // events dropped by pbEvt
+	    evshifted,      // events delayed by pbEvt, see SC_SlowCtrl::setShiftLate
+	    pbwords,        // playback memory words transferred
+	    usbbytes,       // bytes of playback and record memory block transfers
+	    polls,          // status polls while waiting for the playback memory
+	    recwords,       // record memory words read back
+	    evdecoded,      // events decoded by Receive
+	    evambiguous,    // decoded events whose time relies on a guessed wrap around
+	    evlate,         // events older than the reorder window, inserted into the sorted output
+	    wakeups;        // ends of the sleep until the predicted end and idle notifications, not
+	                    // counting the sleeps between polls
+	double prederr; // end of playback memory program observed minus predicted end, in seconds
+	uint64_t restarts; // segments started after the end of the previous one, see startStream
+	double gap,        // sum of the times from the observed end of a segment to the next start
+	    gapmax,        // longest of these restart gaps
+	    reactmax;      // longest segment plus restart gap, i.e. worst case closed-loop latency
+
+	ExpStats() { reset(); };
+	void reset();
+	bool empty() const;
+	double total() const; //!< sum over all stages
+	double stageSeconds(uint s) const { return s < numstages ? seconds[s] : 0; };
+	static const char* stageName(uint s);
+	//! single line JSON object, station is added if not empty
+	std::string toJson(const std::string& station = "") const;
+};
+
 
 class SC_Mem : public SpikenetComm
 {
@@ -34,6 +78,7 @@ private:
 
 	// storage variables
 	uint laststartadr, lastnumread;
+	uint hlaststartadr, hlastnumread; // read handles of savePbContent(SC_Transaction&)
 
 	// receive mem
 	//! ADC read buffer size: 128MB in words (64bit aligned)
@@ -56,29 +101,89 @@ private:
 	                        // (for recall stuff)
 	uint sendidx, recidx;   // track numer of read commands issued during send/receive
 
+	// answers of reads handed out via ControlInterface::reply, see expectReply
+	map<uint, boost::shared_ptr<CIReply> > replies; // pending replies by read index
+	std::deque<IData> unclaimed; // answers decoded by waitReply but not yet passed to Receive
+	int lastread;                // CI command of the last command if it was a read, else -1
+	uint answeridx;              // read index of the last answer decoded by receiveAnswer
+	Commstate receiveAnswer(IData& data, uint chip); // decodes up to the next CI answer
+	bool route(const IData& data); // passes the last decoded answer to its reply, if pending
+
 	bool inrec, insend, flushed;
 	vector<IData> pbdat; // data for playback memory
 
 	vector<IData> rcvev[maxid]; // sort received events in this buffer
+	boost::shared_ptr<SpikeIndex> spindex; // accumulates received events of spindexchip if set
+	uint spindexchip;
+
+	// time-sorted decoding, see setReorderWindow
+	uint reorderwin;             // number of events held back, 0: keep record memory order
+	vector<IData> window[maxid]; // min-heap on time of held back events
+	vector<IData> ambev[maxid];  // events with ambiguous wrap around decision
+	void decoded(const IData& data, uint chip); // handles an event decoded by Receive
+	void emit(const IData& data, uint chip);    // appends an event to the received events
+	void drainWindow(uint chip);
 
 	static const uint max_poll_time = 10000; //!< max number of milli seconds while waiting for
 	                                         //playback memory to become idle
 
+	// completion wait of the playback memory program
+	uint64_t pbcycles; // duration of current playback memory program in stime cycles
+	double pbduration; // predicted duration of the flushed program in seconds
+	double runstart;   // monotonicTime of the last start of the playback memory
+	bool predictidle;  // sleep until predicted end and back off polling, otherwise busy poll
+	void pollIdle();   // wait for idle flag, updates rmvadr
+	double idleseen;   // monotonicTime at which the end of the last program was observed
+	void observedIdle(); // first observation of the end of the program started at runstart
+
+	// repetitions of the flushed program, see runRepeated
+	vector<uint> repadr; // record memory start address of each repetition
+
+	// segments, see startStream
+	bool streaming;
+	uint streampb, streamrec; // size of each half of the playback and record memory
+	uint segments;            // segments started
+	uint segadr, segnum, segchip; // uploaded, but not yet started program
+	double segduration;           // predicted duration of the uploaded program
+	uint segstart;                // record memory start address of the running segment
+	uint segread;                 // records of the running segment read up to, see pollSegment
+	uint drainstart, drainend;    // records of the finished, not yet drained segment
+	void finishSegment();         // sets the drain range to the records of the running segment
+
+	// appends the events of the record memory words to ev, skipping time stamps and CI answers
+	void decodeEvents(const uint64_t* words, uint num, vector<IData>& ev);
+
+	void init(); // common part of the constructors
+
+	// instrumentation of the current experiment
+	ExpStats stats;
+	std::string statslog;
+	void logStats(); // append stats to statslog
+
 public:
 	vector<IData>* rcvd(uint c) { return &(rcvev[c]); }; // received events
 	vector<IData>* eev(uint c) { return sc->eev(c); };   // dropped/modified events
+	vector<uint>* eshift(uint c) { return sc->eshift(c); }; // time shift of modified events
+	//! received events whose time relies on a wrap around decision that could also be explained
+	//! by events out of order, cleared by Clear()
+	vector<IData>* ambiguous(uint c) { return &(ambev[c]); };
 
 	boost::shared_ptr<SC_SlowCtrl> getSCTRL() { return sc; };
 
 	// look like sc_sctrl to the outside world
 	SC_Mem(uint time = 0, std::string workstation = "");
-	virtual ~SC_Mem(){};
+	//! use an already constructed slow control, e.g. SC_Emulator for tests without hardware
+	SC_Mem(boost::shared_ptr<SC_SlowCtrl> sctrl);
+	virtual ~SC_Mem();
 
 	virtual void resetFlushed() { flushed = false; }
 
 	virtual Commstate Send(Mode mode, IData data = emptydata, uint del = 0, uint chip = 0,
 	                       uint syncoffset = 0);
 	virtual Commstate Receive(Mode mode, IData& data, uint chip = 0);
+	//! answers of reads registered here are routed to their reply and not returned by Receive
+	virtual boost::shared_ptr<CIReply> expectReply(ControlInterface* ci);
+	virtual Commstate waitReply(CIReply& r, uint chip = 0);
 	virtual Commstate Flush(uint chip);
 	virtual Commstate Run();
 	virtual Commstate Clear() { return intClear(); };
@@ -113,14 +218,71 @@ public:
 	// -> DO NOT execute intClear when/before using this function as memory content could be
 	// overwritten subsequently!!!
 	void savePbContent();
+	void savePbContent(SC_Transaction& t); // appends the register reads to t
+	void storePbContent(const SC_Transaction& t); // stores the reads of t after the commit
 	void recallPbContent(); // recalls results from savePbContent()
+	void recallPbContent(SC_Transaction& t); // appends the register writes to t
 	void reFlush();         // re-executes a recalled playback memory program
 
 	// wait until playback memory is idle and update write pointer
 	void waitIdle();
 
+	//! executes the flushed playback memory program n times without transferring it again, the
+	//! results of all repetitions are appended to the record memory. Replaces Run(). Throws if
+	//! n is 0 or if, judged by the repetitions so far, the records of all n would not fit into
+	//! the record memory.
+	void runRepeated(uint n);
+	//! waits for the last repetition started by runRepeated and decodes the received events of
+	//! each repetition into ev[repetition]. CI answers are discarded, Clear() before the next
+	//! experiment.
+	void recRepeated(vector<vector<IData> >& ev);
+
+	//! Streaming of experiments that do not fit into the playback or record memory as a sequence
+	//! of segments, each with a program of up to pbhalf words and records of up to rechalf words
+	//! (0: half of the memory). Both memories are used as double buffers: Flush uploads the
+	//! program of the next segment into one half while the current segment runs from the other,
+	//! Run waits for the current segment and starts the uploaded one, and drainSegment reads the
+	//! records of the finished segment while the next one runs. The FPGA cannot wrap its pointers
+	//! or chain programs, so consecutive segments are separated by the restart from the host.
+	//! Clears all queues, CI answers are discarded. Clear() ends streaming.
+	void startStream(uint pbhalf = 0, uint rechalf = 0);
+	bool isStreaming() { return streaming; };
+	//! waits for the last started segment, its events are returned by the next drainSegment
+	void endStream();
+	//! appends the events of the segment finished by the last Run or endStream to ev, returns
+	//! false if there is none or it has already been drained
+	bool drainSegment(vector<IData>& ev);
+	//! appends the events the running segment has recorded since the last call to ev without
+	//! waiting, returns true once the segment has finished and all its events have been returned.
+	//! Throws on FIFO errors or a full record memory half.
+	bool pollSegment(vector<IData>& ev);
+
 	uint getWadr() { return wadr; };
+
+	//! if enabled (default), waitIdle sleeps until shortly before the predicted end of the playback
+	//! memory program and then polls with exponential back-off, otherwise it polls continuously
+	void setPredictIdle(bool on) { predictidle = on; };
+
+	// per experiment timing and counters, reset by Clear()
+	const ExpStats& getStats() { return stats; };
+	void resetStats() { stats.reset(); };
+	//! append the stats of each experiment as a JSON line to file filename, empty to disable
+	void setStatsLog(std::string filename) { statslog = filename; };
 	std::string getWorkStationName() { return sc->getWorkStationName(); }
+
+	//! if n > 0, Receive holds back up to n decoded events and releases them in time order, so
+	//! the received events are sorted without a separate pass. Events older than the window are
+	//! inserted at their position and counted in ExpStats::evlate.
+	void setReorderWindow(uint n) { reorderwin = n; };
+	uint getReorderWindow() { return reorderwin; };
+
+	//! per-neuron index filled while decoding received events of chip, NULL to disable
+	void setSpikeIndex(boost::shared_ptr<SpikeIndex> i, uint chip = 0)
+	{
+		spindex = i;
+		spindexchip = chip;
+	};
+	boost::shared_ptr<SpikeIndex> getSpikeIndex() { return spindex; };
 };
 
 } // end of namespace spikey2
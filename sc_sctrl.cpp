@@ -5,11 +5,13 @@
 #include "sncomm.h"
 #include "spikenet.h" //communication and chip classes
 #include "sc_sctrl.h"
+#include "sc_pbdisasm.h"
 
 #include <algorithm>
 #include <gsl/gsl_rng.h>
 #include <gsl/gsl_randist.h>
 #include <cassert>
+#include <chrono>
 #include <limits>
 
 static log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("HAL.Ctr");
@@ -67,9 +69,6 @@ SC_SlowCtrl::SC_SlowCtrl(uint time, std::string workstation)
 			throw std::runtime_error(msg);
 	}
 
-	for (int i = 0; i < 16; i++)
-		ltime[i] = 0;
-
 	// create sp6 class tree
 	usb = new Vusbmaster(io);
 	// usbmaster knows three clients, must be in this order!!!
@@ -89,7 +88,55 @@ SC_SlowCtrl::SC_SlowCtrl(uint time, std::string workstation)
 	spydac = new Vspikeydac(ocp, boardVersion);
 	muxboard = new Vmux_board(ocp, muxboardMode);
 
+	init(time);
+}
+
+SC_SlowCtrl::SC_SlowCtrl(std::string type, uint time, uint chipversion)
+    : SpikenetComm(type),
+      dbg(::Logger::instance()),
+      chipVersion(chipversion),
+      io(NULL),
+      usb(NULL),
+      status(NULL),
+      mem(NULL),
+      ocp(NULL),
+      confrom(NULL),
+      gyro(NULL),
+      wireless(NULL),
+      spyctrl(NULL),
+      spypbm(NULL),
+      spydc(NULL),
+      spy_slowadc(NULL),
+      fadc(NULL),
+      spydac(NULL),
+      muxboard(NULL),
+      T(gsl_rng_default),
+      rng(gsl_rng_alloc(T))
+{
+	work_station_name = type;
+	updateHwConst(chipVersion);
+	if (!hw_const) {
+		string msg = "Invalid spikey chip version!";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	init(time);
+}
+
+void SC_SlowCtrl::init(uint time)
+{
+	for (int i = 0; i < 16; i++)
+		ltime[i] = 0;
+
 	usedpcktslots = 3;
+	shiftlate = false;
+	wrapambiguous = false;
+	lastaccess = 0;
+	telerunning = false;
+	teleperiod = teleidle = 0;
+	telemax = 0;
+	dryrun = false;
+	dryruncmds = 0;
 
 	// config STDP
 	first_proc_corr = 0;
@@ -109,9 +156,12 @@ SC_SlowCtrl::SC_SlowCtrl(uint time, std::string workstation)
 
 SC_SlowCtrl::~SC_SlowCtrl()
 {
+	stopTelemetry();
+
 	// TP (04.05.2015): supply voltage should ideally be checked in constructor,
 	// but this does not work, see issue #1694
-	if (boardVersion >= 2) {
+	// (derived classes without hardware access are already destroyed at this point)
+	if (io != NULL && boardVersion >= 2) {
 		checkSupplyVoltage();
 	}
 
@@ -165,7 +215,7 @@ SpikenetComm::Commstate SC_SlowCtrl::Send(Mode m, IData data, uint del, uint chi
 				    ((mmw(hw_const->ctl_delval_width()) & delval) << hw_const->sg_scdelval_pos()) |
 				    ((mmw(hw_const->ctl_deladdr_width()) & deladdr)
 				     << hw_const->sg_scdeladdr_pos());
-				spyctrl->write(hw_const->sg_scdelay(), dout);
+				writeSC(dout, hw_const->sg_scdelay());
 			} else if (data.isControl()) {
 				uint dout = ((data.reset() << hw_const->sg_scrst_pos()) |
 				             (data.cimode() << hw_const->sg_sccim_pos()) |
@@ -175,13 +225,13 @@ SpikenetComm::Commstate SC_SlowCtrl::Send(Mode m, IData data, uint del, uint chi
 				             (data.vm_gnd() << hw_const->sg_scvm_pos()) |
 				             (data.ibtest_meas() << hw_const->sg_scibtest_pos()) |
 				             (data.power_enable() << hw_const->sg_scpower_pos()));
-				spyctrl->write(hw_const->sg_scmode(), dout);
+				writeSC(dout, hw_const->sg_scmode());
 			} else if (data.isPhsel()) {
 				uint dout = ((data.rx_dat0_phase() << hw_const->sg_rxd0_phsel_pos()) |
 				             (data.rx_dat1_phase() << hw_const->sg_rxd1_phsel_pos()) |
 				             (data.rx_clk0_phase() << hw_const->sg_rxc0_phsel_pos()) |
 				             (data.rx_clk1_phase() << hw_const->sg_rxc1_phsel_pos()));
-				spyctrl->write(hw_const->sg_scphsel(), dout);
+				writeSC(dout, hw_const->sg_scphsel());
 			}
 			break;
 		case read:
@@ -279,6 +329,7 @@ SpikenetComm::Commstate SC_SlowCtrl::RecSBD(Mode m, SBData& data, uint chip)
 // access the spikey Slow Control interface's registers
 SpikenetComm::Commstate SC_SlowCtrl::writeSC(uint data, uint addr)
 {
+	BusLock lock = lockBus();
 	LOG4CXX_TRACE(logger, "SC_SlowCtrl::writeSC address:" << hex << addr << " data:" << hex
 	                                                      << data);
 	spyctrl->write(addr & 0xfff, data);
@@ -287,6 +338,7 @@ SpikenetComm::Commstate SC_SlowCtrl::writeSC(uint data, uint addr)
 
 SpikenetComm::Commstate SC_SlowCtrl::readSC(uint& data, uint addr)
 {
+	BusLock lock = lockBus();
 	LOG4CXX_TRACE(logger, "SC_SlowCtrl::readSC address:" << hex << addr << " ");
 	data = spyctrl->read(addr & 0xfff);
 	LOG4CXX_TRACE(logger, " data:0x" << hex << data);
@@ -296,6 +348,7 @@ SpikenetComm::Commstate SC_SlowCtrl::readSC(uint& data, uint addr)
 // access the spikey Playback Memory control registers
 SpikenetComm::Commstate SC_SlowCtrl::writePBC(uint data, uint addr)
 {
+	BusLock lock = lockBus();
 	LOG4CXX_TRACE(logger, "SC_SlowCtrl::writePBC address:" << hex << addr << " data:" << hex
 	                                                       << data);
 	spypbm->write(addr & 0xfff, data);
@@ -304,12 +357,127 @@ SpikenetComm::Commstate SC_SlowCtrl::writePBC(uint data, uint addr)
 
 SpikenetComm::Commstate SC_SlowCtrl::readPBC(uint& data, uint addr)
 {
+	BusLock lock = lockBus();
 	LOG4CXX_TRACE(logger, "SC_SlowCtrl::readPBC address:" << hex << addr << " ");
 	data = spypbm->read(addr & 0xfff);
 	LOG4CXX_TRACE(logger, " data: 0x" << hex << data);
 	return ok;
 }
 
+void SC_Transaction::write(Target t, uint addr, uint data)
+{
+	Access a = {t, false, addr, data, ~0u, false};
+	acc.push_back(a);
+	done = false;
+}
+
+uint SC_Transaction::read(Target t, uint addr, uint mask)
+{
+	Access a = {t, true, addr, 0, mask, false};
+	acc.push_back(a);
+	done = false;
+	return acc.size() - 1;
+}
+
+uint SC_Transaction::result(uint h) const
+{
+	if (!done || h >= acc.size() || !acc[h].read) {
+		string msg = "SC_Transaction::result: no result for handle " + to_str(h) +
+		             (done ? "" : ", transaction not committed");
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	return acc[h].data;
+}
+
+// the accesses go through the virtual register methods, so that derived classes (emulator, trace
+// recorder and replay) see the same sequence as without transaction
+void SC_SlowCtrl::commit(SC_Transaction& t)
+{
+	BusLock lock = lockBus();
+	LOG4CXX_TRACE(logger, "SC_SlowCtrl::commit: " << t.acc.size() << " accesses");
+	for (auto& a : t.acc) {
+		if (a.read) {
+			uint d = 0;
+			if (a.target == SC_Transaction::sc)
+				readSC(d, a.addr);
+			else
+				readPBC(d, a.addr);
+			a.data = d & a.mask;
+		} else if (a.target == SC_Transaction::sc) {
+			writeSC(a.data, a.addr);
+		} else if (a.reset) {
+			resetPlayback();
+		} else {
+			writePBC(a.data, a.addr);
+		}
+	}
+	t.done = true;
+}
+
+// write to FlySpi memory in chunks
+void SC_SlowCtrl::writeMem(uint adr, const uint64_t* data, uint num)
+{
+	BusLock lock = lockBus();
+	uint maxchunksize = getMaxChunkSize();
+	uint chunks = (num * 2) / maxchunksize + 1;
+	uint chunkstart = adr * 2; // vbuf addresses are 32bit aligned
+	uint chunksize = 0;
+	for (uint chunk = 0; chunk < chunks; chunk++) {
+		// cut addresses to fit in chunks
+		uint virtChunksize = num * 2 - (chunkstart - adr * 2);
+		if (virtChunksize > maxchunksize)
+			chunksize = maxchunksize;
+		else
+			chunksize = virtChunksize;
+
+		LOG4CXX_TRACE(logger, hex << "SC_SlowCtrl::writeMem: chunks: " << chunks
+		                          << ", chunkstart: " << chunkstart
+		                          << ", chunksize: " << chunksize);
+		Vbufuint_p pbsend = mem->writeBlock(chunkstart, chunksize);
+		// copy data to Vmemory buffer...
+		for (uint i = 0; i < chunksize / 2; i++) {
+			pbsend[2 * i] = data[i + chunkstart / 2 - adr] & (uint64_t)0xffffffff;
+			pbsend[2 * i + 1] = (data[i + chunkstart / 2 - adr] >> 32) & (uint64_t)0xffffffff;
+		}
+		mem->doWB();
+		chunkstart = chunkstart + chunksize;
+	}
+}
+
+// read from FlySpi memory in chunks
+void SC_SlowCtrl::readMem(uint adr, uint num, vector<uint64_t>& buf)
+{
+	BusLock lock = lockBus();
+	uint maxchunksize = getMaxChunkSize();
+	uint chunks = (num * 2) / maxchunksize + 1;
+	uint chunkstart = adr * 2; // addresses are 64bit aligned, but vbuf 32bit
+	uint chunksize = 0;
+	for (uint chunk = 0; chunk < chunks; chunk++) {
+		// cut addresses to fit in chunks
+		uint virtChunksize = num * 2 - (chunkstart - adr * 2);
+		if (virtChunksize > maxchunksize)
+			chunksize = maxchunksize;
+		else
+			chunksize = virtChunksize;
+		Vbufuint_p recbuf = mem->readBlock(chunkstart, chunksize);
+		for (uint i = 0; i < (chunksize / 2); i++) {
+			uint64_t temp = 0;
+			temp = (uint64_t)recbuf[2 * i] & 0xffffffff;
+			temp |= (uint64_t)recbuf[2 * i + 1] << 32;
+			buf.push_back(temp);
+		}
+		chunkstart = chunkstart + chunksize;
+	}
+}
+
+void SC_SlowCtrl::writeDelcfg(uint data)
+{
+	BusLock lock = lockBus();
+	LOG4CXX_TRACE(logger, "SC_SlowCtrl::writeDelcfg data:" << hex << data);
+	spydc->write(0, data);
+}
+
 // function to display
 // playback memory content
 void SC_SlowCtrl::printPBMem()
@@ -324,9 +492,10 @@ void SC_SlowCtrl::printPBMem()
 	    (endwaddr & mmw(hw_const->sg_sc_wadrw())) - (startwaddr & mmw(hw_const->sg_sc_wadrw()));
 	LOG4CXX_TRACE(logger, "Playback memory write start address is: " << hex << startwaddr);
 	LOG4CXX_TRACE(logger, "Playback memory entry count           : " << hex << entries);
+	vector<uint64_t> content;
+	readMem(startwaddr, entries, content);
 	for (uint i = 0; i < entries; i++) {
-		entry = (uint64_t)mem->read(2 * (startwaddr + i));
-		entry |= (uint64_t)mem->read(2 * (startwaddr + i) + 1) << 32;
+		entry = content[i];
 		if (entry & 1ULL) { // entry is event packet
 			binout(cout, (entry >> (2 * hw_const->sg_ev_evsize() + hw_const->sg_ev_evbase())),
 			       hw_const->sg_ev_evsize());
@@ -349,65 +518,49 @@ void SC_SlowCtrl::printPBMem()
 	}
 }
 
-// setup playback memory addresses and insert a dummy delay packet
-// if playback memory contains an odd number of entries
-void SC_SlowCtrl::setupSend(uint rstartadr, uint chipid)
+// setup playback memory addresses
+void SC_SlowCtrl::setupSend(uint rstartadr, uint chipid, SC_Transaction& t)
+{
+	uint numread = uploadSend(rstartadr);
+
+	LOG4CXX_TRACE(logger, "SC_SlowCtrl::setupSend: set PBM to read num = 0x" << hex
+	                                                                         << (numread >> 1));
+
+	t.setNumRead(numread >> 1); // read client "counts" in 128bit accesses -> div. number to be
+	                            // read by 2!
+	t.setRadr(rstartadr);
+	t.setChipid(chipid);
+}
+
+// insert a dummy delay packet if playback memory contains an odd number of entries
+uint SC_SlowCtrl::uploadSend(uint rstartadr)
 {
-	LOG4CXX_TRACE(logger, "setupSend: PBM pointer: 0x" << hex << pbradr() << ", PB start addr: 0x"
-	                                                   << hex << rstartadr);
+	LOG4CXX_TRACE(logger, "uploadSend: PBM pointer: 0x" << hex << pbradr() << ", PB start addr: 0x"
+	                                                    << hex << rstartadr);
 	uint numread = pbradr() - rstartadr;
 	if (numread % 2) {
-		LOG4CXX_TRACE(logger, "SC_SlowCtrl::setupSend: inserting dummy delay command at end to "
+		LOG4CXX_TRACE(logger, "SC_SlowCtrl::uploadSend: inserting dummy delay command at end to "
 		                      "obtain even number of entries");
 		pbEvtdel(1); // dummy to accomplish even number of playback memory entries
 		numread += 1;
 	}
 
-	if (dbg.getLevel() == ::Logger::DEBUG3) {
-		LOG4CXX_TRACE(logger, "SC_SlowCtrl::setupSend: sdrambuf content:");
-		for (uint i = 0; i < numread; i++) {
-			LOG4CXX_TRACE(logger, hex << setfill('0') << right << "A: 0x" << setw(8) << i
-			                          << " | D: 0x" << setw(16) << (uint64_t)sdrambuf[i]);
+	if (dbg.getLevel() == ::Logger::DEBUG3 || !programdump.empty()) {
+		vector<uint64_t> prog(sdrambuf.begin(), sdrambuf.begin() + numread);
+		if (dbg.getLevel() == ::Logger::DEBUG3) {
+			std::ostringstream o;
+			PbDisassembler(hw_const).print(prog, o);
+			LOG4CXX_TRACE(logger, "SC_SlowCtrl::uploadSend: sdrambuf content:\n" << o.str());
 		}
+		if (!programdump.empty() && !PbDisassembler::save(programdump, prog, hw_const->revision()))
+			LOG4CXX_WARN(logger, "SC_SlowCtrl::uploadSend: could not write " << programdump);
 	}
 
 	// send buffer to playback memory
-	uint maxchunksize = getMaxChunkSize();
-	uint chunks = (numread * 2) / maxchunksize + 1;
-	uint chunkstart = rstartadr * 2; // vbuf addresses are 32bit aligned
-	uint chunksize = 0;
-	for (uint chunk = 0; chunk < chunks; chunk++) {
-		// cut addresses to fit in chunks
-		uint virtChunksize = numread * 2 - (chunkstart - rstartadr * 2);
-		if (virtChunksize > maxchunksize)
-			chunksize = maxchunksize;
-		else
-			chunksize = virtChunksize;
-
-		LOG4CXX_TRACE(logger, hex << "SC_SlowCtrl::setupSend: chunks: " << chunks
-		                          << ", chunkstart: " << chunkstart
-		                          << ", chunksize: " << chunksize);
-		Vbufuint_p pbsend = mem->writeBlock(chunkstart, chunksize);
-		// copy sdrambuf to Vmemory buffer...
-		for (uint i = 0; i < chunksize / 2; i++) {
-			pbsend[2 * i] = sdrambuf[i + chunkstart / 2 - rstartadr] & (uint64_t)0xffffffff;
-			pbsend[2 * i + 1] =
-			    (sdrambuf[i + chunkstart / 2 - rstartadr] >> 32) & (uint64_t)0xffffffff;
-			// dbg(::Logger::DEBUG3) << hex << setfill('0') << right << "A: 0x" << setw(8) << i << "
-			// | D: 0x" << setw(16) << (uint64_t)sdrambuf[i+chunkstart/2-rstartadr];
-		}
-		mem->doWB();
-		chunkstart = chunkstart + chunksize;
-	}
+	if (numread > 0)
+		writeMem(rstartadr, &sdrambuf[0], numread);
 	sdrambufvalid = false;
-
-	LOG4CXX_TRACE(logger, "SC_SlowCtrl::setupSend: set PBM to read num = 0x" << hex
-	                                                                         << (numread >> 1));
-
-	setNumRead(numread >> 1); // read client "counts" in 128bit accesses -> div. number to be read
-	                          // by 2!
-	setRadr(rstartadr);
-	setChipid(chipid);
+	return numread;
 }
 
 void SC_SlowCtrl::startPlayback()
@@ -447,6 +600,7 @@ void SC_SlowCtrl::setAnaMux(std::bitset<3> inputselect)
 
 void SC_SlowCtrl::setAnaMux(Vmux_board::mux_input inputselect)
 {
+	BusLock lock = lockBus();
 	muxboard->set_Mux(inputselect);
 }
 
@@ -604,11 +758,15 @@ void SC_SlowCtrl::translate(const uint64_t& r, IData& d, uint& evmask)
 						evtime = (r >> (i * hw_const->sg_ev_evsize() + hw_const->sg_ev_evbase())) &
 						         mmw(hw_const->sg_etimewidth() + hw_const->sg_efinewidth());
 						uint evtimeclk = evtime >> hw_const->sg_efinewidth();
+						wrapambiguous = false;
 
 						if (levtimeclk >= 0) {
 							if ((levtimeclk & 0xf0) >
 							    (int)(evtimeclk & 0xf0)) { // ignore lower nibble of eventclk, might
 							                               // not be in ascending order
+								// a step back by one nibble may as well be reordering across a
+								// nibble boundary
+								wrapambiguous = ((levtimeclk & 0xf0) - (evtimeclk & 0xf0)) == 0x10;
 								lsystime += (1 << hw_const->sg_etimewidth());
 								LOG4CXX_TRACE(logger, "SC_SlowCtrl::translate: Systime incremented:"
 								                          << hex << lsystime);
@@ -617,7 +775,8 @@ void SC_SlowCtrl::translate(const uint64_t& r, IData& d, uint& evmask)
 								// between two events
 								// equals 0xf0 and no time stamp has been received (is the case in
 								// this condition).
-								if (((evtimeclk & 0xf0) - (levtimeclk & 0xf0)) & 0xf0 == 0xf0) {
+								wrapambiguous = ((evtimeclk & 0xf0) - (levtimeclk & 0xf0)) == 0xf0;
+								if ((((evtimeclk & 0xf0) - (levtimeclk & 0xf0)) & 0xf0) == 0xf0) {
 									lsystime -= (1 << hw_const->sg_etimewidth());
 									LOG4CXX_WARN(logger, "SC_SlowCtrl::translate: Systime "
 									                     "decremented as no timestamp received! "
@@ -761,6 +920,67 @@ are
 //
 // TP (03.05.2011): Note that clock is running with 100MHz/200MHz instead of 200MHz/400MHz
 // 20000 200MHz clock cycles = 1s in biology at speedup 10^4
+// writes the event command and packets for the events collected in cv by pbEvt
+void SC_SlowCtrl::pbEvtEmit(vector<IData>& cv, uint cstart, uint systime, uint chip)
+{
+	// evt command with appropriate size and delay
+	uint ecdel = (systime - cstart) >> 1;
+	uint ecsize = (cv.size() % 3) ? (cv.size() / 3 + 1) : cv.size() / 3;
+	uint evmask = (cv.size() % 3) ? cv.size() % 3 : 3;
+	LOG4CXX_TRACE(logger, "SC_SlowCtrl::pbEvt: Ev. cmd at systime 0x" << hex << cstart << ": "
+	                                                                  << dec << cv.size()
+	                                                                  << " events. Time: 0x" << hex
+	                                                                  << ecdel);
+	pbEvtcmd(evmask, ecsize, ecdel);
+	if (dryrun) {
+		dryruncmds++;
+		for (uint j = 0; j < cv.size(); j++)
+			dryrunev.push_back(make_pair(cstart + 2 * (j / usedpcktslots + 1), cv[j]));
+	}
+
+	// generate playback memory "packets" containing one event each
+	for (uint j = 0; j < cv.size(); j += usedpcktslots) {
+		bool useSlot1, useSlot2;
+
+		useSlot1 = (j + 1 < cv.size()) && (usedpcktslots >= 2);
+		useSlot2 = (j + 2 < cv.size()) && (usedpcktslots >= 3);
+
+		pbEvtpct(cv[j].time(), cv[j].neuronAdr(), // event 1 data
+		         useSlot1 ? cv[j + 1].time() : 0,
+		         useSlot1 ? cv[j + 1].neuronAdr() : 0, // event 2 data
+		         useSlot2 ? cv[j + 2].time() : 0,
+		         useSlot2 ? cv[j + 2].neuronAdr() : 0); // event 3 data
+
+		// use this vector for event checking only if playback mem is used!!!
+		uint s;
+		if (j + usedpcktslots < cv.size())
+			s = usedpcktslots % 3;
+		else
+			s = cv.size() % 3; // usedpcktslots;
+
+		// generate sent events vector; missing BREAK is intentional!
+		switch (s) {
+			case 0:
+				LOG4CXX_TRACE(logger, "SC_SlowCtrl::pbEvt: 3rd event of packet: " << cv[j + 2]);
+				cv[j + 2].setTime() =
+				    cv[j + 2].time() + ((2 * hw_const->el_depth() + hw_const->el_offset()) << 4);
+				sendev[chip].push_back(cv[j + 2]);
+
+			case 2:
+				LOG4CXX_TRACE(logger, "SC_SlowCtrl::pbEvt: 2nd event of packet: " << cv[j + 1]);
+				cv[j + 1].setTime() =
+				    cv[j + 1].time() + ((2 * hw_const->el_depth() + hw_const->el_offset()) << 4);
+				sendev[chip].push_back(cv[j + 1]);
+
+			case 1:
+				LOG4CXX_TRACE(logger, "SC_SlowCtrl::pbEvt: 1st event of packet: " << cv[j]);
+				cv[j].setTime() =
+				    cv[j].time() + ((2 * hw_const->el_depth() + hw_const->el_offset()) << 4);
+				sendev[chip].push_back(cv[j]);
+		}
+	}
+}
+
 void SC_SlowCtrl::pbEvt(vector<IData>& evt, uint& newstime, uint stime, uint chip)
 {
 	//***** 1. DEFINE PARAMETERS *****//
@@ -803,7 +1023,6 @@ void SC_SlowCtrl::pbEvt(vector<IData>& evt, uint& newstime, uint stime, uint chi
 	//***** EVENT PROCESSING *****//
 
 	uint nexti;
-	uint ecdel;
 	vector<IData> cv;
 	IData current;
 
@@ -857,13 +1076,27 @@ void SC_SlowCtrl::pbEvt(vector<IData>& evt, uint& newstime, uint stime, uint chi
 		                                    // (diversification of 4 bit excluded)
 
 		// check if systime becomes late relative to normed event time
+		bool shifted = false;
 		if (systime > cnormedtime) {
-			LOG4CXX_TRACE(logger, "Event dropped (event rate exceeds link capacity) -> Systime: "
-			                          << dec << systime << ", Normed time: " << cnormedtime
-			                          << ", Event no. " << dec << i << ": " << current
-			                          << ". - dropping event.");
-			errev[chip].push_back(current);
-			continue;
+			if (!shiftlate) {
+				LOG4CXX_TRACE(logger,
+				              "Event dropped (event rate exceeds link capacity) -> Systime: "
+				                  << dec << systime << ", Normed time: " << cnormedtime
+				                  << ", Event no. " << dec << i << ": " << current
+				                  << ". - dropping event.");
+				errev[chip].push_back(current);
+				errshift[chip].push_back(0);
+				continue;
+			}
+			// earliest time the event can still be sent, keep the time bin. As the events are
+			// encoded in time order, later events that fall behind are shifted to the same
+			// link slot or after it.
+			current.setTime() = ((systime + getEvtLatency()) << hw_const->ev_tb_width()) |
+			                    (current.time() & mmw(hw_const->ev_tb_width()));
+			cnormedtime = systime;
+			shifted = true;
+			LOG4CXX_TRACE(logger, "Event shifted (event rate exceeds link capacity) by "
+			                          << dec << (current.time() - evt[i].time()) << ": " << evt[i]);
 		}
 
 		LOG4CXX_TRACE(logger, "SC_SlowCtrl::pbEvt: Event for address " << hex << current.neuronAdr()
@@ -1067,62 +1300,7 @@ void SC_SlowCtrl::pbEvt(vector<IData>& evt, uint& newstime, uint stime, uint chi
 				    !(cv.size() < (1 << hw_const->sg_ev_numevw()) - 1) || i == evt.size() - 1 ||
 				    gencmd) {
 
-					// evt command with appropriate size and delay
-					ecdel = (systime - cstart) >> 1;
-					uint ecsize = (cv.size() % 3) ? (cv.size() / 3 + 1) : cv.size() / 3;
-					uint evmask = (cv.size() % 3) ? cv.size() % 3 : 3;
-					LOG4CXX_TRACE(logger, "SC_SlowCtrl::pbEvt: Ev. cmd at systime 0x"
-					                          << hex << cstart << ": " << dec << cv.size()
-					                          << " events. Time: 0x" << hex << ecdel);
-					pbEvtcmd(evmask, ecsize, ecdel);
-
-					// generate playback memory "packets" containing one event each
-					for (uint j = 0; j < cv.size(); j += usedpcktslots) {
-						bool useSlot1, useSlot2;
-
-						useSlot1 = (j + 1 < cv.size()) && (usedpcktslots >= 2);
-						useSlot2 = (j + 2 < cv.size()) && (usedpcktslots >= 3);
-
-						pbEvtpct(cv[j].time(), cv[j].neuronAdr(), // event 1 data
-						         useSlot1 ? cv[j + 1].time() : 0,
-						         useSlot1 ? cv[j + 1].neuronAdr() : 0, // event 2 data
-						         useSlot2 ? cv[j + 2].time() : 0,
-						         useSlot2 ? cv[j + 2].neuronAdr() : 0); // event 3 data
-
-						// use this vector for event checking only if playback mem is used!!!
-						uint s;
-						if (j + usedpcktslots < cv.size())
-							s = usedpcktslots % 3;
-						else
-							s = cv.size() % 3; // usedpcktslots;
-
-						// generate sent events vector; missing BREAK is intentional!
-						switch (s) {
-							case 0:
-								LOG4CXX_TRACE(logger, "SC_SlowCtrl::pbEvt: 3rd event of packet: "
-								                          << cv[j + 2]);
-								cv[j + 2].setTime() =
-								    cv[j + 2].time() +
-								    ((2 * hw_const->el_depth() + hw_const->el_offset()) << 4);
-								sendev[chip].push_back(cv[j + 2]);
-
-							case 2:
-								LOG4CXX_TRACE(logger, "SC_SlowCtrl::pbEvt: 2nd event of packet: "
-								                          << cv[j + 1]);
-								cv[j + 1].setTime() =
-								    cv[j + 1].time() +
-								    ((2 * hw_const->el_depth() + hw_const->el_offset()) << 4);
-								sendev[chip].push_back(cv[j + 1]);
-
-							case 1:
-								LOG4CXX_TRACE(logger,
-								              "SC_SlowCtrl::pbEvt: 1st event of packet: " << cv[j]);
-								cv[j].setTime() =
-								    cv[j].time() +
-								    ((2 * hw_const->el_depth() + hw_const->el_offset()) << 4);
-								sendev[chip].push_back(cv[j]);
-						}
-					}
+					pbEvtEmit(cv, cstart, systime, chip);
 					cstart = systime; // next cmd starts at current systime
 					systime += 2;     // incr systime to include the next event command
 					cv.clear();
@@ -1135,13 +1313,34 @@ void SC_SlowCtrl::pbEvt(vector<IData>& evt, uint& newstime, uint stime, uint chi
 			// simultaneous event? increase event's time and try again
 			current.setTime() = current.time() + (1 << hw_const->ev_tb_width());
 		}
+		if (shifted) {
+			errev[chip].push_back(current);
+			errshift[chip].push_back(current.time() - evt[i].time());
+		}
 		newstime = systime >> 1;
 	}
+	// the last events were dropped while a command was still open
+	if (cv.size()) {
+		pbEvtEmit(cv, cstart, systime, chip);
+		newstime = (systime + 2) >> 1;
+	}
 
-	if (errev[chip].size() > 0) {
-		LOG4CXX_WARN(logger, "Number of lost input spikes due to limited input bandwidth: "
-		                         << errev[chip].size() << " of " << evt.size() << " ("
-		                         << 100.0 * errev[chip].size() / evt.size() << "%)");
+	if (errev[chip].size() > 0 && !dryrun) {
+		if (shiftlate) {
+			uint64_t sum = 0;
+			uint maxshift = 0;
+			for (uint i = 0; i < errshift[chip].size(); i++) {
+				sum += errshift[chip][i];
+				maxshift = max(maxshift, errshift[chip][i]);
+			}
+			LOG4CXX_WARN(logger, "Number of delayed input spikes due to limited input bandwidth: "
+			                         << errev[chip].size() << " of " << evt.size()
+			                         << ", mean shift " << (double)sum / errshift[chip].size()
+			                         << ", max shift " << maxshift);
+		} else
+			LOG4CXX_WARN(logger, "Number of lost input spikes due to limited input bandwidth: "
+			                         << errev[chip].size() << " of " << evt.size() << " ("
+			                         << 100.0 * errev[chip].size() / evt.size() << "%)");
 	}
 
 	// insert delay command to let potentially filled event out buffers run empty.
@@ -1162,8 +1361,116 @@ void SC_SlowCtrl::pbEvt(vector<IData>& evt, uint& newstime, uint stime, uint chi
 	}
 }
 
+LinkReport::LinkReport()
+    : events(0),
+      dropped(0),
+      shifted(0),
+      commands(0),
+      words(0),
+      duration(0),
+      maxpending(0),
+      maxpendingbuf(0),
+      end(0),
+      minend(0)
+{
+	for (uint b = 0; b < 16; b++)
+		bufdropped[b] = bufpending[b] = 0;
+}
+
+// Runs pbEvt with writeBuf disabled, once as configured and, unless late events are shifted
+// anyway, once more shifting them to get the minimum length. Input buffer occupancy is
+// reconstructed from the time each event packet is sent and the time the event is due.
+void SC_SlowCtrl::analyzeEvt(const vector<IData>& evt, LinkReport& r, uint stime, uint chip)
+{
+	// save encoder state changed by pbEvt
+	uint oldpbradr = pbradr();
+	uint oldltime[16];
+	for (uint b = 0; b < 16; b++)
+		oldltime[b] = ltime[b];
+	bool oldcorr = cont_proc_corr, oldshift = shiftlate;
+	size_t numerr = errev[chip].size(), numshift = errshift[chip].size();
+	vector<IData> oldsendev;
+	oldsendev.swap(sendev[chip]);
+
+	r = LinkReport();
+	r.events = evt.size();
+	for (uint i = 0; i < evt.size(); i++)
+		r.end = max(r.end, (uint64_t)evt[i].time());
+
+	dryrun = true;
+	for (uint pass = 0; pass < (oldshift ? 1u : 2u); pass++) {
+		vector<IData> ev(evt);
+		uint newstime = stime;
+		setPbradr(oldpbradr);
+		for (uint b = 0; b < 16; b++)
+			ltime[b] = 0; // as after pbSync
+		cont_proc_corr = oldcorr;
+		shiftlate = oldshift || pass == 1;
+		dryruncmds = 0;
+		dryrunev.clear();
+
+		pbEvt(ev, newstime, stime, chip);
+
+		for (uint i = 0; i < dryrunev.size(); i++)
+			r.minend = max(r.minend, (uint64_t)dryrunev[i].second.time());
+		if (pass == 0) {
+			for (size_t i = numerr; i < errev[chip].size(); i++) {
+				if (errshift[chip][numshift + i - numerr]) {
+					r.shifted++;
+					continue;
+				}
+				const IData& e = errev[chip][i];
+				r.dropped++;
+				r.bufdropped[((e.neuronAdr() >> hw_const->ev_bufaddrwidth()) << 1) |
+				             ((e.time() >> hw_const->ev_tb_width()) & 1)]++;
+			}
+			r.commands = dryruncmds;
+			r.words = pbradr() - oldpbradr;
+			r.duration = newstime - stime;
+
+			// an event occupies its buffer from the time its packet is sent until it is due
+			vector<pair<uint, int> > change[16];
+			for (uint i = 0; i < dryrunev.size(); i++) {
+				const IData& e = dryrunev[i].second;
+				uint b = ((e.neuronAdr() >> hw_const->ev_bufaddrwidth()) << 1) |
+				         ((e.time() >> hw_const->ev_tb_width()) & 1);
+				uint due = (e.time() >> hw_const->ev_tb_width()) - getEvtLatency(chip);
+				change[b].push_back(make_pair(dryrunev[i].first, 1));
+				change[b].push_back(make_pair(max(due, dryrunev[i].first), -1));
+			}
+			for (uint b = 0; b < 16; b++) {
+				sort(change[b].begin(), change[b].end()); // leaving before arriving
+				int pending = 0;
+				for (uint i = 0; i < change[b].size(); i++) {
+					pending += change[b][i].second;
+					r.bufpending[b] = max(r.bufpending[b], (uint)pending);
+				}
+				if (r.bufpending[b] > r.maxpending) {
+					r.maxpending = r.bufpending[b];
+					r.maxpendingbuf = b;
+				}
+			}
+		}
+		errev[chip].resize(numerr);
+		errshift[chip].resize(numshift);
+	}
+	if (r.minend < r.end)
+		r.minend = r.end; // all events in time
+
+	// restore
+	dryrun = false;
+	dryrunev.clear();
+	setPbradr(oldpbradr);
+	for (uint b = 0; b < 16; b++)
+		ltime[b] = oldltime[b];
+	cont_proc_corr = oldcorr;
+	shiftlate = oldshift;
+	sendev[chip].swap(oldsendev);
+}
+
 void SC_SlowCtrl::readAdc(SBData& d, uint channel)
 {
+	BusLock lock = lockBus();
 	// This function reads the slow ADC on the flyspi-spikey board
 	// and uses an interesting method to communicate the result!
 	// It sets the result field in the parameter d of type SBData.
@@ -1200,6 +1507,7 @@ void SC_SlowCtrl::checkSupplyVoltage()
 // write dac packet to slow control
 void SC_SlowCtrl::writeDac(const SBData& d)
 {
+	BusLock lock = lockBus();
 	spydac->enableReference();
 
 	switch (d.getADtype()) {
@@ -1257,32 +1565,13 @@ void SC_SlowCtrl::poisson(uint start, uint duration, uint cmddur, double freq, v
 		p->push_back(value);
 	}
 	sort(p->begin(), p->end()); // sort spike-times ascending
-
-	double mean_dist = 0.0;
-	uint event, prev_event, min_dist = numeric_limits<uint>::max(), max_dist = 0;
-	for (uint i = 0; i < p->size(); ++i) {
-		event = p->at(i);
-		// std::cout << "2del: " << event << std::endl;
-		if (i > 0) {
-			mean_dist += event - prev_event;
-			if (min_dist > event - prev_event)
-				min_dist = event - prev_event;
-			if (max_dist < event - prev_event)
-				max_dist = event - prev_event;
-		}
-		prev_event = event;
-		// dbg(::Logger::ERROR) << dec << fixed << p->at(i);
-	}
-	mean_dist /= p->size() - 1;
-	// dbg(::Logger::ERROR) << "SC_SlowCtrl::poisson: mean distance of generated neuron resets is "
-	//       << fixed << mean_dist << " in " << N
-	//       << " resets (duration is " << duration << ").";
 }
 //----------------------------------------------------------------------
 
 
 void SC_SlowCtrl::setupFastAdc(unsigned int sample_time_us, std::bitset<3> adc_input)
 {
+	BusLock lock = lockBus();
 	// input patterns are:
 	// 000 Normal operation - <D13:D0> = ADC output
 	// 001 All zeros - <D13:D0> = 0x0000
@@ -1308,6 +1597,7 @@ void SC_SlowCtrl::setupFastAdc(unsigned int sample_time_us, std::bitset<3> adc_i
 
 void SC_SlowCtrl::triggerAdc()
 {
+	BusLock lock = lockBus();
 	sp6data* buf = ocp->writeBlock(0, 4);
 	buf[0] = 0x80003009;
 	buf[1] = 0x1; // start
@@ -1318,6 +1608,8 @@ void SC_SlowCtrl::triggerAdc()
 
 SpikenetComm::Commstate SC_SlowCtrl::writeBuf(uint64_t data, uint addr)
 {
+	if (dryrun)
+		return ok; // only pbradr is advanced
 	// handle sdrambuf
 	if (!sdrambufvalid) {
 		sdrambufbase = addr;
@@ -1336,9 +1628,128 @@ SpikenetComm::Commstate SC_SlowCtrl::writeBuf(uint64_t data, uint addr)
 
 float SC_SlowCtrl::getTemp()
 {
+	BusLock lock = lockBus();
 	return gyro->read_temperature();
 }
 
+SC_SlowCtrl::BusLock SC_SlowCtrl::lockBus()
+{
+	return BusLock(busmutex, lastaccess);
+}
+
+SC_SlowCtrl::BusLock::~BusLock()
+{
+	if (owns_lock())
+		*stamp = monotonicTime();
+}
+
+//******** telemetry ********
+
+void SC_SlowCtrl::startTelemetry(uint periodms, const vector<uint>& channels, uint maxsamples,
+                                 uint idlems)
+{
+	stopTelemetry();
+	if (!periodms || !maxsamples) {
+		string msg = "SC_SlowCtrl::startTelemetry: period and history must not be zero";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	{
+		std::lock_guard<std::mutex> lock(telemutex);
+		teleperiod = periodms * 1e-3;
+		teleidle = idlems * 1e-3;
+		telechannels = channels;
+		telemax = maxsamples;
+		telehistory.clear();
+		telerunning = true;
+	}
+	telethread = std::thread(&SC_SlowCtrl::telemetryLoop, this);
+	LOG4CXX_DEBUG(logger, "Telemetry started with period " << periodms << "ms");
+}
+
+void SC_SlowCtrl::stopTelemetry()
+{
+	{
+		std::lock_guard<std::mutex> lock(telemutex);
+		telerunning = false;
+	}
+	telecond.notify_all();
+	if (telethread.joinable())
+		telethread.join();
+}
+
+vector<TelemetrySample> SC_SlowCtrl::telemetryHistory()
+{
+	std::lock_guard<std::mutex> lock(telemutex);
+	return vector<TelemetrySample>(telehistory.begin(), telehistory.end());
+}
+
+float SC_SlowCtrl::getTempCached()
+{
+	{
+		std::lock_guard<std::mutex> lock(telemutex);
+		if (telerunning && !telehistory.empty())
+			return telehistory.back().temperature;
+	}
+	return getTemp();
+}
+
+void SC_SlowCtrl::telemetryLoop()
+{
+	std::unique_lock<std::mutex> lock(telemutex);
+	double last = monotonicTime() - teleperiod; // time of last sample, first one immediately
+	while (telerunning) {
+		double wait = last + teleperiod - monotonicTime();
+		if (wait > 0) {
+			telecond.wait_for(lock, std::chrono::duration<double>(wait));
+			continue;
+		}
+		// do not delay experiments, unless the bus has not been idle for a long time
+		bool force = monotonicTime() - last > 10 * teleperiod;
+		lock.unlock();
+		bool sampled = true;
+		try {
+			sampled = sampleTelemetry(force);
+		} catch (std::exception& e) {
+			LOG4CXX_WARN(logger, "SC_SlowCtrl: telemetry sample failed: " << e.what());
+		}
+		lock.lock();
+		if (sampled)
+			last = monotonicTime();
+		else
+			telecond.wait_for(lock, std::chrono::duration<double>(teleidle));
+	}
+}
+
+bool SC_SlowCtrl::sampleTelemetry(bool force)
+{
+	std::unique_lock<std::recursive_mutex> buslock(busmutex);
+	double access = lastaccess;
+	if (!force && monotonicTime() - access < teleidle)
+		return false;
+
+	TelemetrySample s;
+	s.time = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch())
+	             .count();
+
+	s.temperature = getTemp();
+	SBData d;
+	readAdc(d, 0);
+	s.supply = d.ADvalue() * 2.0; // voltage divider, see checkSupplyVoltage
+	for (uint i = 0; i < telechannels.size(); i++) {
+		readAdc(d, telechannels[i]);
+		s.adc.push_back(d.ADvalue());
+	}
+	lastaccess = access; // own accesses are no bus activity
+	buslock.unlock();
+
+	std::lock_guard<std::mutex> lock(telemutex);
+	telehistory.push_back(s);
+	while (telehistory.size() > telemax)
+		telehistory.pop_front();
+	return true;
+}
+
 std::string SC_SlowCtrl::getWorkstationFromFile(std::string filenameWorkstation)
 {
 	ifstream workstationFile(filenameWorkstation.c_str());
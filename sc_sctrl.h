@@ -24,6 +24,11 @@
 #include "Vspidac.h"
 #include "Vmux_board.h"
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 #ifdef CONFIG_H_AVAILABLE
 #include "config.h"
 #ifdef HAVE_GTEST
@@ -38,6 +43,96 @@
 namespace spikey2
 {
 
+//! Prediction of the encoding of a spike train by SC_SlowCtrl::pbEvt, see SC_SlowCtrl::analyzeEvt.
+//! Buffers are Spikey's 16 event input buffers, selected by the address msbs and the time lsb.
+struct LinkReport
+{
+	uint events;       //!< events analyzed
+	uint dropped;      //!< events that would be dropped
+	uint shifted;      //!< events that would be delayed, only if late events are shifted
+	uint commands;     //!< event commands
+	uint words;        //!< playback memory words
+	uint duration;     //!< playback duration of the events in stime cycles
+	uint maxpending;   //!< peak number of events waiting in one input buffer for their time
+	uint maxpendingbuf; //!< buffer that reached maxpending
+	uint bufdropped[16]; //!< dropped events per input buffer
+	uint bufpending[16]; //!< peak number of waiting events per input buffer
+	uint64_t end;      //!< time of the last input event (IData time)
+	uint64_t minend;   //!< earliest time the last event can reach the chip if all late events are
+	                   //!< delayed instead of dropped (IData time)
+
+	LinkReport();
+};
+
+//! One sample of the station health data recorded by the telemetry thread of SC_SlowCtrl.
+struct TelemetrySample
+{
+	double time;        //!< wall-clock time in seconds since the epoch
+	float temperature;  //!< temperature between FlySpi and Spikey board in degrees Celsius
+	float supply;       //!< supply voltage in V
+	vector<float> adc;  //!< slow ADC channels selected by startTelemetry, in V
+};
+
+//! Register accesses of the slow control (writeSC/readSC, e.g. sg_scsendidle) and playback memory
+//! control registers (writePBC/readPBC, sg_sc_*) that SC_SlowCtrl::commit issues as one
+//! transaction. Reads are deferred: read() returns a handle for result() after the commit.
+//! Usage: SC_Transaction t = sc->transaction(); t.setRadr(a); uint h = t.getNumRead();
+//!        t.startPlayback(); sc->commit(t); uint n = t.result(h);
+class SC_Transaction
+{
+public:
+	enum Target { sc, pbc };
+	struct Access
+	{
+		Target target;
+		bool read;
+		uint addr;
+		uint data; // written data or read result after commit
+		uint mask; // applied to the read result
+		bool reset; // resetPlayback, committed through SC_SlowCtrl::resetPlayback
+	};
+
+	SC_Transaction(boost::shared_ptr<HardwareConstants> hw) : hw_const(hw), done(false){};
+
+	void write(Target t, uint addr, uint data);
+	//! returns the handle of the result
+	uint read(Target t, uint addr, uint mask = ~0u);
+	//! result of read handle h, throws if not committed yet
+	uint result(uint h) const;
+	bool committed() const { return done; };
+	const vector<Access>& accesses() const { return acc; };
+
+	// register accesses of SC_SlowCtrl with the same name
+	void setContIdleOn()
+	{
+		write(sc, hw_const->sg_scsendidle(), 1 << hw_const->sg_scevidle_pos());
+	};
+	void setContIdleOff() { write(sc, hw_const->sg_scsendidle(), 0); };
+	void setNumRead(uint nr) { write(pbc, hw_const->sg_sc_numread(), nr); };
+	void setRadr(uint ra) { write(pbc, hw_const->sg_sc_radr(), ra); };
+	void setWadr(uint wa) { write(pbc, hw_const->sg_sc_wadr(), wa); };
+	void setChipid(uint ci) { write(pbc, hw_const->sg_sc_chipid(), ci); };
+	void resetPlayback()
+	{
+		write(pbc, hw_const->sg_sc_status(), 1 << hw_const->sg_sb_reset_ramsm());
+		acc.back().reset = true;
+	};
+	void startPlayback()
+	{
+		write(pbc, hw_const->sg_sc_status(), 1 << hw_const->sg_sb_start_ramsm());
+	};
+	uint getCurRadr() { return read(pbc, hw_const->sg_sc_radr(), mmw(hw_const->sg_sc_radrw())); };
+	uint getNumRead()
+	{
+		return read(pbc, hw_const->sg_sc_numread(), mmw(hw_const->sg_sc_numreadw()));
+	};
+
+private:
+	friend class SC_SlowCtrl;
+	boost::shared_ptr<HardwareConstants> hw_const;
+	vector<Access> acc;
+	bool done;
+};
 
 // realizes the communication via the nathan system's slow control
 
@@ -75,6 +170,7 @@ private:
 	vector<IData> rcvev[maxid];
 	vector<IData> sendev[maxid]; // sent events
 	vector<IData> errev[maxid]; // events dropped or modified by pbEvt().
+	vector<uint> errshift[maxid]; // time shift of each event in errev, 0 if dropped
 
 	queue<SBData> adc; // results from readAdc command
 
@@ -86,6 +182,7 @@ private:
 	vector<uint64_t> sdrambuf;
 	uint sdrambufbase = 0;
 	bool sdrambufvalid = false;
+	std::string programdump; // see setProgramDump
 
 	// write to playback software buffer
 	SpikenetComm::Commstate writeBuf(uint64_t data, uint addr);
@@ -97,8 +194,31 @@ private:
 	uint lsystime; // last system time transmitted by system time event
 	int levtimeclk; // last event time translated
 
+	// serializes hardware access of the telemetry thread and everything else
+	std::recursive_mutex busmutex;
+	double lastaccess; // monotonicTime at the end of the last hardware access, excluding telemetry
+
+	// telemetry, see startTelemetry
+	std::thread telethread;
+	std::mutex telemutex; // protects the members below
+	std::condition_variable telecond;
+	bool telerunning;
+	double teleperiod, teleidle; // seconds
+	vector<uint> telechannels;
+	uint telemax;
+	std::deque<TelemetrySample> telehistory;
+	void telemetryLoop();
+	bool sampleTelemetry(bool force); // false if the bus was busy
+	bool wrapambiguous; // time of last translated event relies on a guessed wrap around
+
 	int usedpcktslots; //!< how many events per event packet, choose in {1,2,3}; set to 1 to disable
 	                   //packing, e.g. for multi Spikey
+	bool shiftlate; //!< delay events exceeding the link capacity instead of dropping them
+
+	// analysis of pbEvt without writing the playback memory, see analyzeEvt
+	bool dryrun;
+	uint dryruncmds;                       // event commands generated
+	vector<pair<uint, IData> > dryrunev; // send time (400MHz cycles) and event
 
 	uint first_proc_corr;    // time in clock cycles at which first process correlation command is
 	                         // inserted
@@ -114,6 +234,28 @@ private:
 
 	float supply_voltage_limit = 4.5; // spikey needs at least a supply voltage of 4.5 volts
 
+	// initialization of members not related to hardware access
+	void init(uint time);
+
+protected:
+	//! constructor for derived classes that do not access any hardware (see SC_Emulator);
+	//! all Vmodule pointers are NULL and the hardware access methods below have to be overloaded
+	SC_SlowCtrl(std::string type, uint time, uint chipversion);
+	//! lock of the hardware access, records the end of the access for the telemetry on release
+	class BusLock : public std::unique_lock<std::recursive_mutex>
+	{
+	public:
+		BusLock(std::recursive_mutex& m, double& stamp)
+		    : std::unique_lock<std::recursive_mutex>(m), stamp(&stamp){};
+		BusLock(BusLock&&) = default;
+		~BusLock();
+
+	private:
+		double* stamp;
+	};
+	//! to be held by every hardware access, also of derived classes
+	BusLock lockBus();
+
 public:
 	SC_SlowCtrl(uint time = 0, std::string workstation = "");
 	virtual ~SC_SlowCtrl();
@@ -147,6 +289,16 @@ public:
 	const vector<IData>* rcvd(uint c) { return &(rcvev[c]); };
 	const vector<IData>* ev(uint c) { return &(sendev[c]); };
 	vector<IData>* eev(uint c) { return &(errev[c]); };
+	//! time shift in IData time units of each event in eev(c), 0 for dropped events
+	vector<uint>* eshift(uint c) { return &(errshift[c]); };
+	//! if enabled, pbEvt delays events that are late due to the link capacity by the smallest
+	//! possible amount instead of dropping them, the modified events are stored in eev()
+	void setShiftLate(bool enable) { shiftlate = enable; };
+	bool getShiftLate() { return shiftlate; };
+	//! predicts drops, input buffer occupancy and playback length of pbEvt for the events evt
+	//! (sorted by time) sent directly after a sync at stime, without generating playback memory
+	//! content; the state of the encoder is unchanged
+	void analyzeEvt(const vector<IData>& evt, LinkReport& r, uint stime = 0, uint chip = 0);
 	virtual Commstate Send(Mode mode, IData data = emptydata, uint del = 0, uint chip = 0,
 	                       uint syncoffset = 0);
 	virtual Commstate Receive(Mode mode, IData& data, uint chip = 0);
@@ -161,6 +313,22 @@ public:
 
 	void checkSupplyVoltage(); // measures supply voltage and throws exception, if too low
 
+	//! starts a thread that samples temperature, supply voltage and the slow ADC channels every
+	//! periodms while the bus has been idle for at least idlems. If the bus is never idle, a
+	//! sample is taken anyway after ten periods. The last maxsamples samples are kept.
+	void startTelemetry(uint periodms, const vector<uint>& channels = vector<uint>(),
+	                    uint maxsamples = 10000, uint idlems = 10);
+	void stopTelemetry();
+	bool telemetryRunning()
+	{
+		std::lock_guard<std::mutex> lock(telemutex);
+		return telerunning;
+	};
+	//! copy of the recorded samples, oldest first
+	vector<TelemetrySample> telemetryHistory();
+	//! temperature of the last telemetry sample if the telemetry runs, measured otherwise
+	float getTempCached();
+
 	uint getMaxChunkSize() { return maxchunksize; };
 	// set parameters for process correlation commands inserted into the spike train
 	void setProcCorr(bool active, uint first, uint distance, uint distance_pre, uint rowmin,
@@ -191,19 +359,39 @@ public:
 		return hw_const->sg_chain_latency() + 50;
 	}; // TP: timing is still subject for improvement
 
-	void writeDac(const SBData&); // internal write dac method
-	void readAdc(SBData& d, uint channel = 1); // read the voltage of slow ADC, channel 0 is supply
-	                                           // voltage
+	virtual void writeDac(const SBData&); // internal write dac method
+	virtual void readAdc(SBData& d, uint channel = 1); // read the voltage of slow ADC, channel 0 is
+	                                                   // supply voltage
 	void setupFastAdc(unsigned int sample_time_us, std::bitset<3> adc_input = 0);
 	void triggerAdc(); //!< triggers the ADC manually instead via "experiment start"
 
 	// access the spikey Slow Control interface's registers
-	Commstate writeSC(uint data, uint addr);
-	Commstate readSC(uint& data, uint addr);
+	virtual Commstate writeSC(uint data, uint addr);
+	virtual Commstate readSC(uint& data, uint addr);
 
 	// access the spikey Playback Memory control registers
-	Commstate writePBC(uint data, uint addr);
-	Commstate readPBC(uint& data, uint addr);
+	virtual Commstate writePBC(uint data, uint addr);
+	virtual Commstate readPBC(uint& data, uint addr);
+
+	//! write num 64bit words to FlySpi memory starting at (64bit aligned) address adr
+	virtual void writeMem(uint adr, const uint64_t* data, uint num);
+	//! read num 64bit words from FlySpi memory starting at (64bit aligned) address adr and append
+	//! them to buf
+	virtual void readMem(uint adr, uint num, vector<uint64_t>& buf);
+	//! write to the IODELAY configuration register of the FPGA
+	virtual void writeDelcfg(uint data);
+	//! empty register transaction, see commit
+	SC_Transaction transaction() { return SC_Transaction(hw_const); };
+	//! issues the accesses of t in order without other bus accesses in between and stores the
+	//! read results in t
+	virtual void commit(SC_Transaction& t);
+	//! block until the playback memory signals idle or timeout (in us) has expired, returns false
+	//! if the backend provides no such notification and the idle flag has to be polled
+	virtual bool waitIdleNotify(uint timeout)
+	{
+		static_cast<void>(timeout);
+		return false;
+	};
 
 	// functions to access playback memory pointers
 	// Attention: read is read from playback mem, write is write to received mem
@@ -221,6 +409,8 @@ public:
 	std::vector<int> get_LUT();
 	uint gen_plut_data(float nval); // generate LUT commands
 	void fill_plut(uint delay, bool identity); // write look-up table
+	void pbEvtEmit(vector<IData>& cv, uint cstart, uint systime,
+	               uint chip); // event command and packets for events collected by pbEvt
 	void pbEvt(vector<IData>& evt, uint& newstime, uint stime = 0,
 	           uint chip = 0); // stime: give current time so pbEvt is able to track event times.
 	void pbCI(Mode mode, IData& data, uint del = 2); // mode is read/write from Mode enum in base
@@ -238,6 +428,9 @@ public:
 	              uint evt3time = 0, uint evt3addr = 0); // 		not connected
 	// interpret SDRAM received content
 	void translate(const uint64_t& d, IData&, uint& evmask);
+	//! true if the time of the event returned by the last translate call relies on a wrap around
+	//! decision that could also be explained by events out of order
+	bool lastWrapAmbiguous() { return wrapambiguous; };
 
 	// functions to access registers...all addresses are 64-bit word aligned (lsb selects even/odd
 	// 64 bit word)
@@ -246,10 +439,26 @@ public:
 	void sendOneIdle() { writeSC((1 << hw_const->sg_sc1evidle_pos()), hw_const->sg_scsendidle()); }
 	void setupPlayback(uint wstartadr, uint rstartadr, uint chipid)
 	{
-		setupSend(rstartadr, chipid);
-		setWadr(wstartadr);
+		SC_Transaction t = transaction();
+		setupPlayback(wstartadr, rstartadr, chipid, t);
+		commit(t);
+	};
+	//! uploads the program and appends the register writes to t
+	void setupPlayback(uint wstartadr, uint rstartadr, uint chipid, SC_Transaction& t)
+	{
+		setupSend(rstartadr, chipid, t);
+		t.setWadr(wstartadr);
+	};
+	void setupSend(uint rstartadr, uint chipid)
+	{
+		SC_Transaction t = transaction();
+		setupSend(rstartadr, chipid, t);
+		commit(t);
 	};
-	void setupSend(uint rstartadr, uint chipid);
+	void setupSend(uint rstartadr, uint chipid, SC_Transaction& t);
+	//! transfers sdrambuf to the playback memory at rstartadr without touching the playback
+	//! registers, i.e. also while another program is running. Returns the number of words.
+	uint uploadSend(uint rstartadr);
 	void startPlayback();
 	//! set all addresses to startup values (stored in configuration registers)
 	//! and RAM-FSM to IDLE
@@ -336,6 +545,9 @@ public:
 
 	// function to display playback memory content
 	void printPBMem();
+	//! saves each program sent to the playback memory to filename (overwritten by the next one)
+	//! for offline analysis with PbDisassembler, e.g. with tools/pbDisasm. Empty to disable.
+	void setProgramDump(std::string filename) { programdump = filename; };
 
 	// functions to read/write directly from/to the 72bit link registers
 	void setDout0(uint pat) { writeSC(pat, hw_const->sg_scdirect0()); }
@@ -383,7 +595,7 @@ public:
 	}
 
 	//! get temperature from sensor between Flyspi and Spikey board
-	float getTemp();
+	virtual float getTemp();
 	//! read workstation from file (needed for SpikeyHAL tests)
 	std::string getWorkstationFromFile(std::string filenameWorkstation);
 	//! get workstation using serial from USB device and *.cfg files
@@ -0,0 +1,551 @@
+// recording and replay of the hardware accesses of SC_SlowCtrl
+
+#include "common.h" // library includes
+#include "idata.h"
+#include "sncomm.h"
+#include "spikenet.h"
+#include "sc_sctrl.h"
+#include "sc_trace.h"
+
+#include <chrono>
+#include <thread>
+
+static log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("HAL.Trace");
+
+using namespace spikey2;
+
+// file header: magic, format version, chip revision
+static const char trace_magic[8] = {'S', 'P', 'K', 'T', 'R', 'A', 'C', 'E'};
+static const uint trace_version = 1;
+
+// unsigned LEB128, most values in a trace are small
+static void putVar(std::ostream& o, uint64_t v)
+{
+	while (v >= 0x80) {
+		o.put((char)(v | 0x80));
+		v >>= 7;
+	}
+	o.put((char)v);
+}
+
+static bool getVar(std::istream& i, uint64_t& v)
+{
+	v = 0;
+	for (uint shift = 0; shift < 64; shift += 7) {
+		int c = i.get();
+		if (c == EOF)
+			return false;
+		v |= (uint64_t)(c & 0x7f) << shift;
+		if (!(c & 0x80))
+			return true;
+	}
+	return false;
+}
+
+template <class T>
+static void putRaw(std::ostream& o, T v)
+{
+	o.write((const char*)&v, sizeof(T));
+}
+
+template <class T>
+static bool getRaw(std::istream& i, T& v)
+{
+	return (bool)i.read((char*)&v, sizeof(T));
+}
+
+const char* TraceRecord::name(Kind k)
+{
+	static const char* names[numkinds] = {"writeSC", "readSC", "writePBC", "readPBC",
+	                                      "writeMem", "readMem", "writeDelcfg", "writeDac",
+	                                      "readAdc", "getTemp", "waitIdleNotify"};
+	return k < numkinds ? names[k] : "invalid";
+}
+
+uint64_t TraceRecord::hashWords(const uint64_t* data, uint num)
+{
+	uint64_t h = 14695981039346656037ull;
+	for (uint i = 0; i < num; i++)
+		for (uint b = 0; b < 8; b++) {
+			h ^= (data[i] >> (8 * b)) & 0xff;
+			h *= 1099511628211ull;
+		}
+	return h;
+}
+
+//******** recorder ********
+
+SC_TraceRecorder::SC_TraceRecorder(boost::shared_ptr<SC_SlowCtrl> backend, std::string filename,
+                                   uint time)
+    : SC_SlowCtrl("SC_TraceRecorder", time, backend->hw_const->revision()),
+      backend(backend),
+      out(filename.c_str(), std::ios::binary | std::ios::trunc),
+      numrecords(0)
+{
+	if (!out.good()) {
+		string msg = "SC_TraceRecorder: cannot open " + filename;
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	out.write(trace_magic, sizeof(trace_magic));
+	putRaw<uint32_t>(out, trace_version);
+	putRaw<uint32_t>(out, hw_const->revision());
+	LOG4CXX_INFO(logger, "Recording hardware accesses to " << filename);
+}
+
+SC_TraceRecorder::~SC_TraceRecorder()
+{
+	stopTelemetry();
+	flush();
+	LOG4CXX_INFO(logger, "Recorded " << numrecords << " hardware accesses");
+}
+
+void SC_TraceRecorder::flush()
+{
+	BusLock lock = lockBus();
+	out.flush();
+}
+
+void SC_TraceRecorder::write(TraceRecord& r, double t0)
+{
+	r.duration = (uint64_t)((monotonicTime() - t0) * 1e6);
+	out.put((char)r.kind);
+	putVar(out, r.duration);
+	switch (r.kind) {
+		case TraceRecord::writesc:
+		case TraceRecord::readsc:
+		case TraceRecord::writepbc:
+		case TraceRecord::readpbc:
+			putVar(out, r.addr);
+			putVar(out, r.data);
+			out.put((char)r.state);
+			break;
+		case TraceRecord::writemem:
+			putVar(out, r.addr);
+			putVar(out, r.data);
+			putRaw(out, r.hash);
+			break;
+		case TraceRecord::readmem:
+			putVar(out, r.addr);
+			putVar(out, r.words.size());
+			out.write((const char*)r.words.data(), r.words.size() * sizeof(uint64_t));
+			break;
+		case TraceRecord::delcfg:
+			putVar(out, r.data);
+			break;
+		case TraceRecord::dac:
+		case TraceRecord::adc:
+			putVar(out, r.addr);
+			putVar(out, r.data);
+			putRaw(out, r.value);
+			break;
+		case TraceRecord::temp:
+			putRaw(out, r.value);
+			break;
+		case TraceRecord::idle:
+			putVar(out, r.addr);
+			putVar(out, r.data);
+			break;
+		default:
+			break;
+	}
+	numrecords++;
+}
+
+SpikenetComm::Commstate SC_TraceRecorder::writeSC(uint data, uint addr)
+{
+	BusLock lock = lockBus();
+	TraceRecord r;
+	r.kind = TraceRecord::writesc;
+	double t0 = monotonicTime();
+	r.state = backend->writeSC(data, addr);
+	r.addr = addr;
+	r.data = data;
+	write(r, t0);
+	return (Commstate)r.state;
+}
+
+SpikenetComm::Commstate SC_TraceRecorder::readSC(uint& data, uint addr)
+{
+	BusLock lock = lockBus();
+	TraceRecord r;
+	r.kind = TraceRecord::readsc;
+	double t0 = monotonicTime();
+	r.state = backend->readSC(data, addr);
+	r.addr = addr;
+	r.data = data;
+	write(r, t0);
+	return (Commstate)r.state;
+}
+
+SpikenetComm::Commstate SC_TraceRecorder::writePBC(uint data, uint addr)
+{
+	BusLock lock = lockBus();
+	TraceRecord r;
+	r.kind = TraceRecord::writepbc;
+	double t0 = monotonicTime();
+	r.state = backend->writePBC(data, addr);
+	r.addr = addr;
+	r.data = data;
+	write(r, t0);
+	return (Commstate)r.state;
+}
+
+SpikenetComm::Commstate SC_TraceRecorder::readPBC(uint& data, uint addr)
+{
+	BusLock lock = lockBus();
+	TraceRecord r;
+	r.kind = TraceRecord::readpbc;
+	double t0 = monotonicTime();
+	r.state = backend->readPBC(data, addr);
+	r.addr = addr;
+	r.data = data;
+	write(r, t0);
+	return (Commstate)r.state;
+}
+
+void SC_TraceRecorder::writeMem(uint adr, const uint64_t* data, uint num)
+{
+	BusLock lock = lockBus();
+	TraceRecord r;
+	r.kind = TraceRecord::writemem;
+	double t0 = monotonicTime();
+	backend->writeMem(adr, data, num);
+	r.addr = adr;
+	r.data = num;
+	r.hash = TraceRecord::hashWords(data, num);
+	write(r, t0);
+}
+
+void SC_TraceRecorder::readMem(uint adr, uint num, vector<uint64_t>& buf)
+{
+	BusLock lock = lockBus();
+	TraceRecord r;
+	r.kind = TraceRecord::readmem;
+	uint first = buf.size();
+	double t0 = monotonicTime();
+	backend->readMem(adr, num, buf);
+	r.addr = adr;
+	r.words.assign(buf.begin() + first, buf.end());
+	write(r, t0);
+}
+
+void SC_TraceRecorder::writeDelcfg(uint data)
+{
+	BusLock lock = lockBus();
+	TraceRecord r;
+	r.kind = TraceRecord::delcfg;
+	double t0 = monotonicTime();
+	backend->writeDelcfg(data);
+	r.data = data;
+	write(r, t0);
+}
+
+void SC_TraceRecorder::writeDac(const SBData& d)
+{
+	BusLock lock = lockBus();
+	TraceRecord r;
+	r.kind = TraceRecord::dac;
+	double t0 = monotonicTime();
+	backend->writeDac(d);
+	r.addr = 0;
+	r.data = d.getADtype();
+	r.value = d.ADvalue();
+	write(r, t0);
+}
+
+void SC_TraceRecorder::readAdc(SBData& d, uint channel)
+{
+	BusLock lock = lockBus();
+	TraceRecord r;
+	r.kind = TraceRecord::adc;
+	double t0 = monotonicTime();
+	backend->readAdc(d, channel);
+	r.addr = channel;
+	r.data = d.getADtype();
+	r.value = d.ADvalue();
+	write(r, t0);
+}
+
+float SC_TraceRecorder::getTemp()
+{
+	BusLock lock = lockBus();
+	TraceRecord r;
+	r.kind = TraceRecord::temp;
+	double t0 = monotonicTime();
+	r.value = backend->getTemp();
+	write(r, t0);
+	return r.value;
+}
+
+bool SC_TraceRecorder::waitIdleNotify(uint timeout)
+{
+	TraceRecord r;
+	r.kind = TraceRecord::idle;
+	double t0 = monotonicTime();
+	// the backend locks its bus itself, do not block other accesses while waiting
+	r.data = backend->waitIdleNotify(timeout);
+	BusLock lock = lockBus();
+	r.addr = 0; // the timeout may depend on the timing of the host
+	write(r, t0);
+	return r.data;
+}
+
+//******** replay ********
+
+bool SC_TraceReplay::load(std::string filename, vector<TraceRecord>& trace, uint& revision)
+{
+	std::ifstream in(filename.c_str(), std::ios::binary);
+	char magic[sizeof(trace_magic)];
+	uint32_t version, rev;
+	if (!in.read(magic, sizeof(magic)) || memcmp(magic, trace_magic, sizeof(magic)) ||
+	    !getRaw(in, version) || version != trace_version || !getRaw(in, rev))
+		return false;
+	revision = rev;
+
+	trace.clear();
+	int c;
+	while ((c = in.get()) != EOF) {
+		TraceRecord r;
+		r.kind = (TraceRecord::Kind)c;
+		r.addr = 0;
+		r.data = r.hash = 0;
+		r.state = SpikenetComm::ok;
+		r.value = 0;
+		uint64_t v, num;
+		bool ok = getVar(in, r.duration);
+		switch (r.kind) {
+			case TraceRecord::writesc:
+			case TraceRecord::readsc:
+			case TraceRecord::writepbc:
+			case TraceRecord::readpbc:
+				ok = ok && getVar(in, v) && getVar(in, r.data) && (c = in.get()) != EOF;
+				r.addr = v;
+				r.state = c;
+				break;
+			case TraceRecord::writemem:
+				ok = ok && getVar(in, v) && getVar(in, r.data) && getRaw(in, r.hash);
+				r.addr = v;
+				break;
+			case TraceRecord::readmem:
+				ok = ok && getVar(in, v) && getVar(in, num) && num < (1ull << 32);
+				if (ok) {
+					r.addr = v;
+					r.data = num;
+					r.words.resize(num);
+					ok = (bool)in.read((char*)r.words.data(), num * sizeof(uint64_t));
+				}
+				break;
+			case TraceRecord::delcfg:
+				ok = ok && getVar(in, r.data);
+				break;
+			case TraceRecord::dac:
+			case TraceRecord::adc:
+				ok = ok && getVar(in, v) && getVar(in, r.data) && getRaw(in, r.value);
+				r.addr = v;
+				break;
+			case TraceRecord::temp:
+				ok = ok && getRaw(in, r.value);
+				break;
+			case TraceRecord::idle:
+				ok = ok && getVar(in, v) && getVar(in, r.data);
+				r.addr = v;
+				break;
+			default:
+				ok = false;
+		}
+		if (!ok)
+			return false;
+		trace.push_back(r);
+	}
+	return true;
+}
+
+uint SC_TraceReplay::revisionOf(std::string filename)
+{
+	vector<TraceRecord> trace;
+	uint revision = 5;
+	if (!load(filename, trace, revision)) {
+		string msg = "SC_TraceReplay: cannot read trace " + filename;
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	return revision;
+}
+
+SC_TraceReplay::SC_TraceReplay(std::string filename, bool timing, uint time)
+    : SC_SlowCtrl("SC_TraceReplay", time, revisionOf(filename)),
+      pos(0),
+      timing(timing),
+      verifywrites(true)
+{
+	uint revision;
+	load(filename, trace, revision);
+	LOG4CXX_INFO(logger, "Replaying " << trace.size() << " hardware accesses from " << filename);
+}
+
+const TraceRecord& SC_TraceReplay::next(TraceRecord::Kind k, uint addr)
+{
+	// register polls may have been repeated more often in the recorded session
+	for (uint64_t p = pos; p < trace.size(); p++) {
+		const TraceRecord& r = trace[p];
+		if (r.kind == k && r.addr == addr) {
+			if (p > pos)
+				LOG4CXX_DEBUG(logger, "SC_TraceReplay: skipped " << p - pos << " register reads");
+			pos = p + 1;
+			if (k == TraceRecord::readsc || k == TraceRecord::readpbc)
+				lastread[((uint64_t)k << 32) | addr] = r.data;
+			return r;
+		}
+		if (r.kind != TraceRecord::readsc && r.kind != TraceRecord::readpbc)
+			break;
+	}
+
+	// or less often
+	map<uint64_t, uint64_t>::iterator l = lastread.find(((uint64_t)k << 32) | addr);
+	if (l != lastread.end()) {
+		repeat.kind = k;
+		repeat.duration = 0;
+		repeat.addr = addr;
+		repeat.data = l->second;
+		repeat.state = SpikenetComm::ok;
+		return repeat;
+	}
+
+	string msg = "SC_TraceReplay: " + string(TraceRecord::name(k)) + " at address " +
+	             to_str(addr) + " does not match record " + to_str(pos) + " (" +
+	             (pos < trace.size() ? TraceRecord::name(trace[pos].kind) : "end of trace") + ")";
+	LOG4CXX_ERROR(logger, msg);
+	throw std::runtime_error(msg);
+}
+
+void SC_TraceReplay::wait(const TraceRecord& r)
+{
+	if (timing && r.duration)
+		std::this_thread::sleep_for(std::chrono::microseconds(r.duration));
+}
+
+void SC_TraceReplay::verify(const TraceRecord& r, uint64_t data, const char* method)
+{
+	if (verifywrites && r.data != data) {
+		string msg = "SC_TraceReplay::" + string(method) + ": data " + to_str(data) +
+		             " differs from record " + to_str(pos - 1) + " (" + to_str(r.data) + ")";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+}
+
+SpikenetComm::Commstate SC_TraceReplay::writeSC(uint data, uint addr)
+{
+	BusLock lock = lockBus();
+	const TraceRecord& r = next(TraceRecord::writesc, addr);
+	verify(r, data, "writeSC");
+	wait(r);
+	return (Commstate)r.state;
+}
+
+SpikenetComm::Commstate SC_TraceReplay::readSC(uint& data, uint addr)
+{
+	BusLock lock = lockBus();
+	const TraceRecord& r = next(TraceRecord::readsc, addr);
+	wait(r);
+	data = r.data;
+	return (Commstate)r.state;
+}
+
+SpikenetComm::Commstate SC_TraceReplay::writePBC(uint data, uint addr)
+{
+	BusLock lock = lockBus();
+	const TraceRecord& r = next(TraceRecord::writepbc, addr);
+	verify(r, data, "writePBC");
+	wait(r);
+	return (Commstate)r.state;
+}
+
+SpikenetComm::Commstate SC_TraceReplay::readPBC(uint& data, uint addr)
+{
+	BusLock lock = lockBus();
+	const TraceRecord& r = next(TraceRecord::readpbc, addr);
+	wait(r);
+	data = r.data;
+	return (Commstate)r.state;
+}
+
+void SC_TraceReplay::writeMem(uint adr, const uint64_t* data, uint num)
+{
+	BusLock lock = lockBus();
+	const TraceRecord& r = next(TraceRecord::writemem, adr);
+	if (verifywrites && (r.data != num || r.hash != TraceRecord::hashWords(data, num))) {
+		string msg = "SC_TraceReplay::writeMem: data at address " + to_str(adr) +
+		             " differs from record " + to_str(pos - 1);
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	wait(r);
+}
+
+void SC_TraceReplay::readMem(uint adr, uint num, vector<uint64_t>& buf)
+{
+	BusLock lock = lockBus();
+	const TraceRecord& r = next(TraceRecord::readmem, adr);
+	if (r.words.size() != num) {
+		string msg = "SC_TraceReplay::readMem: " + to_str(num) + " words at address " +
+		             to_str(adr) + " requested, " + to_str(r.words.size()) + " recorded";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	wait(r);
+	buf.insert(buf.end(), r.words.begin(), r.words.end());
+}
+
+void SC_TraceReplay::writeDelcfg(uint data)
+{
+	BusLock lock = lockBus();
+	const TraceRecord& r = next(TraceRecord::delcfg, 0);
+	verify(r, data, "writeDelcfg");
+	wait(r);
+}
+
+void SC_TraceReplay::writeDac(const SBData& d)
+{
+	BusLock lock = lockBus();
+	const TraceRecord& r = next(TraceRecord::dac, 0);
+	verify(r, d.getADtype(), "writeDac");
+	if (verifywrites && r.value != d.ADvalue()) {
+		string msg = "SC_TraceReplay::writeDac: value " + to_str(d.ADvalue()) +
+		             " differs from record " + to_str(pos - 1) + " (" + to_str(r.value) + ")";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	wait(r);
+}
+
+void SC_TraceReplay::readAdc(SBData& d, uint channel)
+{
+	BusLock lock = lockBus();
+	const TraceRecord& r = next(TraceRecord::adc, channel);
+	wait(r);
+	d.setADvalue(r.value);
+}
+
+float SC_TraceReplay::getTemp()
+{
+	BusLock lock = lockBus();
+	const TraceRecord& r = next(TraceRecord::temp, 0);
+	wait(r);
+	return r.value;
+}
+
+// the timeout is not recorded, a notification recorded after the timeout of the host times out
+bool SC_TraceReplay::waitIdleNotify(uint timeout)
+{
+	BusLock lock = lockBus();
+	const TraceRecord& r = next(TraceRecord::idle, 0);
+	if (r.duration > timeout) {
+		if (timing)
+			std::this_thread::sleep_for(std::chrono::microseconds(timeout));
+		return false;
+	}
+	wait(r);
+	return r.data;
+}
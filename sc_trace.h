@@ -0,0 +1,125 @@
+// recording and replay of the hardware accesses of SC_SlowCtrl
+
+namespace spikey2
+{
+
+//! One hardware access of a trace, see SC_TraceRecorder
+struct TraceRecord
+{
+	enum Kind {
+		writesc = 0,
+		readsc,
+		writepbc,
+		readpbc,
+		writemem, //!< only a hash of the written words is stored
+		readmem,
+		delcfg,
+		dac,
+		adc,
+		temp,
+		idle, //!< waitIdleNotify
+		numkinds
+	};
+
+	Kind kind;
+	uint64_t duration; //!< wall-clock duration of the access in us
+	uint addr;         //!< register or memory address, ADC channel
+	uint64_t data;     //!< register data, number of memory words, ADC/DAC type, idle result
+	uint64_t hash;     //!< writemem: hash of the written words
+	uint state;        //!< returned Commstate
+	float value;       //!< DAC, ADC or temperature value
+	vector<uint64_t> words; //!< readmem: words read
+
+	static const char* name(Kind k);
+	//! FNV-1a hash of memory words, as stored for writemem
+	static uint64_t hashWords(const uint64_t* data, uint num);
+};
+
+//! Logs every hardware access (registers, memory blocks, DAC/ADC, temperature, idle
+//! notification) of SC_SlowCtrl to a compact binary trace while forwarding it to a backend, e.g.
+//! the hardware. Accesses made by the backend during its own construction are not recorded and
+//! the telemetry thread should not run while recording.
+//! Usage: new SC_Mem(boost::shared_ptr<SC_SlowCtrl>(new SC_TraceRecorder(
+//!            boost::shared_ptr<SC_SlowCtrl>(new SC_SlowCtrl(0, workstation)), "session.trace")))
+class SC_TraceRecorder : public SC_SlowCtrl
+{
+public:
+	SC_TraceRecorder(boost::shared_ptr<SC_SlowCtrl> backend, std::string filename, uint time = 0);
+	virtual ~SC_TraceRecorder();
+
+	virtual Commstate writeSC(uint data, uint addr);
+	virtual Commstate readSC(uint& data, uint addr);
+	virtual Commstate writePBC(uint data, uint addr);
+	virtual Commstate readPBC(uint& data, uint addr);
+	virtual void writeMem(uint adr, const uint64_t* data, uint num);
+	virtual void readMem(uint adr, uint num, vector<uint64_t>& buf);
+	virtual void writeDelcfg(uint data);
+	virtual void writeDac(const SBData&);
+	virtual void readAdc(SBData& d, uint channel = 1);
+	virtual float getTemp();
+	virtual bool waitIdleNotify(uint timeout);
+
+	boost::shared_ptr<SC_SlowCtrl> getBackend() { return backend; };
+	uint64_t numRecords() { return numrecords; };
+	//! write buffered records to the file
+	void flush();
+
+private:
+	boost::shared_ptr<SC_SlowCtrl> backend;
+	std::ofstream out;
+	uint64_t numrecords;
+
+	void write(TraceRecord& r, double t0); // t0: monotonicTime at the start of the access
+};
+
+//! Serves the hardware accesses of SC_SlowCtrl from a trace written by SC_TraceRecorder, so that
+//! the host code of a recorded session can be run and benchmarked without a board. The host has
+//! to issue the same accesses as in the recorded session, otherwise a std::runtime_error is
+//! thrown. Register polls may be repeated more or less often than recorded: surplus recorded
+//! register reads are skipped and additional ones answered like the last read of the register.
+//! With timing enabled each access takes its recorded duration.
+class SC_TraceReplay : public SC_SlowCtrl
+{
+public:
+	SC_TraceReplay(std::string filename, bool timing = false, uint time = 0);
+	virtual ~SC_TraceReplay() { stopTelemetry(); };
+
+	virtual Commstate writeSC(uint data, uint addr);
+	virtual Commstate readSC(uint& data, uint addr);
+	virtual Commstate writePBC(uint data, uint addr);
+	virtual Commstate readPBC(uint& data, uint addr);
+	virtual void writeMem(uint adr, const uint64_t* data, uint num);
+	virtual void readMem(uint adr, uint num, vector<uint64_t>& buf);
+	virtual void writeDelcfg(uint data);
+	virtual void writeDac(const SBData&);
+	virtual void readAdc(SBData& d, uint channel = 1);
+	virtual float getTemp();
+	virtual bool waitIdleNotify(uint timeout);
+
+	void setTiming(bool enable) { timing = enable; };
+	//! verify the data of register, delay and DAC writes and the hashes of written memory blocks
+	//! (default), disable to replay a trace against modified encoders
+	void setVerifyWrites(bool enable) { verifywrites = enable; };
+	//! records served and remaining
+	uint64_t position() { return pos; };
+	uint64_t remaining() { return trace.size() - pos; };
+
+	//! reads a trace file, returns false if it does not exist or is corrupt
+	static bool load(std::string filename, vector<TraceRecord>& trace, uint& revision);
+
+private:
+	vector<TraceRecord> trace;
+	uint64_t pos;
+	bool timing, verifywrites;
+	map<uint64_t, uint64_t> lastread; // last answer of each register by kind and address
+	TraceRecord repeat;               // answer of a register read not in the trace
+
+	static uint revisionOf(std::string filename);
+	// next record of kind k at address addr, skips surplus register reads
+	const TraceRecord& next(TraceRecord::Kind k, uint addr);
+	// throws if verifying writes and data differs from the record r
+	void verify(const TraceRecord& r, uint64_t data, const char* method);
+	void wait(const TraceRecord& r);
+};
+
+} // end of namespace spikey2
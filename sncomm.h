@@ -8,6 +8,9 @@ class PySpikenetComm;
 namespace spikey2
 {
 
+class ControlInterface;
+class CIReply;
+
 //! Spikenet communication encapsulates the transfer of information between the spikenetcontroller
 //and the spikenet chips
 class SpikenetComm
@@ -102,6 +105,21 @@ public:
 
 	virtual void resetFlushed() {}
 
+	// registers a reply for the answer of the read command just sent by ci, see
+	// ControlInterface::reply
+	virtual boost::shared_ptr<CIReply> expectReply(ControlInterface* ci)
+	{
+		static_cast<void>(ci);
+		throw std::runtime_error("SpikenetComm::expectReply not implemented");
+	}
+	// receives until r is answered, events are decoded for chip
+	virtual Commstate waitReply(CIReply& r, uint chip = 0)
+	{
+		static_cast<void>(r);
+		static_cast<void>(chip);
+		return notimplemented;
+	}
+
 	// starts execution of previously flushed data
 	virtual Commstate Run(void)
 	{
@@ -53,29 +53,82 @@ Spikey::Spikey(boost::shared_ptr<Spikenet> spnet, float clk, uint chipid)
       clockper(clk),
       voutperiod(19),
       lutboost(6),
-      pram_settled(false)
+      pram_settled(false),
+      writepending(false),
+      streamcont(false),
+      attached(false),
+      cfghash(0)
 {
 	static_cast<void>(chipid);
 	initialize();
 }
 
 Spikey::Spikey(boost::shared_ptr<SpikenetComm> comm, float clk, uint chipid)
-    : Spikenet(comm, chipid), clockper(clk), voutperiod(19), lutboost(6), pram_settled(false)
+    : Spikenet(comm, chipid),
+      clockper(clk),
+      voutperiod(19),
+      lutboost(6),
+      pram_settled(false),
+      writepending(false),
+      streamcont(false),
+      attached(false),
+      cfghash(0)
 {
 	initialize();
 }
 
-void Spikey::initialize()
+Spikey::Spikey(boost::shared_ptr<SpikenetComm> comm, std::string statefile, float clk, uint chipid)
+    : Spikenet(comm, chipid),
+      clockper(clk),
+      voutperiod(19),
+      lutboost(6),
+      pram_settled(false),
+      writepending(false),
+      streamcont(false),
+      statefile(statefile),
+      attached(false),
+      cfghash(0)
+{
+	attached = attach();
+	if (!attached) {
+		initialize();
+		saveState();
+	}
+}
+
+void Spikey::initDefaults()
 {
 	// set statusreg size
-	for (int i = 0; i < hw_const->cr_width(); i++)
-		statusreg.push_back(0);
+	statusreg.assign(hw_const->cr_width(), 0);
 	// rconv100=(1039)*9.5 *100 * 1e-6;//corner min
 	rconv100 = 10000 * 100 * 1e-6;
 
 	// standard delays
-	synramdel = 2;
-	synfstdel = ControlInterface::synramdelay; // minimum delay for tsense==0
+	CITiming t = CITiming::model(*hw_const, clockper);
+	CITiming tuned;
+	std::string file = timingFile();
+	if (!file.empty() && tuned.read(file)) {
+		if (tuned.revision == t.revision && tuned.clockper == clockper) {
+			LOG4CXX_INFO(logger, "Using control interface timing of " << file);
+			t = tuned;
+		} else
+			LOG4CXX_WARN(logger, "Ignoring timing file " << file << " of other revision or clock");
+	}
+	tsensedel = 0; // minimum delay for tsense==0
+	setTiming(t);
+
+	dllreset = false;
+	neuronreset = false;
+	pccont = false;
+}
+
+void Spikey::initialize()
+{
+	initDefaults();
+	// the chip is reset below, nothing known about its configuration
+	pram_settled = false;
+	cfghash = 0;
+	forgetConfig();
 
 	/*	//scinit testmode is integrated here
 	    IData d(false, false, false);
@@ -108,10 +161,7 @@ void Spikey::initialize()
 		setCCBit(hw_const->cr_ein_rst() + i, false);
 	writeCC();
 
-	// initialization values for cispikenet control register
-	dllreset = false;
-	neuronreset = false;
-	pccont = false;
+	// initialization values for cispikenet control register, see initDefaults
 	writeSCtl();
 
 	// voltage LUTs
@@ -138,6 +188,7 @@ void Spikey::initialize()
 	// lut = getPC()->get_lut();
 	// we'll do this:
 	// save copies in lut vector
+	lut.clear();
 	lut.push_back(LutData(3, 0, 0, 0));
 	lut.push_back(LutData(5, 0, 0, 0));
 	lut.push_back(LutData(7, 0, 0, 0));
@@ -215,6 +266,336 @@ void Spikey::initialize()
 	setGlobalTrigger(false);
 }
 
+bool Spikey::attach()
+{
+	boost::shared_ptr<SC_Mem> mem(boost::dynamic_pointer_cast<SC_Mem>(bus));
+	SpikeyState state;
+	if (mem == NULL || !state.read(statefile))
+		return false;
+	if (state.revision != hw_const->revision() || state.workstation != mem->getWorkStationName() ||
+	    state.clockper != clockper || state.lut.size() != 16) {
+		LOG4CXX_INFO(logger, "State file " << statefile << " does not match setup, initializing");
+		return false;
+	}
+
+	// a single control register read detects a reset or power cycle of the chip and any other
+	// process that changed it since the state was saved
+	getCC()->getCtrl();
+	CIFuture answer = getCC()->reply();
+	Flush();
+	Run();
+	waitPbFinished();
+	uint64_t rdata = answer->get();
+	uint64_t ctrl = (rdata >> hw_const->cr_pos()) & mmw(hw_const->cr_width());
+	if (ctrl != state.statusreg) {
+		LOG4CXX_INFO(logger, "Chip control register 0x" << hex << ctrl << " differs from state file 0x"
+		                                                << state.statusreg << ", initializing");
+		return false;
+	}
+
+	initDefaults();
+	for (int i = 0; i < hw_const->cr_width(); i++)
+		statusreg[i] = (state.statusreg >> i) & 1;
+	lut = state.lut;
+	pram_settled = state.pramsettled;
+	cfghash = state.cfghash;
+	forgetConfig(); // sections are only compared within a process
+	setGlobalTrigger(false);
+	LOG4CXX_INFO(logger, "Attached to initialized Spikey " << hw_const->revision() << " using "
+	                                                        << statefile);
+	return true;
+}
+
+void Spikey::saveState()
+{
+	if (statefile.empty())
+		return;
+	boost::shared_ptr<SC_Mem> mem(boost::dynamic_pointer_cast<SC_Mem>(bus));
+	SpikeyState state;
+	state.revision = hw_const->revision();
+	state.workstation = mem != NULL ? mem->getWorkStationName() : "";
+	state.clockper = clockper;
+	state.statusreg = statusregToUint64();
+	state.lut = lut;
+	state.pramsettled = pram_settled;
+	state.cfghash = cfghash;
+	if (!state.write(statefile))
+		LOG4CXX_WARN(logger, "Could not write state file " << statefile);
+}
+
+void Spikey::invalidateState()
+{
+	forgetConfig();
+	cfghash = 0;
+	saveState();
+}
+
+bool SpikeyState::read(std::string filename)
+{
+	ifstream i(filename.c_str());
+	if (!i.good())
+		return false;
+	uint have = 0; // bit mask of the keys read
+	lut.clear();
+	std::string key;
+	while (i >> key) {
+		if (key == "revision" && i >> revision)
+			have |= 1;
+		else if (key == "workstation" && i >> workstation) {
+			if (workstation == "-")
+				workstation.clear();
+			have |= 2;
+		}
+		else if (key == "clockper" && i >> clockper)
+			have |= 4;
+		else if (key == "statusreg" && i >> hex >> statusreg >> dec)
+			have |= 8;
+		else if (key == "pramsettled" && i >> pramsettled)
+			have |= 16;
+		else if (key == "cfghash" && i >> hex >> cfghash >> dec)
+			have |= 32;
+		else if (key == "lut") {
+			uint t, b, r, s;
+			if (!(i >> t >> b >> r >> s))
+				break;
+			lut.push_back(LutData(t, b, r, s));
+		} else
+			break;
+	}
+	if (have != 63 || !i.eof()) {
+		LOG4CXX_WARN(logger, "Ignoring incomplete state file " << filename);
+		return false;
+	}
+	return true;
+}
+
+bool SpikeyState::write(std::string filename) const
+{
+	// write to a temporary file and rename it, so that readers never see a partial file
+	std::string tmp = filename + ".tmp";
+	{
+		ofstream o(tmp.c_str());
+		if (!o.good())
+			return false;
+		o << "revision " << revision << endl;
+		o << "workstation " << (workstation.empty() ? "-" : workstation) << endl;
+		o.precision(9); // exact float round trip
+		o << "clockper " << clockper << endl;
+		o << "statusreg " << hex << statusreg << dec << endl;
+		for (uint l = 0; l < lut.size(); l++)
+			o << "lut " << lut[l].luttime << " " << lut[l].lutboost << " " << lut[l].lutrepeat
+			  << " " << lut[l].lutstep << endl;
+		o << "pramsettled " << pramsettled << endl;
+		o << "cfghash " << hex << cfghash << dec << endl;
+		if (!o.good())
+			return false;
+	}
+	return rename(tmp.c_str(), filename.c_str()) == 0;
+}
+
+CITiming CITiming::model(const HardwareConstants& hw, float clockper)
+{
+	CITiming t;
+	t.revision = hw.revision();
+	t.clockper = clockper;
+	// digital logic runs with the core clock, analog settling takes the same time at any clock
+	t.synram = hw.tm_synram_cycles() + (uint)ceil(hw.tm_synram_ns() / clockper);
+	t.synramnext = hw.tm_synramnext_cycles();
+	t.synread = (uint)ceil(hw.tm_synread_ns() / clockper);
+	t.pram = hw.tm_pram_cycles();
+	t.ar = 30 + 2 * hw.ar_maxlen();
+	t.chain = hw.sg_chain_latency() + 50; // see SC_SlowCtrl::getMaxChainDelay
+	return t;
+}
+
+bool CITiming::read(std::string filename)
+{
+	ifstream i(filename.c_str());
+	if (!i.good())
+		return false;
+	uint have = 0; // bit mask of the keys read
+	std::string key;
+	while (i >> key) {
+		if (key == "revision" && i >> revision)
+			have |= 1;
+		else if (key == "clockper" && i >> clockper)
+			have |= 2;
+		else if (key == "synram" && i >> synram)
+			have |= 4;
+		else if (key == "synramnext" && i >> synramnext)
+			have |= 8;
+		else if (key == "synread" && i >> synread)
+			have |= 16;
+		else if (key == "pram" && i >> pram)
+			have |= 32;
+		else if (key == "ar" && i >> ar)
+			have |= 64;
+		else if (key == "chain" && i >> chain)
+			have |= 128;
+		else
+			break;
+	}
+	if (have != 255 || !i.eof()) {
+		LOG4CXX_WARN(logger, "Ignoring incomplete timing file " << filename);
+		return false;
+	}
+	return true;
+}
+
+bool CITiming::write(std::string filename) const
+{
+	std::string tmp = filename + ".tmp";
+	{
+		ofstream o(tmp.c_str());
+		if (!o.good())
+			return false;
+		o << "revision " << revision << endl;
+		o.precision(9); // exact float round trip
+		o << "clockper " << clockper << endl;
+		o << "synram " << synram << endl;
+		o << "synramnext " << synramnext << endl;
+		o << "synread " << synread << endl;
+		o << "pram " << pram << endl;
+		o << "ar " << ar << endl;
+		o << "chain " << chain << endl;
+		if (!o.good())
+			return false;
+	}
+	return rename(tmp.c_str(), filename.c_str()) == 0;
+}
+
+void Spikey::setTiming(const CITiming& t)
+{
+	timing = t;
+	synramdel = timing.synramnext;
+	synfstdel = timing.synram + tsensedel;
+	getAR()->setDelay(timing.ar);
+}
+
+std::string Spikey::timingFile()
+{
+	boost::shared_ptr<SC_Mem> mem(boost::dynamic_pointer_cast<SC_Mem>(bus));
+	char* spikeyhalpath = getenv("SPIKEYHALPATH");
+	if (mem == NULL || spikeyhalpath == NULL || mem->getWorkStationName().empty())
+		return "";
+	return std::string(spikeyhalpath) + "/config/" + mem->getWorkStationName() + ".timing";
+}
+
+// runs one playback memory program with repeat accesses using delay del for the tested command
+// and the current timing for all others, returns whether all of them were read back correctly
+bool Spikey::testTiming(TimingTest test, uint del, uint repeat)
+{
+	boost::shared_ptr<SynapseControl> sc = getSC();
+	boost::shared_ptr<PramControl> pc = getPC();
+	const uint pramadr = 3071; // not refreshed, see calibParam
+	const uint ncol = 4;
+	Clear();
+	for (uint r = 0; r < repeat; r++) {
+		uint v = (0x5a5a5a ^ (r * 0x111111)) & mmw(24);
+		switch (test) {
+			case tt_synram:
+				sc->write_sram(r, 0, v, del + tsensedel);
+				sc->close();
+				sc->read_sram(r, 0, timing.synread);
+				sc->close();
+				break;
+			case tt_synramnext:
+				for (uint c = 0; c < ncol; c++)
+					sc->write_sram(r, c, v ^ c, c == 0 ? synfstdel : del);
+				sc->close();
+				for (uint c = 0; c < ncol; c++) {
+					sc->read_sram(r, c, timing.synread);
+					sc->close();
+				}
+				break;
+			case tt_synread:
+				sc->write_sram(r, 0, v, synfstdel);
+				sc->close();
+				sc->read_sram(r, 0, del);
+				sc->close();
+				break;
+			case tt_pram:
+				pc->write_pram(pramadr, r % 24, v & mmw(10), r % 16, del);
+				pc->read_pram(pramadr, del);
+				break;
+		}
+	}
+	Flush();
+	Run();
+	waitPbFinished();
+
+	try {
+		for (uint r = 0; r < repeat; r++) {
+			uint v = (0x5a5a5a ^ (r * 0x111111)) & mmw(24);
+			bool ok = true;
+			if (test == tt_synramnext) {
+				for (uint c = 0; c < ncol; c++)
+					ok = sc->check_sram(v ^ c) && ok;
+			} else if (test == tt_pram)
+				ok = pc->check_pram(pramadr, r % 24, v & mmw(10), r % 16);
+			else
+				ok = sc->check_sram(v);
+			if (!ok)
+				return false;
+		}
+	} catch (std::runtime_error& e) { // error flag, chip busy
+		return false;
+	}
+	return true;
+}
+
+// minimal delay passing testTiming, searching downwards from start if it passes, upwards otherwise
+uint Spikey::tuneDelay(TimingTest test, uint start, uint repeat)
+{
+	uint del = std::max(start, 1u);
+	if (testTiming(test, del, repeat)) {
+		while (del > 1 && testTiming(test, del - 1, repeat))
+			del--;
+		return del;
+	}
+	uint limit = 8 * del + 16;
+	while (!testTiming(test, ++del, repeat)) {
+		if (del >= limit) {
+			string msg = "Spikey::calibrateTiming: no working delay up to " + to_str(limit) +
+			             " cycles for test " + to_str((uint)test);
+			LOG4CXX_ERROR(logger, msg);
+			Clear();
+			throw std::runtime_error(msg);
+		}
+	}
+	return del;
+}
+
+CITiming Spikey::calibrateTiming(std::string file, uint margin, uint repeat)
+{
+	CITiming old = timing, t = CITiming::model(*hw_const, clockper);
+	try {
+		// the readback of the other tests relies on synread
+		t.synread = tuneDelay(tt_synread, timing.synread, repeat) + margin;
+		timing.synread = t.synread;
+		t.synram = tuneDelay(tt_synram, timing.synram, repeat) + margin;
+		t.synramnext = tuneDelay(tt_synramnext, timing.synramnext, repeat) + margin;
+		t.pram = tuneDelay(tt_pram, timing.pram, repeat) + margin;
+	} catch (std::runtime_error& e) {
+		invalidateState();
+		setTiming(old);
+		throw;
+	}
+	Clear();
+	invalidateState();
+	setTiming(t);
+	LOG4CXX_INFO(logger, "Tuned control interface timing: synram " << t.synram << ", synramnext "
+	                                                                << t.synramnext << ", synread "
+	                                                                << t.synread << ", pram "
+	                                                                << t.pram);
+
+	if (file.empty())
+		file = timingFile();
+	if (!file.empty() && !t.write(file))
+		LOG4CXX_WARN(logger, "Could not write timing file " << file);
+	return t;
+}
+
 void Spikey::setGlobalTrigger(bool value)
 {
 	boost::shared_ptr<SC_Mem> mem(boost::dynamic_pointer_cast<SC_Mem>(bus));
@@ -231,11 +612,19 @@ void Spikey::setGlobalTrigger(bool value)
 
 MemObj Spikey::config(boost::shared_ptr<SpikeyConfig> cfg)
 {
+	uint64_t hash = statefile.empty() ? 0 : cfg->hash();
+	if (hash && hash == cfghash) {
+		// writing the same configuration again would not change the chip
+		LOG4CXX_DEBUG(logger, "Configuration unchanged since saved state, skipping");
+		actcfg = cfg;
+		return MemObj(MemObj::ok);
+	}
 
-	// remember last config
-	actcfg = cfg;
-
-	if (cfg->valid & SpikeyConfig::ud_dac) {
+	if (writepending) { // last configuration did not finish
+		forgetConfig();
+		writepending = false;
+	}
+	if ((cfg->valid & SpikeyConfig::ud_dac) && updateSection(*cfg, SpikeyConfig::ud_dac)) {
 		LOG4CXX_DEBUG(logger, "Updating DAC");
 		setIrefdac(cfg->irefdac);
 		// dacimax=2.5; //microamps, adjust dacimax for param setup
@@ -251,7 +640,110 @@ MemObj Spikey::config(boost::shared_ptr<SpikeyConfig> cfg)
 		setVrest(cfg->vrest);
 	}
 
-	if (cfg->valid & SpikeyConfig::ud_param) {
+	encodeConfig(cfg);
+
+	Flush();
+	Run();
+	waitPbFinished();
+	writepending = false;
+
+	cfghash = hash;
+	saveState();
+
+	/* optional debug functionality:
+	// read back voltage parameters:
+	if(cfg->valid & SpikeyConfig::ud_param){
+	    getAR()->clear(0);
+	    getAR()->clear(1);
+
+	    for(uint chain=0;chain<2;chain++){
+	        if(chain==1) getAR()->clear(0);
+	        for(uint addr=0;addr<21;addr++) {
+
+	            getAR()->set((chain==0?getAR()->voutl:getAR()->voutr),addr,true,150);//set with
+	verify
+
+	            Flush();
+	            Run();
+
+	            if (getAR()->check_last(addr,false) == 1)
+	                ;//cout<<"Areadout check: positive"<<endl;
+	            else
+	                cout<<"Areadout check: negative"<<endl;
+
+	            vector<float> v;
+	            v.clear();
+	            for(int i=0;i<2;++i)v.push_back(readAdc(SBData::ibtest));
+
+	            double sum = std::accumulate(v.begin(), v.end(), 0.0);
+	            double mean = sum / v.size();
+
+	            double sq_sum = std::inner_product(v.begin(), v.end(), v.begin(), 0.0);
+	            double stdev = std::sqrt(sq_sum / v.size() - mean * mean);
+
+	            cout<<"chain " << chain << ", addr " << addr << ": ADC read: "<<mean<< ", stddev: "
+	<< stdev << endl;
+	        }
+	    }
+
+	    getAR()->clear(0);
+	    getAR()->clear(1);
+	    Flush();
+	    Run();
+	    waitPbFinished();
+	}*/
+
+	return MemObj(MemObj::ok);
+}
+
+uint64_t Spikey::sectionKey(const SpikeyConfig& cfg, SpikeyConfig::SCupdate section)
+{
+	uint64_t key = cfg.generation(section);
+	if (section == SpikeyConfig::ud_param) {
+		// the parameter values written depend on the DAC reference current
+		uint64_t d;
+		memcpy(&d, &dacimax, sizeof(d));
+		key ^= d * 0x9e3779b97f4a7c15ULL;
+	}
+	return key;
+}
+
+bool Spikey::updateSection(const SpikeyConfig& cfg, SpikeyConfig::SCupdate section)
+{
+	uint64_t key = sectionKey(cfg, section);
+	std::map<uint, uint64_t>::iterator w = written.find(section);
+	if (w != written.end() && w->second == key) {
+		LOG4CXX_TRACE(logger, "Section " << section << " unchanged, not written");
+		return false;
+	}
+	written[section] = key;
+	return true;
+}
+
+// writes everything but the DACs to the playback memory, without running it
+void Spikey::encodeConfig(boost::shared_ptr<SpikeyConfig> cfg)
+{
+	// remember last config
+	actcfg = cfg;
+	// the saved state must not claim a configuration that may only be partially written, the
+	// sections written in this process stay known
+	if (cfghash) {
+		cfghash = 0;
+		saveState();
+	}
+
+	// sections with unchanged content are skipped, the arrays are only read to keep them shared
+	const SpikeyConfig& conf = *cfg;
+	writepending = true;
+	int valid = 0;
+	const SpikeyConfig::SCupdate sections[] = {SpikeyConfig::ud_param, SpikeyConfig::ud_chip,
+	                                           SpikeyConfig::ud_rowconfig,
+	                                           SpikeyConfig::ud_colconfig, SpikeyConfig::ud_weight};
+	for (uint i = 0; i < sizeof(sections) / sizeof(sections[0]); i++)
+		if ((conf.valid & sections[i]) && updateSection(conf, sections[i]))
+			valid |= sections[i];
+
+	if (valid & SpikeyConfig::ud_param) {
 		LOG4CXX_DEBUG(logger, "Updating parameter RAM");
 		vector<PramData> pd;
 		loadParam(cfg, pd);
@@ -259,7 +751,7 @@ MemObj Spikey::config(boost::shared_ptr<SpikeyConfig> cfg)
 		// optimize order of pram entires
 		getPC()->sort_pd_triangle(pd);
 		getPC()->check_pd_timing(pd, lut);
-		getPC()->write_pd(pd, 6, lut); // transfer to chip and config param update
+		getPC()->write_pd(pd, timing.pram, lut); // transfer to chip and config param update
 		getPC()->write_period(voutperiod - 1);
 		getPC()->write_parnum(pd.size());
 
@@ -285,39 +777,40 @@ MemObj Spikey::config(boost::shared_ptr<SpikeyConfig> cfg)
 
 		// calibParam();
 	}
-	if (cfg->valid & SpikeyConfig::ud_chip) {
+	if (valid & SpikeyConfig::ud_chip) {
 		LOG4CXX_DEBUG(logger, "Updating chip configuration");
-		getSC()->write_time((uint)round(cfg->tsense / clockper),
-		                    (uint)round(cfg->tpcsec / clockper),
-		                    (uint)round(cfg->tpcorperiod / clockper)); // time register
-		synfstdel = ControlInterface::synramdelay + (uint)round(cfg->tsense / clockper);
+		getSC()->write_time((uint)round(conf.tsense / clockper),
+		                    (uint)round(conf.tpcsec / clockper),
+		                    (uint)round(conf.tpcorperiod / clockper)); // time register
+		tsensedel = (uint)round(conf.tsense / clockper);
+		synfstdel = timing.synram + tsensedel;
 	}
 
 
 	// mapping d15-8: b1, d7-0, b0
-	if (cfg->valid & SpikeyConfig::ud_rowconfig) {
+	if (valid & SpikeyConfig::ud_rowconfig) {
 		LOG4CXX_DEBUG(logger, "Updating row config");
+		rowdata.resize(SpikeyConfig::num_presyns);
 		for (uint c = 0; c < SpikeyConfig::num_presyns; ++c) {
-			uint data = ((cfg->synapse[c + SpikeyConfig::num_presyns].config.to_ulong())
-			             << hw_const->sc_blockshift()) |
-			            (cfg->synapse[c].config.to_ulong());
+			uint data = rowConfig(conf, c);
 			getSC()->write_sram(c, 1 << hw_const->sc_rowconfigbit(), data,
 			                    synfstdel); // since rowconfig is only a single write per row, delay
 			                                // must always set to synfstdel
+			rowdata[c] = data;
 			//			if(data)dbg(Logger::DEBUG0)<<hex<<" d:"<<data;
 			getSC()->close();
 		}
 	}
 	// mapping d23-20: b0,n2; d19-16: b0,n1, d15-d12: b0, n0
 	//				d11-08: b1,n2; d07-04: b1,n1, d03-d00: b1, n0
-	if (cfg->valid & SpikeyConfig::ud_colconfig) {
+	if (valid & SpikeyConfig::ud_colconfig) {
 		LOG4CXX_DEBUG(logger, "Updating column config");
 		for (uint c = 0; c < SpikeyConfig::num_perprienc; ++c) {
 			uint d = 0;
 			for (uint b = 0; b < SpikeyConfig::num_blocks; ++b)
 				for (uint n = 0; n < SpikeyConfig::num_prienc; ++n) {
 					uint nidx = b * SpikeyConfig::num_neurons + c + n * SpikeyConfig::num_perprienc;
-					d |= shiftRamData(nidx, cfg->neuron[nidx].config.to_ulong());
+					d |= shiftRamData(nidx, conf.neuron[nidx].config.to_ulong());
 				}
 			getSC()->write_sram(0, (1 << hw_const->sc_neuronconfigbit()) | c, d,
 			                    c == 0 ? synfstdel : synramdel);
@@ -325,10 +818,10 @@ MemObj Spikey::config(boost::shared_ptr<SpikeyConfig> cfg)
 		getSC()->close();
 	}
 
-	if (cfg->valid & SpikeyConfig::ud_weight) {
+	if (valid & SpikeyConfig::ud_weight) {
 		LOG4CXX_DEBUG(logger, "Updating weights");
 		for (uint r = 0; r < SpikeyConfig::num_presyns; ++r) { // over all synapse drivers
-			valarray<ubyte> r0 = cfg->row(0, r), r1 = cfg->row(1, r);
+			valarray<ubyte> r0 = conf.row(0, r), r1 = conf.row(1, r);
 			for (uint c = 0; c < SpikeyConfig::num_perprienc;
 			     ++c) { // over number of priority encoder
 				uint d = 0;
@@ -343,55 +836,6 @@ MemObj Spikey::config(boost::shared_ptr<SpikeyConfig> cfg)
 			getSC()->close();
 		}
 	}
-
-	Flush();
-	Run();
-	waitPbFinished();
-
-	/* optional debug functionality:
-	// read back voltage parameters:
-	if(cfg->valid & SpikeyConfig::ud_param){
-	    getAR()->clear(0);
-	    getAR()->clear(1);
-
-	    for(uint chain=0;chain<2;chain++){
-	        if(chain==1) getAR()->clear(0);
-	        for(uint addr=0;addr<21;addr++) {
-
-	            getAR()->set((chain==0?getAR()->voutl:getAR()->voutr),addr,true,150);//set with
-	verify
-
-	            Flush();
-	            Run();
-
-	            if (getAR()->check_last(addr,false) == 1)
-	                ;//cout<<"Areadout check: positive"<<endl;
-	            else
-	                cout<<"Areadout check: negative"<<endl;
-
-	            vector<float> v;
-	            v.clear();
-	            for(int i=0;i<2;++i)v.push_back(readAdc(SBData::ibtest));
-
-	            double sum = std::accumulate(v.begin(), v.end(), 0.0);
-	            double mean = sum / v.size();
-
-	            double sq_sum = std::inner_product(v.begin(), v.end(), v.begin(), 0.0);
-	            double stdev = std::sqrt(sq_sum / v.size() - mean * mean);
-
-	            cout<<"chain " << chain << ", addr " << addr << ": ADC read: "<<mean<< ", stddev: "
-	<< stdev << endl;
-	        }
-	    }
-
-	    getAR()->clear(0);
-	    getAR()->clear(1);
-	    Flush();
-	    Run();
-	    waitPbFinished();
-	}*/
-
-	return MemObj(MemObj::ok);
 }
 
 // tries to calibrate vout by reading back membrane voltage and
@@ -520,14 +964,13 @@ vector<float> Spikey::calibParam(float prec, uint nadc, uint nmes, uint ndist, u
 }
 
 // transmit spiketrain 'st' and allocate nec. memory
-MemObj Spikey::sendSpikeTrain(const SpikeTrain& st, SpikeTrain* et, bool dropmod)
+MemObj Spikey::sendSpikeTrain(const SpikeTrain& st, SpikeTrain* et, bool dropmod,
+                              vector<uint>* shift)
 {
-	static_cast<void>(dropmod);
-
 	boost::shared_ptr<SC_Mem> mem(boost::dynamic_pointer_cast<SC_Mem>(bus));
 	// check temperature
 	assert(mem != NULL);
-	float temperature = mem->getSCTRL()->getTemp();
+	float temperature = mem->getSCTRL()->getTempCached();
 	if (temperature > tempMax) {
 		LOG4CXX_WARN(logger,
 		             "System temperature too high, communication links may become unstable.")
@@ -535,8 +978,10 @@ MemObj Spikey::sendSpikeTrain(const SpikeTrain& st, SpikeTrain* et, bool dropmod
 
 	//***** sync
 	// reset fifos and priority encoder
-	neuronreset = true;
-	writeSCtl(); // write control registers
+	if (!streamcont) {
+		neuronreset = true;
+		writeSCtl(); // write control registers
+	}
 
 	// reset event out buffers
 	for (uint i = 0; i < hw_const->event_outs(); i++)
@@ -557,17 +1002,22 @@ MemObj Spikey::sendSpikeTrain(const SpikeTrain& st, SpikeTrain* et, bool dropmod
 
 	Send(SpikenetComm::sync);
 
-	neuronreset = false;
-	writeSCtl();
+	if (!streamcont) {
+		neuronreset = false;
+		writeSCtl();
+	}
 
 	//***** events
+	bool shiftlate = mem->getSCTRL()->getShiftLate();
+	mem->getSCTRL()->setShiftLate(dropmod);
 	for (uint i = 0; i < st.d.size(); ++i)
 		Send(SpikenetComm::write, st.d[i]);
 
 	/* mute all outputs (after dummy spike) => fixes status data reads/spike race condition */
 	for (uint i = 0; i < hw_const->event_outs(); i++)
 		setCCBit(hw_const->cr_eout_rst() + i, true);
-	writeCC(100); // TP: TODO: should be mem->getMaxChainDelay()
+	writeCC(timing.chain);
+	mem->getSCTRL()->setShiftLate(shiftlate); // events have been encoded by now
 
 	// get buffer stats directly after execution.
 	// -> during readback, execute recspiketrain in the same order as sendSpikeTrain!
@@ -580,6 +1030,9 @@ MemObj Spikey::sendSpikeTrain(const SpikeTrain& st, SpikeTrain* et, bool dropmod
 		if (et != NULL) {
 			et->d = *(mem->eev(chip())); // copy error events
 			mem->eev(chip())->clear();   // clear error events
+			if (shift != NULL)
+				*shift = *(mem->eshift(chip()));
+			mem->eshift(chip())->clear();
 		}
 	}
 
@@ -587,6 +1040,158 @@ MemObj Spikey::sendSpikeTrain(const SpikeTrain& st, SpikeTrain* et, bool dropmod
 	return MemObj(MemObj::ok);
 }
 
+// the status reads of sendSpikeTrain are executed in each repetition but not evaluated
+MemObj Spikey::runRepeated(const SpikeTrain& st, uint n, vector<SpikeTrain>& out)
+{
+	boost::shared_ptr<SC_Mem> mem(boost::dynamic_pointer_cast<SC_Mem>(bus));
+	if (!mem) {
+		string msg = "Spikey::runRepeated: bus is not a playback memory";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	sendSpikeTrain(st);
+	Flush();
+	mem->runRepeated(n);
+
+	vector<vector<IData> > ev;
+	mem->recRepeated(ev);
+	out.resize(ev.size());
+	for (uint i = 0; i < ev.size(); i++)
+		out[i].d.swap(ev[i]);
+	return MemObj(MemObj::ok);
+}
+
+// Only the sync and the event buffer reset of sendSpikeTrain are repeated for the following
+// segments, the neurons keep their state across the restart gap.
+uint Spikey::runStream(SpikeyStream& stream, uint pbhalf, uint rechalf)
+{
+	boost::shared_ptr<SC_Mem> mem(boost::dynamic_pointer_cast<SC_Mem>(bus));
+	if (!mem) {
+		string msg = "Spikey::runStream: bus is not a playback memory";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	if (writepending) { // last configuration did not finish
+		forgetConfig();
+		writepending = false;
+	}
+	mem->startStream(pbhalf, rechalf);
+
+	SpikeTrain st;
+	if (!stream.next(0, st)) {
+		mem->Clear();
+		return 0;
+	}
+	uint num = 0;
+	try {
+		sendSpikeTrain(st);
+		Flush();
+		streamcont = true;
+		while (true) {
+			Run(); // waits for segment num - 1
+			num++;
+			SpikeTrain out;
+			if (mem->drainSegment(out.d))
+				stream.received(num - 2, out);
+
+			st.d.clear();
+			if (!stream.next(num, st))
+				break;
+			sendSpikeTrain(st);
+			Flush();
+		}
+		mem->endStream();
+		SpikeTrain out;
+		if (mem->drainSegment(out.d))
+			stream.received(num - 1, out);
+	} catch (...) {
+		streamcont = false;
+		mem->Clear();
+		throw;
+	}
+	streamcont = false;
+	LOG4CXX_DEBUG(logger, "Spikey::runStream: " << num << " segments");
+	return num;
+}
+
+// Segments are not pipelined, the next one is encoded from the reaction to the finished one.
+// Its upload and the preamble of sendSpikeTrain are part of the restart gap.
+uint Spikey::runClosedLoop(SpikeyStream& stream, uint pollus, uint pbhalf, uint rechalf)
+{
+	boost::shared_ptr<SC_Mem> mem(boost::dynamic_pointer_cast<SC_Mem>(bus));
+	if (!mem) {
+		string msg = "Spikey::runClosedLoop: bus is not a playback memory";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	if (writepending) { // last configuration did not finish
+		forgetConfig();
+		writepending = false;
+	}
+	mem->startStream(pbhalf, rechalf);
+
+	SpikeTrain st;
+	if (!stream.next(0, st)) {
+		mem->Clear();
+		return 0;
+	}
+	uint num = 0;
+	try {
+		sendSpikeTrain(st);
+		Flush();
+		streamcont = true;
+		while (true) {
+			Run();
+			num++;
+			SpikeTrain out;
+			bool done = false;
+			while (!done) {
+				done = mem->pollSegment(out.d);
+				if (!out.d.empty() || done) {
+					stream.received(num - 1, out);
+					out.d.clear();
+				}
+				if (!done)
+					usleep(pollus);
+			}
+
+			st.d.clear();
+			if (!stream.next(num, st))
+				break;
+			sendSpikeTrain(st);
+			Flush();
+		}
+		mem->endStream();
+	} catch (...) {
+		streamcont = false;
+		mem->Clear();
+		throw;
+	}
+	streamcont = false;
+	LOG4CXX_DEBUG(logger, "Spikey::runClosedLoop: " << num << " segments, max. reaction latency "
+	                                                << mem->getStats().reactmax << "s");
+	return num;
+}
+
+LinkReport Spikey::analyzeSpikeTrain(const SpikeTrain& st, bool dropmod)
+{
+	boost::shared_ptr<SC_Mem> mem(boost::dynamic_pointer_cast<SC_Mem>(bus));
+	if (!mem) {
+		string msg = "Spikey::analyzeSpikeTrain: bus is not a playback memory";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	boost::shared_ptr<SC_SlowCtrl> sc = mem->getSCTRL();
+	// system time after the sync and the control register write of sendSpikeTrain
+	uint stime = sc->getSyncMax() + SpikenetComm::basedelay + ControlInterface::cidelay;
+	bool shiftlate = sc->getShiftLate();
+	sc->setShiftLate(dropmod);
+	LinkReport r;
+	sc->analyzeEvt(st.d, r, stime, chip());
+	sc->setShiftLate(shiftlate);
+	return r;
+}
+
 // hack!
 void Spikey::replayPB()
 {
@@ -753,13 +1358,133 @@ MemObj Spikey::recSpikeTrain(SpikeTrain& st, bool nonblocking)
 	if (mem != NULL) { // check if correct subclass used as bus
 		st.d = *(mem->rcvd(chip())); // better use move from c++11, or swap
 		mem->rcvd(chip())->clear();
+		if (mem->getSpikeIndex())
+			mem->getSpikeIndex()->finish(st.d);
 	} else
 		return MemObj(MemObj::invalid);
 	return MemObj(MemObj::ok);
 }
 
+void Spikey::setSpikeIndex(boost::shared_ptr<SpikeIndex> idx)
+{
+	boost::shared_ptr<SC_Mem> mem(boost::dynamic_pointer_cast<SC_Mem>(bus));
+	if (!mem) {
+		string msg = "Spikey::setSpikeIndex: bus is not a playback memory";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	mem->setSpikeIndex(idx, chip());
+}
+
+boost::shared_ptr<SpikeIndex> Spikey::getSpikeIndex()
+{
+	boost::shared_ptr<SC_Mem> mem(boost::dynamic_pointer_cast<SC_Mem>(bus));
+	return mem ? mem->getSpikeIndex() : boost::shared_ptr<SpikeIndex>();
+}
+
+// all trials are encoded back to back, each starting with the fifo reset and sync of
+// sendSpikeTrain, so event times restart at zero for every trial. The status reads at the end of
+// each trial follow its last recorded event, hence receiving in the same order splits the record
+// memory into the trials.
+MemObj Spikey::runTrials(vector<SpikeyTrial>& trials)
+{
+	boost::shared_ptr<SC_Mem> mem(boost::dynamic_pointer_cast<SC_Mem>(bus));
+	if (!mem) {
+		string msg = "Spikey::runTrials: bus is not a playback memory";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	// check before anything is written to the playback memory
+	for (uint i = 0; i < trials.size(); i++) {
+		if (trials[i].cfg && (trials[i].cfg->valid & SpikeyConfig::ud_dac)) {
+			string msg = "Spikey::runTrials: DACs of trial " + to_str(i) +
+			             " cannot be set synchronously to the playback memory, use config()";
+			LOG4CXX_ERROR(logger, msg);
+			throw std::runtime_error(msg);
+		}
+	}
+
+	if (writepending) { // last configuration did not finish
+		forgetConfig();
+		writepending = false;
+	}
+	for (uint i = 0; i < trials.size(); i++) {
+		if (trials[i].quiesce)
+			quiesce();
+		if (trials[i].cfg)
+			encodeConfig(trials[i].cfg);
+		trials[i].dropped.d.clear();
+		sendSpikeTrain(trials[i].in, &trials[i].dropped);
+	}
+	LOG4CXX_DEBUG(logger, "Spikey::runTrials: running " << trials.size() << " trials");
+	Flush();
+	Run();
+	waitPbFinished();
+	writepending = false;
+
+	for (uint i = 0; i < trials.size(); i++) {
+		if (recSpikeTrain(trials[i].out)._state != MemObj::ok)
+			return MemObj(MemObj::invalid);
+	}
+	return MemObj(MemObj::ok);
+}
+
+uint Spikey::rowConfig(const SpikeyConfig& cfg, uint r)
+{
+	return ((cfg.synapse[r + SpikeyConfig::num_presyns].config.to_ulong())
+	        << hw_const->sc_blockshift()) |
+	       (cfg.synapse[r].config.to_ulong());
+}
+
+void Spikey::quiesce(uint wait, boost::shared_ptr<const SpikeyConfig> cfg)
+{
+	vector<uint> rows = rowdata;
+	if (rows.size() != SpikeyConfig::num_presyns && cfg) {
+		LOG4CXX_DEBUG(logger, "Spikey::quiesce: row config taken from the given configuration");
+		rows.resize(SpikeyConfig::num_presyns);
+		for (uint r = 0; r < SpikeyConfig::num_presyns; ++r)
+			rows[r] = rowConfig(*cfg, r);
+	}
+
+	// synapse drivers neither excitatory nor inhibitory (row config bits 2 and 3) in both blocks
+	uint mute = (0xc << hw_const->sc_blockshift()) | 0xc;
+	if (rows.size() == SpikeyConfig::num_presyns) {
+		for (uint r = 0; r < SpikeyConfig::num_presyns; ++r) {
+			getSC()->write_sram(r, 1 << hw_const->sc_rowconfigbit(), rows[r] & ~mute, synfstdel);
+			getSC()->close();
+		}
+	} else
+		LOG4CXX_WARN(logger, "Spikey::quiesce: row config unknown, synapse drivers not muted");
+
+	// drop all queued events
+	vector<bool> oldreg = statusreg;
+	for (uint i = 0; i < hw_const->event_outs(); i++)
+		setCCBit(hw_const->cr_eout_rst() + i, true);
+	for (uint i = 0; i < hw_const->event_ins(); i++) {
+		setCCBit(hw_const->cr_einb_rst() + i, true);
+		setCCBit(hw_const->cr_ein_rst() + i, true);
+	}
+	writeCC(hw_const->fifo_reset_delay());
+
+	bool oldnr = neuronreset;
+	neuronreset = true;
+	writeSCtl(wait);
+	neuronreset = oldnr;
+	writeSCtl();
+
+	statusreg = oldreg;
+	writeCC(hw_const->fifo_reset_delay());
+
+	if (rows.size() == SpikeyConfig::num_presyns) {
+		for (uint r = 0; r < SpikeyConfig::num_presyns; ++r) {
+			getSC()->write_sram(r, 1 << hw_const->sc_rowconfigbit(), rows[r], synfstdel);
+			getSC()->close();
+		}
+	}
+}
+
 // convert parameters to spikey format
-void Spikey::loadParam(boost::shared_ptr<SpikeyConfig> c, vector<PramData>& pd)
+void Spikey::loadParam(boost::shared_ptr<const SpikeyConfig> c, vector<PramData>& pd)
 {
 	LOG4CXX_WARN(logger, "using spikey without calibration");
 	pd.clear();
@@ -19,6 +19,88 @@ class TMEarlyDebug;
 namespace spikey2
 {
 
+//! One trial of a batch executed by Spikey::runTrials
+struct SpikeyTrial
+{
+	//! configuration applied before the trial, NULL to keep the current one. Only the parts of the
+	//! chip written via the playback memory may be valid, i.e. not SpikeyConfig::ud_dac
+	boost::shared_ptr<SpikeyConfig> cfg;
+	SpikeTrain in;      //!< spike train sent to the chip, times relative to the trial start
+	SpikeTrain out;     //!< received spike train, times relative to the trial start
+	SpikeTrain dropped; //!< events that could not be transmitted
+	bool quiesce;       //!< stop remaining activity before the trial, see Spikey::quiesce
+
+	SpikeyTrial() : quiesce(false){};
+	SpikeyTrial(const SpikeTrain& st,
+	            boost::shared_ptr<SpikeyConfig> c = boost::shared_ptr<SpikeyConfig>(),
+	            bool quiesce = false)
+	    : cfg(c), in(st), quiesce(quiesce){};
+};
+
+//! Stimulus and results of an experiment executed segment by segment by Spikey::runStream or
+//! Spikey::runClosedLoop
+class SpikeyStream
+{
+public:
+	virtual ~SpikeyStream(){};
+	//! fills st with the stimulus of segment i, times relative to the segment start. Returns
+	//! false if the experiment ends before segment i. Called while segment i - 1 runs
+	//! (runStream) or after it has finished (runClosedLoop).
+	virtual bool next(uint i, SpikeTrain& st) = 0;
+	//! events received during segment i, times relative to its start. Called once per segment
+	//! by runStream and as soon as new events are available by runClosedLoop.
+	virtual void received(uint i, SpikeTrain& st) = 0;
+};
+
+
+//! Station state persisted by Spikey to attach to an already initialized chip without running
+//! Spikey::initialize again, see Spikey(comm, statefile, ...)
+struct SpikeyState
+{
+	uint revision;
+	std::string workstation;
+	float clockper;
+	uint64_t statusreg; //!< chip control register
+	vector<LutData> lut; //!< parameter RAM LUTs
+	bool pramsettled; //!< analog parameters settled, no DLL reset needed
+	uint64_t cfghash; //!< SpikeyConfig::hash of the last configuration, 0 if unknown
+
+	SpikeyState() : revision(0), clockper(0), statusreg(0), pramsettled(false), cfghash(0){};
+	//! returns false if the file does not exist or is incomplete
+	bool read(std::string filename);
+	bool write(std::string filename) const;
+};
+
+
+//! Delays in clock cycles between control interface commands, computed by model for the revision
+//! and clock period or tuned on a station by Spikey::calibrateTiming
+struct CITiming
+{
+	uint revision;
+	float clockper;
+	uint synram;     //!< first synapse ram access of a row, Spikey adds tsense
+	uint synramnext; //!< further synapse ram accesses of the open row
+	uint synread;    //!< synapse ram read for readback of weights
+	uint pram;       //!< parameter ram access
+	uint ar;         //!< analog readout chain access
+	uint chain;      //!< control register write until the event path has settled
+
+	CITiming()
+	    : revision(0),
+	      clockper(0),
+	      synram(0),
+	      synramnext(0),
+	      synread(0),
+	      pram(0),
+	      ar(0),
+	      chain(0){};
+	//! minimal safe delays from the timing model in hw for clock period clockper (ns)
+	static CITiming model(const HardwareConstants& hw, float clockper);
+	//! returns false if the file does not exist or is incomplete
+	bool read(std::string filename);
+	bool write(std::string filename) const;
+};
+
 
 //! Main spikey interface
 class Spikey : public Spikenet
@@ -31,6 +113,7 @@ class Spikey : public Spikenet
 	friend class ::PySpikeyTM;
 	friend class SpikeyCalibratable;
 	friend class SpikeyVoutCalib;
+	friend class SpikeyScheduler;
 
 private:
 	float clockper; // main spikey core clock period (5 to 10ns)
@@ -38,7 +121,9 @@ private:
 	uint lutboost; // (19-1)=18: in 5+3*20+2*5, pramtime is 1<<lutboost + 3: 35, !67!, 131, 259
 	static const float voutslope; // 1.54/(1.958*150); //Volt per microamp*nanosecs
 
+	CITiming timing;
 	uint synramdel, synfstdel; // delay for synapse ram access
+	uint tsensedel;            // tsense of the chip configuration in clock cycles
 
 	// bitset<cr_width> statusreg;
 	vector<bool> statusreg;
@@ -52,7 +137,7 @@ private:
 	                         uint nmes = 100, // number of measurements
 	                         uint ndist = 100, // number of pram writes to disturb pram logic
 	                         uint maxnmes = 2000); // maximum number of tries for precision
-	virtual void loadParam(boost::shared_ptr<SpikeyConfig>, vector<PramData>&);
+	virtual void loadParam(boost::shared_ptr<const SpikeyConfig>, vector<PramData>&);
 	virtual uint convVoltDac(double voltage);
 	double convDacVolt(uint dac);
 	uint convCurDac(double current);
@@ -68,6 +153,44 @@ private:
 	bool pram_settled; // stores, whether analog parameter memories can be assumed as settled after
 	                   // a chip reset
 
+	// writes all valid parts of cfg except the DACs to the playback memory, skipping sections
+	// whose content is already on the chip
+	void encodeConfig(boost::shared_ptr<SpikeyConfig> cfg);
+
+	// SpikeyConfig::generation of the sections on the chip, missing if unknown
+	std::map<uint, uint64_t> written;
+	// encoded, but not yet confirmed by a finished playback memory program
+	bool writepending;
+	// sendSpikeTrain continues the network of the previous segment of runStream
+	bool streamcont;
+	// row configuration on the chip, empty if unknown
+	vector<uint> rowdata;
+	// row configuration data of synapse driver row r (both blocks) of cfg
+	uint rowConfig(const SpikeyConfig& cfg, uint r);
+	// nothing known about the configuration on the chip
+	void forgetConfig()
+	{
+		written.clear();
+		rowdata.clear();
+	};
+	uint64_t sectionKey(const SpikeyConfig& cfg, SpikeyConfig::SCupdate section);
+	// returns whether section of cfg differs from the chip and records it as written
+	bool updateSection(const SpikeyConfig& cfg, SpikeyConfig::SCupdate section);
+
+	std::string statefile; // persisted station state, empty if not used
+	bool attached; // constructed from a valid state file
+	uint64_t cfghash; // hash of the configuration on the chip, 0 if unknown
+
+	// member defaults shared by initialize and attach
+	void initDefaults();
+	// restores the state from statefile if it matches the chip, otherwise returns false
+	bool attach();
+
+	// write/readback tests of calibrateTiming
+	enum TimingTest { tt_synram, tt_synramnext, tt_synread, tt_pram };
+	bool testTiming(TimingTest test, uint del, uint repeat);
+	uint tuneDelay(TimingTest test, uint start, uint repeat);
+
 	static constexpr float tempMax = 55.0; //!< max temperature; for higher temperature
 	                                       //communication links may become unstable (see issue
 	                                       //#1418)
@@ -88,10 +211,37 @@ public:
 
 	Spikey(boost::shared_ptr<Spikenet> spnet, float clockper = 10.0, uint chipid = 0);
 	Spikey(boost::shared_ptr<SpikenetComm> comm, float clockper = 10.0, uint chipid = 0);
+	//! attaches to an initialized chip using the state saved in statefile, which is much faster
+	//! than initialize. Falls back to initialize if the file is missing or does not match the
+	//! setup or the chip control register, e.g. after a power cycle. The state is updated after
+	//! each config.
+	Spikey(boost::shared_ptr<SpikenetComm> comm, std::string statefile, float clockper = 10.0,
+	       uint chipid = 0);
 	virtual ~Spikey(){};
 	float getClkPer() { return clockper; };
 
 	void initialize();
+	//! true if the constructor attached to an initialized chip instead of calling initialize
+	bool warmAttached() { return attached; };
+	//! writes the state file (if used), called by the constructor and config
+	void saveState();
+	//! marks the configuration on the chip as unknown, i.e. the next config writes all valid
+	//! sections, also after an attach. Required after modifying the chip without config, e.g. by
+	//! STDP weight updates, or after changing the parameter calibration.
+	void invalidateState();
+
+	//! delays between control interface commands, initialized from the tuned values of the
+	//! station (see timingFile) if available, otherwise from CITiming::model
+	const CITiming& getTiming() { return timing; };
+	void setTiming(const CITiming& t);
+	//! file with the tuned timing of the station, empty without SPIKEYHALPATH or station
+	std::string timingFile();
+	//! searches the minimal delays of synapse and parameter ram accesses that pass a write and
+	//! readback test repeated repeat times, starting at the current timing. Adds margin cycles,
+	//! uses the result and stores it to file (default timingFile()). The other delays are taken
+	//! from the model. Overwrites the weights of the first rows, i.e. the next config writes all
+	//! sections.
+	CITiming calibrateTiming(std::string file = "", uint margin = 1, uint repeat = 8);
 
 	//! enables/disables the connection of the experiment trigger signal to the global trigger line
 	//of the backplane
@@ -107,7 +257,13 @@ public:
 	// and stored in et. If it is true, those events' time stamps will be increased to hopefully
 	// transfer them.
 	// In this case, !!! something has to be done with the modified events!!! ;-)
-	MemObj sendSpikeTrain(const SpikeTrain& st, SpikeTrain* et = NULL, bool dropmod = false);
+	// Events are delayed by the smallest possible amount, the modified events in et carry their new
+	// time stamps and shift receives the time shift of each of them (in IData time units).
+	MemObj sendSpikeTrain(const SpikeTrain& st, SpikeTrain* et = NULL, bool dropmod = false,
+	                      vector<uint>* shift = NULL);
+	//! predicts how sendSpikeTrain would encode st (drops, input buffer occupancy, length)
+	//! without touching the playback memory, see SC_SlowCtrl::analyzeEvt
+	LinkReport analyzeSpikeTrain(const SpikeTrain& st, bool dropmod = false);
 	void replayPB();
 
 	// (sf) wait until playback is idle again an update pointers
@@ -117,6 +273,44 @@ public:
 	// the last transmitted spiketrain (st.state==invalid) or (st.adr) is send and the received data
 	// collected in 'st'
 	MemObj recSpikeTrain(SpikeTrain& st, bool nonblocking = true);
+	//! recSpikeTrain fills idx with the per-neuron index and statistics of each received spike
+	//! train, accumulated while decoding. NULL to disable.
+	void setSpikeIndex(boost::shared_ptr<SpikeIndex> idx);
+	boost::shared_ptr<SpikeIndex> getSpikeIndex();
+
+	//! executes several trials with a single playback memory program, i.e. with one transfer,
+	//! start and readback, and splits the received events into the out spike train of each trial
+	MemObj runTrials(vector<SpikeyTrial>& trials);
+
+	//! writes a preamble to the playback memory that stops all network activity without
+	//! touching the weights: mutes all synapse drivers via the row configuration, resets the event
+	//! buffers, holds the neurons in reset for wait clock cycles and restores the row
+	//! configuration. Run it with the next experiment, i.e. before sendSpikeTrain. The row
+	//! configuration is the one last written by config or, if that is no longer known (e.g. after
+	//! invalidateState or a warm attach), the one of cfg. Without either, the drivers are not
+	//! muted and a warning is logged.
+	void quiesce(uint wait = 10000, boost::shared_ptr<const SpikeyConfig> cfg =
+	                                    boost::shared_ptr<const SpikeyConfig>());
+
+	//! sends spike train st once and presents it n times by repeating the playback memory program,
+	//! out[i] receives the events of repetition i with times relative to its start
+	MemObj runRepeated(const SpikeTrain& st, uint n, vector<SpikeTrain>& out);
+
+	//! runs an experiment of arbitrary length as a sequence of segments, see SC_Mem::startStream.
+	//! The stimulus of the next segment is encoded and uploaded and the events of the previous
+	//! one are received while a segment runs, so host memory does not grow with the duration.
+	//! Each segment starts with a sync like sendSpikeTrain, but only the first one resets the
+	//! neurons. pbhalf and rechalf limit the size of a segment in playback and record memory
+	//! words (0: half of the memory). Returns the number of segments, Clear() before the next
+	//! experiment.
+	uint runStream(SpikeyStream& stream, uint pbhalf = 0, uint rechalf = 0);
+	//! closed-loop variant of runStream: the record memory of the running segment is polled
+	//! every pollus microseconds, new events are passed to SpikeyStream::received immediately and
+	//! the stimulus of the next segment is requested when the segment has finished, i.e. it can
+	//! react to all events of the previous one. The reaction latency is at most the segment
+	//! duration plus the restart gap, both are reported in getStats() of the SC_Mem bus.
+	uint runClosedLoop(SpikeyStream& stream, uint pollus = 100, uint pbhalf = 0,
+	                   uint rechalf = 0);
 
 
 	void setFifoDepth(int depth, int delay = 4);
@@ -51,6 +51,17 @@ SpikeyCalibratable::SpikeyCalibratable(boost::shared_ptr<SpikenetComm> comm, flo
 	}
 }
 
+SpikeyCalibratable::SpikeyCalibratable(boost::shared_ptr<SpikenetComm> comm, string statefile,
+                                       float clk, uint chipid, int spikeyNr, string calibfile)
+    : Spikey(comm, statefile, clk, chipid)
+{
+	clb.reset(new SpikeyVoutCalib(this, spikeyNr, calibfile));
+	convVoltDacWarnings.resize(SpikeyConfig::num_blocks * hw_const->ar_numvouts());
+	for (uint i = 0; i < SpikeyConfig::num_blocks * hw_const->ar_numvouts(); ++i) {
+		convVoltDacWarnings[i] = 1; // 1 warning, then silence
+	}
+}
+
 // !!! this the convVoltDac for SPIKEY2 !!!
 uint SpikeyCalibratable::convVoltDac(double voltage, int voutNr)
 {
@@ -75,7 +86,7 @@ uint SpikeyCalibratable::convVoltDac(double voltage, int voutNr)
 
 
 //! convert paramters to spikey format
-void SpikeyCalibratable::loadParam(boost::shared_ptr<SpikeyConfig> c, vector<PramData>& pd)
+void SpikeyCalibratable::loadParam(boost::shared_ptr<const SpikeyConfig> c, vector<PramData>& pd)
 {
 	LOG4CXX_DEBUG(logger, "using spikey calibratable");
 	pd.clear();
@@ -26,11 +26,14 @@ public:
 	                   string calibfile = "spikeycalib.xml");
 	SpikeyCalibratable(boost::shared_ptr<SpikenetComm> comm, float clk = 10.0, uint chipid = 0, int spikeyNr = 0,
 			           string calibfile = "spikeycalib.xml");
+	//! warm attach using a state file, see Spikey
+	SpikeyCalibratable(boost::shared_ptr<SpikenetComm> comm, string statefile, float clk = 10.0,
+	                   uint chipid = 0, int spikeyNr = 0, string calibfile = "spikeycalib.xml");
 	virtual ~SpikeyCalibratable(){};
 	boost::shared_ptr<SpikeyVoutCalib> clb;
 
 private:
-	virtual void loadParam(boost::shared_ptr<SpikeyConfig>, vector<PramData>&);
+	virtual void loadParam(boost::shared_ptr<const SpikeyConfig>, vector<PramData>&);
 	virtual uint convVoltDac(double voltage, int voutNr = 0);
 	vector<uint> convVoltDacWarnings;
 };
@@ -12,10 +12,18 @@
 
 #include "spikeyconfig.h"
 
+#include <atomic>
+
 static log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("HAL.Cfg");
 
 using namespace spikey2;
 
+uint64_t spikey2::nextGeneration()
+{
+	static std::atomic<uint64_t> last(0);
+	return ++last;
+}
+
 SpikeyConfig::SpikeyConfig()
     : dbg(::Logger::instance()), hw_const(new HardwareConstantsRev5USB), valid(ud_none)
 {
@@ -124,6 +132,108 @@ bool SpikeyConfig::writeParam(string name)
 	return o.good();
 }
 
+namespace
+{
+// FNV-1a
+void hashBytes(uint64_t& h, const void* data, size_t len)
+{
+	const unsigned char* p = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < len; i++)
+		h = (h ^ p[i]) * 0x100000001b3ULL;
+}
+
+void hashFloats(uint64_t& h, const vector<float>& v)
+{
+	uint64_t n = v.size();
+	hashBytes(h, &n, sizeof(n));
+	if (n)
+		hashBytes(h, v.data(), n * sizeof(float));
+}
+}
+
+uint64_t SpikeyConfig::hash() const
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	uint64_t v = valid;
+	hashBytes(h, &v, sizeof(v));
+	if (valid & ud_chip) {
+		float t[3] = {tsense, tpcsec, tpcorperiod};
+		hashBytes(h, t, sizeof(t));
+	}
+	if (valid & ud_dac) {
+		float d[5] = {irefdac, vcasdac, vm, vrest, vstart};
+		hashBytes(h, d, sizeof(d));
+	}
+	if (valid & ud_param) {
+		hashFloats(h, voutbias);
+		hashFloats(h, probebias);
+		hashFloats(h, outamp);
+		hashFloats(h, biasb);
+		hashFloats(h, vout);
+		hashFloats(h, probepad);
+		for (uint i = 0; i < neuron.size(); i++) {
+			float n[2] = {neuron[i].ileak, neuron[i].icb};
+			hashBytes(h, n, sizeof(n));
+		}
+		for (uint i = 0; i < synapse.size(); i++) {
+			float s[4] = {synapse[i].drviout, synapse[i].adjdel, synapse[i].drvifall,
+			              synapse[i].drvirise};
+			hashBytes(h, s, sizeof(s));
+		}
+	}
+	if (valid & ud_colconfig)
+		for (uint i = 0; i < neuron.size(); i++) {
+			unsigned long c = neuron[i].config.to_ulong();
+			hashBytes(h, &c, sizeof(c));
+		}
+	if (valid & ud_rowconfig)
+		for (uint i = 0; i < synapse.size(); i++) {
+			unsigned long c = synapse[i].config.to_ulong();
+			hashBytes(h, &c, sizeof(c));
+		}
+	if ((valid & ud_weight) && weight.size())
+		hashBytes(h, &weight[0], weight.size());
+	return h;
+}
+
+uint64_t SpikeyConfig::generation(SCupdate section) const
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	switch (section) {
+		case ud_weight:
+			return weight.generation();
+		case ud_rowconfig:
+			return synapse.generation();
+		case ud_colconfig:
+			return neuron.generation();
+		case ud_chip: {
+			float t[3] = {tsense, tpcsec, tpcorperiod};
+			hashBytes(h, t, sizeof(t));
+			return h;
+		}
+		case ud_dac: {
+			float d[5] = {irefdac, vcasdac, vm, vrest, vstart};
+			hashBytes(h, d, sizeof(d));
+			return h;
+		}
+		case ud_param: {
+			uint64_t g[2] = {neuron.generation(), synapse.generation()};
+			hashBytes(h, g, sizeof(g));
+			hashFloats(h, voutbias);
+			hashFloats(h, probebias);
+			hashFloats(h, outamp);
+			hashFloats(h, biasb);
+			hashFloats(h, vout);
+			hashFloats(h, probepad);
+			return h;
+		}
+		default:
+			string msg = "SpikeyConfig::generation: invalid section " + to_str((uint)section);
+			LOG4CXX_ERROR(logger, msg);
+			throw std::runtime_error(msg);
+	}
+}
+
 namespace spikey2
 {
 // a few names
@@ -144,8 +254,9 @@ ostream& operator<<(ostream& o, const SpikeyConfig& origCfg)
 {
 	o << spikeyconfig_name << dec << endl;
 	o.precision(4);
-	SpikeyConfig cfg = SpikeyConfig(origCfg);
-	cfg.valid = SpikeyConfig::ud_all;
+	SpikeyConfig copy = SpikeyConfig(origCfg); // shares the arrays
+	copy.valid = SpikeyConfig::ud_all;
+	const SpikeyConfig& cfg = copy; // read only, must not copy the arrays
 	if (cfg.valid & SpikeyConfig::ud_chip) {
 		o << ud_chip_name << " " << bool(origCfg.valid & SpikeyConfig::ud_chip) << endl;
 		o << tsense_name << " " << cfg.tsense << " " << tpcsec_name << " " << cfg.tpcsec << " "
@@ -578,6 +689,81 @@ bool lessneuron(const IData& a, const IData& b)
 {
 	return a.neuronAdr() < b.neuronAdr();
 }
+SpikeIndex::SpikeIndex(uint numneurons, uint isibins, uint isibinwidth)
+    : count(numneurons),
+      first(numneurons),
+      last(numneurons),
+      isi(numneurons * isibins),
+      offset(numneurons + 1),
+      outofrange(0),
+      isibins(isibins),
+      isibinwidth(isibinwidth),
+      done(false)
+{
+	if (!isibins || !isibinwidth) {
+		string msg = "SpikeIndex: ISI histogram needs at least one bin of nonzero width";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+}
+
+void SpikeIndex::clear()
+{
+	fill(count.begin(), count.end(), 0);
+	fill(first.begin(), first.end(), 0);
+	fill(last.begin(), last.end(), 0);
+	fill(isi.begin(), isi.end(), 0);
+	fill(offset.begin(), offset.end(), 0);
+	times.clear();
+	outofrange = 0;
+	done = false;
+}
+
+void SpikeIndex::add(const IData& e)
+{
+	if (done)
+		clear();
+	uint n = e.neuronAdr();
+	if (n >= count.size()) {
+		outofrange++;
+		return;
+	}
+	uint t = e.time();
+	if (count[n]++ == 0) {
+		first[n] = last[n] = t;
+		return;
+	}
+	if (t >= last[n]) { // received events are not strictly sorted in time
+		isi[n * isibins + min((t - last[n]) / isibinwidth, isibins - 1)]++;
+		last[n] = t;
+	}
+}
+
+void SpikeIndex::finish(const vector<IData>& d)
+{
+	// the index may have been set while events were already decoded
+	size_t total = outofrange;
+	for (uint n = 0; n < count.size(); n++)
+		total += count[n];
+	if (done || total != d.size()) {
+		LOG4CXX_DEBUG(logger, "SpikeIndex::finish: accumulating " << d.size() << " events again");
+		clear();
+		for (uint i = 0; i < d.size(); i++)
+			add(d[i]);
+	}
+
+	// counting sort by neuron
+	offset[0] = 0;
+	for (uint n = 0; n < count.size(); n++)
+		offset[n + 1] = offset[n] + count[n];
+	times.resize(offset.back());
+	vector<uint> pos(offset.begin(), offset.end() - 1);
+	for (uint i = 0; i < d.size(); i++)
+		if (d[i].neuronAdr() < count.size())
+			times[pos[d[i].neuronAdr()]++] = d[i].time();
+	done = true;
+}
+
 bool lessntime(const IData& a, const IData& b)
 {
 	if (a.clk() != b.clk())
@@ -595,9 +781,15 @@ ostream& operator<<(ostream& o, const SpikeTrain& st)
 		o << "no events" << endl;
 		return o; // nothing to print
 	}
-	// sort spiketrain in time
-	vector<IData> sst = st.d;
-	sort(sst.begin(), sst.end(), lessntime);
+	// sort spiketrain in time, copy only if necessary
+	vector<IData> sorted;
+	const vector<IData>* pst = &st.d;
+	if (!is_sorted(st.d.begin(), st.d.end(), lessntime)) {
+		sorted = st.d;
+		sort(sorted.begin(), sorted.end(), lessntime);
+		pst = &sorted;
+	}
+	const vector<IData>& sst = *pst;
 	uint starttime = sst[0].clk();
 	uint endtime = sst[sst.size() - 1].clk();
 
@@ -36,6 +36,85 @@ public:
 };
 
 
+//! returns a new, process-wide unique generation number, never 0
+uint64_t nextGeneration();
+
+//! Copy-on-write array used for the large sections of SpikeyConfig: copies share the data until
+//! one of them is modified. The generation identifies the content, i.e. two arrays with the same
+//! generation hold the same data. Any non-const access counts as modification, so read via a
+//! const reference where possible. References obtained from a non-const access must not be kept
+//! beyond the next call to generation(), e.g. by Spikey::config.
+template <typename T>
+class CowArray
+{
+public:
+	CowArray() : data(new std::valarray<T>()), gen(nextGeneration()), sealed(false){};
+	CowArray(const CowArray& o) : data(o.data), gen(o.gen), sealed(true) { o.sealed = true; };
+	CowArray(const std::valarray<T>& v)
+	    : data(new std::valarray<T>(v)), gen(nextGeneration()), sealed(false){};
+	CowArray& operator=(const CowArray& o)
+	{
+		data = o.data;
+		gen = o.gen;
+		sealed = o.sealed = true;
+		return *this;
+	};
+	CowArray& operator=(const std::valarray<T>& v)
+	{
+		replace(new std::valarray<T>(v));
+		return *this;
+	};
+	//! sets all elements to v
+	CowArray& operator=(const T& v)
+	{
+		replace(new std::valarray<T>(v, data->size()));
+		return *this;
+	};
+
+	size_t size() const { return data->size(); };
+	//! like std::valarray::resize, all elements are set to v
+	void resize(size_t n, T v = T()) { replace(new std::valarray<T>(v, n)); };
+
+	const T& operator[](size_t i) const { return (*data)[i]; };
+	T& operator[](size_t i) { return modify()[i]; };
+	std::valarray<T> operator[](std::slice s) const { return (*data)[s]; };
+	std::slice_array<T> operator[](std::slice s) { return modify()[s]; };
+
+	const std::valarray<T>& get() const { return *data; };
+	operator const std::valarray<T>&() const { return *data; };
+
+	uint64_t generation() const
+	{
+		sealed = true;
+		return gen;
+	};
+	//! true if the data is shared with another array
+	bool shared() const { return !data.unique(); };
+
+private:
+	boost::shared_ptr<std::valarray<T> > data;
+	uint64_t gen;
+	// generation was handed out, the next modification needs a new one
+	mutable bool sealed;
+
+	std::valarray<T>& modify()
+	{
+		if (!data.unique())
+			data.reset(new std::valarray<T>(*data));
+		if (sealed) {
+			gen = nextGeneration();
+			sealed = false;
+		}
+		return *data;
+	};
+	void replace(std::valarray<T>* v)
+	{
+		data.reset(v);
+		gen = nextGeneration();
+		sealed = false;
+	};
+};
+
 // ******** configures a spikey chip ******
 //! Container class for all configuration parameter values of a Spikey chip.
 class SpikeyConfig
@@ -99,7 +178,7 @@ public:
 			icb = 0;
 		};
 	};
-	std::valarray<NeuronConf> neuron;
+	CowArray<NeuronConf> neuron;
 
 	struct SynapseConf
 	{
@@ -114,13 +193,13 @@ public:
 			drvirise = 0;
 		};
 	};
-	std::valarray<SynapseConf> synapse;
+	CowArray<SynapseConf> synapse;
 
 	// weights: three dimensions:
 	// outer: block 0,1
 	// middle: row 0-255
 	// inner: col 0-3*64
-	std::valarray<ubyte> weight;
+	CowArray<ubyte> weight;
 
 	// ******** Constructors ********
 	SpikeyConfig(); // nothing valid after default const.
@@ -154,6 +233,13 @@ public:
 	bool writeParam(string name);
 	bool readParam(string name);
 
+	//! hash of all valid fields, equal configurations give equal hashes
+	uint64_t hash() const;
+	//! identifies the content of a single section (ud_chip, ud_dac, ud_param, ud_rowconfig,
+	//! ud_colconfig or ud_weight) within this process: equal values mean equal content. Uses the
+	//! generations of the shared arrays and hashes the small fields. Not valid for other sections.
+	uint64_t generation(SCupdate section) const;
+
 	void updateHardwareConstants(boost::shared_ptr<HardwareConstants>);
 
 	// ******* stream spikeyconfig *******
@@ -214,6 +300,40 @@ public:
 	bool readFromFile(string filename);
 };
 
+// ******* per-neuron index of a spike train ********
+//! Per-neuron index and statistics of received events. Counts, first and last spike and ISI
+//! histogram are accumulated while the events are decoded (see Spikey::setSpikeIndex),
+//! Spikey::recSpikeTrain then completes the CSR index of the received spike train.
+class SpikeIndex
+{
+public:
+	//! isibinwidth in IData time units, the last ISI bin also counts all longer intervals
+	SpikeIndex(uint numneurons = 384, uint isibins = 100, uint isibinwidth = 160);
+
+	void clear();
+	//! accumulates the statistics of one event
+	void add(const IData& e);
+	//! builds offset and times for the spike train d the added events were stored in. The next
+	//! add() starts a new accumulation.
+	void finish(const vector<IData>& d);
+
+	uint numNeurons() const { return count.size(); };
+	uint isiBins() const { return isibins; };
+	uint isiBinWidth() const { return isibinwidth; };
+
+	vector<uint> count;  //!< number of spikes per neuron
+	vector<uint> first;  //!< time of first spike, valid if count > 0
+	vector<uint> last;   //!< time of last spike, valid if count > 0
+	vector<uint> isi;    //!< ISI histograms, isiBins() entries per neuron
+	vector<uint> offset; //!< spikes of neuron n are times[offset[n]] .. times[offset[n + 1] - 1]
+	vector<uint> times;  //!< spike times sorted by neuron
+	uint outofrange;     //!< events with address >= numNeurons(), not indexed
+
+private:
+	uint isibins, isibinwidth;
+	bool done;
+};
+
 // ******* stream spiketrain ********
 ostream& operator<<(ostream& o, const SpikeTrain& st);
 
@@ -0,0 +1,179 @@
+// distributes experiments over several Spikey stations
+
+#include "common.h" // library includes
+#include "idata.h"
+#include "sncomm.h"
+#include "spikenet.h"
+#include "sc_sctrl.h"
+#include "sc_pbmem.h"
+#include "ctrlif.h"
+#include "synapse_control.h"
+#include "pram_control.h"
+#include "spikeyconfig.h"
+#include "spikey.h"
+#include "spikeyscheduler.h"
+
+#include <algorithm>
+#include <thread>
+#include <boost/filesystem.hpp>
+
+static log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("HAL.Sched");
+
+using namespace spikey2;
+
+void SpikeyScheduler::addStation(std::string workstation, float tempmax)
+{
+	boost::shared_ptr<SpikenetComm> bus(new SC_Mem(0, workstation));
+	addStation(boost::shared_ptr<Spikey>(new Spikey(bus)), workstation, tempmax);
+}
+
+void SpikeyScheduler::addStation(boost::shared_ptr<Spikey> sp, std::string name, float tempmax)
+{
+	if (!boost::dynamic_pointer_cast<SC_Mem>(sp->bus)) {
+		string msg = "SpikeyScheduler::addStation: station " + name + " does not use SC_Mem";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	Station s;
+	s.name = name;
+	s.sp = sp;
+	s.tempmax = tempmax;
+	s.numjobs = 0;
+	stations.push_back(s);
+	LOG4CXX_INFO(logger, "Added station " << name);
+}
+
+uint SpikeyScheduler::addAllStations(float tempmax)
+{
+	char* spikeyhalpath = getenv("SPIKEYHALPATH");
+	if (spikeyhalpath == NULL) {
+		std::string msg = "Could not find env variable SPIKEYHALPATH";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	boost::filesystem::path folder(std::string(spikeyhalpath) + "/config");
+	vector<std::string> names;
+	if (boost::filesystem::exists(folder)) {
+		boost::filesystem::directory_iterator end_itr;
+		for (boost::filesystem::directory_iterator itr(folder); itr != end_itr; itr++) {
+			std::string name = itr->path().stem().string();
+			if (itr->path().extension().string() == ".cfg" && name.compare(0, 7, "station") == 0)
+				names.push_back(name);
+		}
+	}
+	sort(names.begin(), names.end());
+
+	uint num = 0;
+	for (uint i = 0; i < names.size(); i++) {
+		try {
+			addStation(names[i], tempmax);
+			num++;
+		} catch (std::exception& e) {
+			LOG4CXX_DEBUG(logger, "Station " << names[i] << " not available: " << e.what());
+		}
+	}
+	return num;
+}
+
+uint SpikeyScheduler::run(vector<boost::shared_ptr<SpikeyJob> >& jobs)
+{
+	if (stations.empty()) {
+		string msg = "SpikeyScheduler::run: no stations";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+
+	for (uint i = 0; i < jobs.size(); i++) {
+		jobs[i]->done = false;
+		jobs[i]->error.clear();
+	}
+	queue.assign(jobs.begin(), jobs.end());
+	vector<std::thread> workers;
+	for (uint i = 0; i < stations.size(); i++)
+		workers.push_back(std::thread(&SpikeyScheduler::worker, this, std::ref(stations[i])));
+	for (uint i = 0; i < workers.size(); i++)
+		workers[i].join();
+
+	// all stations stayed too hot
+	for (uint i = 0; i < queue.size(); i++) {
+		queue[i]->error = "no station below its temperature limit within " + to_str(maxwait) + "ms";
+		LOG4CXX_ERROR(logger, "Job not executed: " << queue[i]->error);
+	}
+	queue.clear();
+
+	uint failed = 0;
+	for (uint i = 0; i < jobs.size(); i++)
+		if (!jobs[i]->done)
+			failed++;
+	return failed;
+}
+
+void SpikeyScheduler::worker(Station& s)
+{
+	bool hot = false;
+	double hotsince = 0;
+	while (true) {
+		// do not take jobs while too hot
+		boost::shared_ptr<SC_Mem> mem = boost::dynamic_pointer_cast<SC_Mem>(s.sp->bus);
+		float temperature = mem->getSCTRL()->getTempCached();
+		if (temperature > s.tempmax) {
+			LOG4CXX_WARN(logger, "Station " << s.name << " too hot (" << temperature
+			                                << "C), pausing");
+			if (!hot) {
+				hot = true;
+				hotsince = monotonicTime();
+			} else if (monotonicTime() - hotsince >= maxwait * 1e-3) {
+				LOG4CXX_ERROR(logger, "Station " << s.name << " too hot for " << maxwait
+				                                 << "ms, not taking further jobs");
+				return;
+			}
+			{
+				std::lock_guard<std::mutex> lock(queuemutex);
+				if (queue.empty())
+					return;
+			}
+			usleep(cooldown * 1000);
+			continue;
+		}
+		hot = false;
+
+		boost::shared_ptr<SpikeyJob> job;
+		{
+			std::lock_guard<std::mutex> lock(queuemutex);
+			if (queue.empty())
+				return;
+			job = queue.front();
+			queue.pop_front();
+		}
+
+		job->station = s.name;
+		try {
+			execute(s, *job);
+			job->done = true;
+			s.numjobs++;
+		} catch (std::exception& e) {
+			job->error = e.what();
+		} catch (std::string& e) { // thrown by SC_Mem::waitIdle
+			job->error = e;
+		}
+		if (!job->done) {
+			LOG4CXX_ERROR(logger, "Job failed on station " << s.name << ": " << job->error);
+			s.lastcfg.reset(); // configuration state unknown
+		}
+	}
+}
+
+void SpikeyScheduler::execute(Station& s, SpikeyJob& job)
+{
+	if (job.cfg && job.cfg != s.lastcfg) {
+		s.sp->config(job.cfg);
+		s.lastcfg = job.cfg;
+	}
+	s.sp->Clear();
+	s.sp->sendSpikeTrain(job.in);
+	s.sp->Flush();
+	s.sp->Run();
+	s.sp->waitPbFinished();
+	job.out.d.clear();
+	s.sp->recSpikeTrain(job.out);
+}
@@ -0,0 +1,76 @@
+// distributes experiments over several Spikey stations
+
+#include <deque>
+#include <mutex>
+
+namespace spikey2
+{
+
+//! One experiment: optional configuration and input spike train, filled with the results after
+//! execution.
+struct SpikeyJob
+{
+	boost::shared_ptr<SpikeyConfig> cfg; //!< configuration, NULL to keep the current one
+	SpikeTrain in;                       //!< spike train sent to the chip
+	SpikeTrain out;                      //!< received spike train
+	std::string station;                 //!< station that executed the job
+	bool done;                           //!< job has been executed successfully
+	std::string error;                   //!< error message if job failed
+
+	SpikeyJob() : done(false){};
+	SpikeyJob(boost::shared_ptr<SpikeyConfig> c, const SpikeTrain& st)
+	    : cfg(c), in(st), done(false){};
+};
+
+//! Owns several Spikey/SC_Mem pairs (stations) and executes a queue of jobs on them in parallel,
+//! one worker thread per station. A station does not take jobs while its temperature exceeds its
+//! limit, and none at all once it stayed too hot for the maximum wait. Per-station calibration is
+//! applied by the Spikey object of each station, e.g. by adding a SpikeyCalibratable.
+class SpikeyScheduler
+{
+public:
+	SpikeyScheduler() : cooldown(1000), maxwait(600000){};
+
+	//! add station by name, i.e. open the board configured in config/<workstation>.cfg
+	void addStation(std::string workstation, float tempmax = Spikey::tempMax);
+	//! add an already initialized station, e.g. a SpikeyCalibratable or an emulated chip
+	void addStation(boost::shared_ptr<Spikey> sp, std::string name,
+	                float tempmax = Spikey::tempMax);
+	//! add a station for each config/station*.cfg whose board can be opened, returns their number
+	uint addAllStations(float tempmax = Spikey::tempMax);
+
+	uint numStations() { return stations.size(); };
+	boost::shared_ptr<Spikey> getSpikey(uint station) { return stations.at(station).sp; };
+	//! jobs executed by station since construction
+	uint jobsDone(uint station) { return stations.at(station).numjobs; };
+
+	//! time in ms a station waits before checking its temperature again
+	void setCooldown(uint ms) { cooldown = ms; };
+	//! time in ms after which a station that stayed too hot stops taking jobs. Jobs that no
+	//! station took fail with an error.
+	void setMaxWait(uint ms) { maxwait = ms; };
+
+	//! executes all jobs, blocks until all are finished and returns the number of failed jobs
+	uint run(vector<boost::shared_ptr<SpikeyJob> >& jobs);
+
+private:
+	struct Station
+	{
+		std::string name;
+		boost::shared_ptr<Spikey> sp;
+		float tempmax;
+		boost::shared_ptr<SpikeyConfig> lastcfg; // avoid reconfiguration with same config
+		uint numjobs;
+	};
+	vector<Station> stations;
+	uint cooldown, maxwait;
+
+	// job queue of current run
+	std::mutex queuemutex;
+	std::deque<boost::shared_ptr<SpikeyJob> > queue;
+
+	void worker(Station& s);
+	void execute(Station& s, SpikeyJob& job);
+};
+
+} // end of namespace spikey2
@@ -339,6 +339,9 @@ bool SpikeyVoutCalib::autoCalibRobust(string calibFile, string filenamePlot,
 			validMax[b * mySpikey->hw_const->ar_numvouts() + n] = 2.5;
 		}
 
+	// parameters on the chip were converted with the old calibration
+	mySpikey->invalidateState();
+
 	assert(someSpikeyConfig != NULL);
 	mySpikeyConfig = someSpikeyConfig;
 
@@ -537,6 +540,7 @@ bool SpikeyVoutCalib::autoCalibRobust(string calibFile, string filenamePlot,
 			corSlope[vout] = calibFit.slope;
 			validMin[vout] = lower.offset + 0.05 * dynamicRange;
 			validMax[vout] = upper.offset - 0.05 * dynamicRange;
+			mySpikey->invalidateState();
 		}
 	}
 	if (filenamePlot != "" and filePlot.is_open()) {
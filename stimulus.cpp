@@ -0,0 +1,299 @@
+// generation of Poisson stimuli for many sources
+
+#include "common.h" // library includes
+#include "idata.h"
+#include "spikeyconfig.h"
+#include "stimulus.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+static log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("HAL.Stim");
+
+using namespace spikey2;
+
+const double StimulusGenerator::defaultTimeunit = 5e-9 / 16;
+
+void CounterRng::block(uint64_t ctr, uint32_t out[4]) const
+{
+	uint32_t c0 = ctr, c1 = ctr >> 32, c2 = stream, c3 = 0;
+	uint32_t k0 = seed, k1 = seed >> 32;
+	for (uint r = 0; r < 10; r++) {
+		uint64_t p0 = (uint64_t)0xD2511F53 * c0;
+		uint64_t p1 = (uint64_t)0xCD9E8D57 * c2;
+		c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+		c1 = (uint32_t)p1;
+		c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+		c3 = (uint32_t)p0;
+		k0 += 0x9E3779B9;
+		k1 += 0xBB67AE85;
+	}
+	out[0] = c0;
+	out[1] = c1;
+	out[2] = c2;
+	out[3] = c3;
+}
+
+double CounterRng::uniform(uint64_t i) const
+{
+	// two numbers per block
+	uint32_t w[4];
+	block(i >> 1, w);
+	uint h = (i & 1) << 1;
+	uint64_t x = (((uint64_t)w[h] << 32) | w[h + 1]) >> 11;
+	return (x + 1) * (1.0 / 9007199254740992.0); // 2^-53
+}
+
+double CounterRng::exponential(uint64_t i) const
+{
+	return -log(uniform(i));
+}
+
+void SpikeMerger::check(const IData* s, const IData* end, uint index)
+{
+	for (size_t i = 0; i < (size_t)(end - s); i++) {
+		string err;
+		if (!s[i].isEvent())
+			err = "non-event";
+		else if (s[i].neuronAdr() >= numaddr)
+			err = "invalid address " + to_string(s[i].neuronAdr());
+		else if (i && s[i].time() < s[i - 1].time())
+			err = "unsorted event";
+		if (!err.empty()) {
+			string msg = "SpikeMerger::merge: " + err + " at position " + to_string(i) +
+			             " of stream " + to_string(index);
+			LOG4CXX_ERROR(logger, msg);
+			throw std::runtime_error(msg);
+		}
+	}
+}
+
+void SpikeMerger::mergeSlice(const vector<const IData*>& begin, const vector<const IData*>& end,
+                             IData* out, uint32_t mask)
+{
+	// tournament tree: leaves k..2k-1 are the streams, each inner node holds the winner of its
+	// two children, i.e. the stream with the smallest head
+	uint k = 1;
+	while (k < begin.size())
+		k <<= 1;
+	vector<const IData*> pos(begin);
+	vector<const IData*> last(end);
+	pos.resize(k, NULL);
+	last.resize(k, NULL);
+	auto better = [&](uint a, uint b) {
+		if (pos[a] == last[a])
+			return b;
+		if (pos[b] == last[b])
+			return a;
+		uint ta = pos[a]->time() & mask, tb = pos[b]->time() & mask;
+		if (ta != tb)
+			return ta < tb ? a : b;
+		return pos[b]->neuronAdr() < pos[a]->neuronAdr() ? b : a;
+	};
+	vector<uint> tree(2 * k);
+	for (uint i = 0; i < k; i++)
+		tree[k + i] = i;
+	for (uint n = k - 1; n > 0; n--)
+		tree[n] = better(tree[2 * n], tree[2 * n + 1]);
+
+	while (true) {
+		uint w = tree[1];
+		if (pos[w] == last[w])
+			break;
+		*out = *pos[w]++;
+		out->setTime() &= mask;
+		out++;
+		for (uint n = (k + w) >> 1; n > 0; n >>= 1)
+			tree[n] = better(tree[2 * n], tree[2 * n + 1]);
+	}
+}
+
+void SpikeMerger::merge(const vector<vector<IData> >& streams, SpikeTrain& st)
+{
+	vector<const IData*> begin(streams.size()), end(streams.size());
+	for (uint i = 0; i < streams.size(); i++) {
+		begin[i] = streams[i].data();
+		end[i] = begin[i] + streams[i].size();
+	}
+	merge(begin, end, st);
+}
+
+void SpikeMerger::merge(const vector<SpikeTrain>& trains, SpikeTrain& st)
+{
+	vector<const IData*> begin(trains.size()), end(trains.size());
+	for (uint i = 0; i < trains.size(); i++) {
+		begin[i] = trains[i].d.data();
+		end[i] = begin[i] + trains[i].d.size();
+	}
+	merge(begin, end, st);
+}
+
+void SpikeMerger::merge(const vector<const IData*>& begin, const vector<const IData*>& end,
+                        SpikeTrain& st)
+{
+	if (begin.size() != end.size()) {
+		string msg = "SpikeMerger::merge: " + to_string(begin.size()) + " stream begins, but " +
+		             to_string(end.size()) + " ends";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+	uint32_t mask = reducedResolution ? ~(uint32_t)3 : ~(uint32_t)0;
+	size_t total = 0;
+	for (uint i = 0; i < begin.size(); i++) {
+		check(begin[i], end[i], i);
+		total += end[i] - begin[i];
+	}
+
+	// split the time range into slices of similar size, using a sample of the event times
+	uint nthreads = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+	nthreads = std::max<size_t>(1, std::min<size_t>(nthreads, total / 100000));
+	vector<uint32_t> split; // first time of each slice but the first
+	if (nthreads > 1) {
+		size_t stride = std::max<size_t>(1, total / (nthreads * 64));
+		// every stride-th event counted across all streams, so that short streams are sampled too
+		vector<uint32_t> sample;
+		size_t next = stride / 2, first = 0; // index of next sample, of first event of stream i
+		for (uint i = 0; i < begin.size(); i++) {
+			size_t n = end[i] - begin[i];
+			for (; next < first + n; next += stride)
+				sample.push_back(begin[i][next - first].time() & mask);
+			first += n;
+		}
+		std::sort(sample.begin(), sample.end());
+		if (sample.size() >= nthreads)
+			for (uint p = 1; p < nthreads; p++)
+				split.push_back(sample[sample.size() * p / nthreads]);
+	}
+	split.push_back(std::numeric_limits<uint32_t>::max());
+
+	// stream boundaries and output position of each slice
+	uint nslices = split.size();
+	vector<vector<const IData*> > bounds(nslices + 1);
+	bounds[0] = begin;
+	bounds[nslices] = end;
+	for (uint p = 1; p < nslices; p++)
+		bounds[p].resize(begin.size());
+	vector<size_t> offset(nslices + 1, 0);
+	for (uint i = 0; i < begin.size(); i++) {
+		for (uint p = 0; p + 1 < nslices; p++)
+			bounds[p + 1][i] = std::lower_bound(bounds[p][i], end[i], split[p],
+			                                    [mask](const IData& a, uint32_t t) {
+				                                    return (a.time() & mask) < t;
+				                                });
+	}
+	for (uint p = 0; p < nslices; p++) {
+		offset[p + 1] = offset[p];
+		for (uint i = 0; i < begin.size(); i++)
+			offset[p + 1] += bounds[p + 1][i] - bounds[p][i];
+	}
+
+	vector<IData> out(total);
+	if (nslices == 1)
+		mergeSlice(bounds[0], bounds[1], out.data(), mask);
+	else {
+		vector<std::thread> workers;
+		for (uint p = 0; p < nslices; p++)
+			workers.push_back(std::thread(&SpikeMerger::mergeSlice, std::cref(bounds[p]),
+			                              std::cref(bounds[p + 1]), out.data() + offset[p], mask));
+		for (uint p = 0; p < workers.size(); p++)
+			workers[p].join();
+	}
+	st.d.swap(out);
+	LOG4CXX_DEBUG(logger, "SpikeMerger: merged " << total << " events of " << begin.size()
+	                                             << " streams using " << nslices << " threads");
+}
+
+void StimulusGenerator::poisson(const vector<uint>& addr, const vector<double>& rate, uint start,
+                                uint duration, SpikeTrain& st, double refractory)
+{
+	if (addr.size() != rate.size()) {
+		string msg = "StimulusGenerator::poisson: number of addresses and rates differ";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+
+	double tref = refractory / timeunit;
+	vector<vector<IData> > trains(addr.size());
+	for (uint i = 0; i < addr.size(); i++) {
+		if (rate[i] < 0 || rate[i] * refractory >= 1.0) {
+			string msg = "StimulusGenerator::poisson: rate of source " + to_string(i) +
+			             " negative or not reachable with refractory time";
+			LOG4CXX_ERROR(logger, msg);
+			throw std::runtime_error(msg);
+		}
+		if (rate[i] == 0)
+			continue;
+		// mean interval in time steps minus dead time
+		double scale = 1.0 / (rate[i] * timeunit) - tref;
+		CounterRng rng(seed, addr[i]);
+		trains[i].reserve(duration / (scale + tref) + 1);
+		double t = rng.exponential(0) * scale; // stationary process, no dead time before first
+		for (uint64_t k = 1; t < duration; k++) {
+			IData e;
+			e.setEvent(addr[i], start + (uint)t);
+			trains[i].push_back(e);
+			t += tref + rng.exponential(k) * scale;
+		}
+	}
+	merge(trains, st);
+}
+
+void StimulusGenerator::inhomogeneous(const vector<uint>& addr,
+                                      const vector<vector<double> >& rate, uint start,
+                                      uint binwidth, SpikeTrain& st, double refractory)
+{
+	if (addr.size() != rate.size() || binwidth == 0) {
+		string msg = "StimulusGenerator::inhomogeneous: number of addresses and rate profiles "
+		             "differ or zero bin width";
+		LOG4CXX_ERROR(logger, msg);
+		throw std::runtime_error(msg);
+	}
+
+	double tref = refractory / timeunit;
+	vector<vector<IData> > trains(addr.size());
+	for (uint i = 0; i < addr.size(); i++) {
+		const vector<double>& r = rate[i];
+		CounterRng rng(seed, addr[i]);
+		uint64_t k = 0;
+		// integrated rate still needed for the next spike
+		double need = rng.exponential(k++);
+		double t = 0;
+		uint j = 0;
+		while (j < r.size()) {
+			if (r[j] < 0) {
+				string msg = "StimulusGenerator::inhomogeneous: negative rate of source " +
+				             to_string(i);
+				LOG4CXX_ERROR(logger, msg);
+				throw std::runtime_error(msg);
+			}
+			double lambda = r[j] * timeunit; // per time step
+			double end = (double)(j + 1) * binwidth;
+			double avail = lambda * (end - t);
+			if (lambda > 0 && need <= avail) {
+				t += need / lambda;
+				IData e;
+				e.setEvent(addr[i], start + (uint)t);
+				trains[i].push_back(e);
+				need = rng.exponential(k++);
+				if (tref > 0) {
+					t += tref;
+					j = t / binwidth;
+				}
+			} else {
+				need -= avail;
+				t = end;
+				j++;
+			}
+		}
+	}
+	merge(trains, st);
+}
+
+void StimulusGenerator::merge(vector<vector<IData> >& trains, SpikeTrain& st)
+{
+	// no address check, the generator may be used for any address range
+	trains.push_back(vector<IData>());
+	trains.back().swap(st.d);
+	SpikeMerger(std::numeric_limits<uint>::max()).merge(trains, st);
+}
@@ -0,0 +1,96 @@
+// generation of Poisson stimuli for many sources
+
+namespace spikey2
+{
+
+//! Counter-based random numbers (Philox4x32-10). The value with index i of a stream is computed
+//! directly from (seed, stream, i), so streams can be generated independently, in any order and
+//! in parallel, and still give the same numbers.
+class CounterRng
+{
+public:
+	CounterRng(uint64_t seed = 0, uint32_t stream = 0) : seed(seed), stream(stream){};
+
+	//! four random 32 bit words of block ctr
+	void block(uint64_t ctr, uint32_t out[4]) const;
+	//! uniform number in (0,1] with index i, 53 bit resolution
+	double uniform(uint64_t i) const;
+	//! exponentially distributed number with mean 1 and index i
+	double exponential(uint64_t i) const;
+
+private:
+	uint64_t seed;
+	uint32_t stream;
+};
+
+//! Merges many time-sorted event streams, e.g. one per source address, into one time-sorted
+//! spike train as required by SC_SlowCtrl::pbEvt. Each thread merges one time slice of all streams
+//! with a tournament tree; events with equal time are ordered by address and then by stream.
+class SpikeMerger
+{
+public:
+	//! numaddr: addresses have to be smaller, reducedResolution: use only the time bins 0, 4, 8
+	//! and 12 like PySpikeTrain::set, threads: 0 for one per core
+	SpikeMerger(uint numaddr = 512, bool reducedResolution = false, uint threads = 0)
+	    : numaddr(numaddr), reducedResolution(reducedResolution), threads(threads){};
+
+	//! replaces the events of st by the merged streams. Throws if a stream contains non-events,
+	//! invalid addresses or is not sorted.
+	void merge(const vector<vector<IData> >& streams, SpikeTrain& st);
+	//! merges the events of several spike trains, st may be one of them
+	void merge(const vector<SpikeTrain>& trains, SpikeTrain& st);
+	//! merges the streams [begin[i], end[i]) without copying them first, st may own one of them
+	void merge(const vector<const IData*>& begin, const vector<const IData*>& end, SpikeTrain& st);
+
+private:
+	uint numaddr;
+	bool reducedResolution;
+	uint threads;
+
+	void check(const IData* s, const IData* end, uint index);
+	// merges streams[i][begin[i], end[i]) into out
+	static void mergeSlice(const vector<const IData*>& begin, const vector<const IData*>& end,
+	                       IData* out, uint32_t mask);
+};
+
+//! Generates Poisson spike trains for many sources directly as time-sorted events that can be
+//! passed to Spikey::sendSpikeTrain (and thus SC_SlowCtrl::pbEvt) without further sorting.
+//! Times are given in units of IData::time(), rates in Hz. Each source uses the random stream of
+//! its address, i.e. its train does not depend on the other sources generated with it.
+class StimulusGenerator
+{
+public:
+	//! default time unit: one time bin of the 200MHz chip clock
+	static const double defaultTimeunit;
+
+	StimulusGenerator(uint64_t seed = 0, double timeunit = defaultTimeunit)
+	    : seed(seed), timeunit(timeunit){};
+
+	void setSeed(uint64_t s) { seed = s; };
+	uint64_t getSeed() { return seed; };
+	//! length of one IData time step in seconds
+	void setTimeunit(double t) { timeunit = t; };
+	double getTimeunit() { return timeunit; };
+
+	//! homogeneous Poisson process with rate[i] for source address addr[i] in
+	//! [start, start + duration). With a refractory time (in seconds) each interval is the dead
+	//! time plus an exponential interval, chosen such that the mean rate stays rate[i].
+	//! The events are merged into st, which has to be sorted by time.
+	void poisson(const vector<uint>& addr, const vector<double>& rate, uint start, uint duration,
+	             SpikeTrain& st, double refractory = 0.0);
+
+	//! inhomogeneous Poisson process with piecewise constant rates: source addr[i] has rate
+	//! rate[i][j] during [start + j * binwidth, start + (j + 1) * binwidth). Generated by time
+	//! rescaling, i.e. without rejected samples. A refractory time suppresses spikes during the
+	//! dead time after each spike and thus lowers the rate.
+	void inhomogeneous(const vector<uint>& addr, const vector<vector<double> >& rate,
+	                   uint start, uint binwidth, SpikeTrain& st, double refractory = 0.0);
+
+private:
+	uint64_t seed;
+	double timeunit;
+
+	void merge(vector<vector<IData> >& trains, SpikeTrain& st);
+};
+
+} // end of namespace spikey2
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+
+#include "common.h"
+
+#include "idata.h"
+#include "sncomm.h"
+#include "sc_sctrl.h"
+#include "sc_emulator.h"
+#include "sc_chipmodel.h"
+#include "sc_pbmem.h"
+
+#include "ctrlif.h"
+#include "spikenet.h"
+
+#include "pram_control.h"
+#include "synapse_control.h"
+#include "spikeyconfig.h"
+#include "spikey.h"
+
+static log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("Tst.Mod");
+
+namespace spikey2
+{
+// runs a small network on the chip model: rows 0..4 drive neurons 0..4 at 10MHz (in hardware time),
+// rows 5..9 neurons 5..9 with a single input, inhibitory row 10 silences neuron 4
+static void runChipModel(uint threads, SpikeTrain& out, uint64_t& steps)
+{
+	ChipModelParams par;
+	par.threads = threads;
+	boost::shared_ptr<SC_ChipModel> model(new SC_ChipModel(0, 5, par));
+	boost::shared_ptr<SC_Mem> mem(new SC_Mem(model));
+	boost::shared_ptr<SpikenetComm> bus(mem);
+	boost::shared_ptr<Spikey> sp(new Spikey(bus));
+
+	boost::shared_ptr<SpikeyConfig> cfg(new SpikeyConfig(bus->hw_const, SpikeyConfig::ud_param));
+	cfg->setValid(SpikeyConfig::ud_weight | SpikeyConfig::ud_config | SpikeyConfig::ud_dac, true);
+	cfg->irefdac = 25;
+	uint nv = bus->hw_const->ar_numvouts();
+	for (uint b = 0; b < 2; b++)
+		for (uint o = 0; o < 2; o++) {
+			cfg->vout[b * nv + 0 + o] = 0.4;  // Ei
+			cfg->vout[b * nv + 2 + o] = 0.7;  // El
+			cfg->vout[b * nv + 4 + o] = 0.6;  // Er
+			cfg->vout[b * nv + 6 + o] = 1.5;  // Ex
+			cfg->vout[b * nv + 16 + o] = 0.8; // Vt
+		}
+	for (uint n = 0; n < cfg->neuron.size(); n++) {
+		cfg->neuron[n].ileak = 0.2;
+		cfg->neuron[n].icb = 0.2;
+		cfg->neuron[n].config = bus->hw_const->sc_ncd_evout();
+	}
+	for (uint r = 0; r < 11; r++) {
+		cfg->synapse[r].config =
+		    r < 10 ? bus->hw_const->sc_sdd_senx() : bus->hw_const->sc_sdd_seni();
+		cfg->synapse[r].drviout = r < 10 ? 1.0 : 2.0;
+		cfg->getWeight(0, r, r < 10 ? r : 4) = 15;
+	}
+	sp->config(cfg);
+
+	SpikeTrain st;
+	for (uint i = 0; i < 20; i++)
+		for (uint r = 0; r < 11; r++)
+			if (r < 5 || r == 10 || i == 0)
+				st.d.push_back(IData::Event(r, (0x200 << 5) + i * 320 + r));
+	mem->Clear();
+	sp->sendSpikeTrain(st);
+	sp->Flush();
+	sp->Run();
+	sp->waitPbFinished();
+	sp->recSpikeTrain(out);
+
+	EXPECT_EQ(15u, model->getWeight(0, 0));
+	EXPECT_EQ(0u, model->getWeight(1, 0));
+	steps = model->numSteps();
+}
+
+TEST(SCChipModel, network)
+{
+	SpikeTrain out;
+	uint64_t steps;
+	runChipModel(1, out, steps);
+	vector<uint> count(384, 0);
+	for (uint i = 0; i < out.d.size(); i++)
+		count[out.d[i].neuronAdr()]++;
+	for (uint n = 0; n < 4; n++)
+		EXPECT_LT(0u, count[n]) << "neuron " << n;
+	for (uint n = 4; n < count.size(); n++)
+		EXPECT_EQ(0u, count[n]) << "neuron " << n;
+	EXPECT_LT(0u, steps);
+
+	// neurons are integrated independently, the result does not depend on the threads
+	SpikeTrain outmt;
+	uint64_t stepsmt;
+	runChipModel(4, outmt, stepsmt);
+	ASSERT_EQ(out.d.size(), outmt.d.size());
+	for (uint i = 0; i < out.d.size(); i++) {
+		EXPECT_EQ(out.d[i].time(), outmt.d[i].time());
+		EXPECT_EQ(out.d[i].neuronAdr(), outmt.d[i].neuronAdr());
+	}
+	EXPECT_EQ(steps, stepsmt);
+}
+
+} // namespace spikey2
@@ -0,0 +1,166 @@
+#include "emulatorFixture.h"
+
+static log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("Tst.Cst");
+
+namespace spikey2
+{
+TEST_F(SCEmulator, warmAttach)
+{
+	std::string statefile = "/tmp/spikeyhal_test_state_" + to_str(getpid());
+	remove(statefile.c_str());
+
+	boost::shared_ptr<SpikeyConfig> cfg(new SpikeyConfig(bus->hw_const, SpikeyConfig::ud_param));
+	cfg->setValid(SpikeyConfig::ud_weight | SpikeyConfig::ud_colconfig, true);
+	for (uint i = 0; i < cfg->weight.size(); i += 7)
+		cfg->weight[i] = i % 16;
+
+	// no state file: initialize and configure, the emulator counts the words of the last program
+	sp.reset(new Spikey(bus, statefile));
+	EXPECT_FALSE(sp->warmAttached());
+	sp->config(cfg);
+	uint64_t cfgwords = emu->executedWords();
+
+	// chip unchanged: attach with a short program and skip the identical configuration
+	sp.reset(new Spikey(bus, statefile));
+	EXPECT_TRUE(sp->warmAttached());
+	uint64_t attachwords = emu->executedWords();
+	EXPECT_GT(cfgwords / 10, attachwords);
+	sp->config(cfg);
+	EXPECT_EQ(attachwords, emu->executedWords());
+
+	// a different configuration is written and recorded
+	cfg->weight[0] = 15;
+	sp->config(cfg);
+	EXPECT_LT(attachwords, emu->executedWords());
+	sp.reset(new Spikey(bus, statefile));
+	EXPECT_TRUE(sp->warmAttached());
+	sp->config(cfg);
+	EXPECT_EQ(attachwords, emu->executedWords());
+
+	// chip control register changed behind the saved state, e.g. by a reset
+	sp->setCCBit(bus->hw_const->cr_anaclken(), false);
+	sp->writeCC();
+	execute();
+	sp.reset(new Spikey(bus, statefile));
+	EXPECT_FALSE(sp->warmAttached());
+
+	// configuration unknown after invalidation
+	sp->config(cfg);
+	sp->invalidateState();
+	sp.reset(new Spikey(bus, statefile));
+	EXPECT_TRUE(sp->warmAttached());
+	sp->config(cfg);
+	EXPECT_LT(attachwords, emu->executedWords());
+
+	remove(statefile.c_str());
+}
+
+TEST_F(SCEmulator, configSections)
+{
+	boost::shared_ptr<SpikeyConfig> cfg(new SpikeyConfig(bus->hw_const, SpikeyConfig::ud_param));
+	cfg->setValid(SpikeyConfig::ud_weight | SpikeyConfig::ud_config, true);
+	for (uint i = 0; i < cfg->weight.size(); i += 5)
+		cfg->weight[i] = i % 16;
+
+	// copies share the arrays until modified, reading via const references does not copy
+	boost::shared_ptr<SpikeyConfig> copy(new SpikeyConfig(*cfg));
+	const SpikeyConfig& constcfg = *cfg;
+	const SpikeyConfig& constcopy = *copy;
+	EXPECT_TRUE(cfg->weight.shared());
+	EXPECT_EQ(cfg->generation(SpikeyConfig::ud_weight), copy->generation(SpikeyConfig::ud_weight));
+	EXPECT_EQ(constcfg.weight[5], constcopy.weight[5]);
+	EXPECT_TRUE(cfg->weight.shared());
+	copy->weight[5] = 15;
+	EXPECT_FALSE(cfg->weight.shared());
+	EXPECT_NE(cfg->generation(SpikeyConfig::ud_weight), copy->generation(SpikeyConfig::ud_weight));
+	EXPECT_EQ(cfg->generation(SpikeyConfig::ud_rowconfig),
+	          copy->generation(SpikeyConfig::ud_rowconfig));
+	EXPECT_EQ(5, constcfg.weight[5]);
+
+	// playback memory words written by config, sections already on the chip are skipped
+	auto words = [&](boost::shared_ptr<SpikeyConfig> c) {
+		mem->Clear();
+		sp->config(c);
+		return mem->getStats().pbwords;
+	};
+	uint64_t full = words(cfg);
+	EXPECT_GT(full / 10, words(cfg));
+
+	// only the weights differ
+	uint64_t weights = words(copy);
+	EXPECT_LT(full / 10, weights);
+	EXPECT_GT(full, weights);
+
+	// repeated writes to an already modified array keep a new generation
+	copy->weight[6] = 1;
+	copy->weight[7] = 1;
+	EXPECT_EQ(weights, words(copy));
+
+	cfg->vout[0] = 1.0;
+	EXPECT_LT(weights, words(cfg));
+
+	sp->invalidateState();
+	EXPECT_LE(full - 10, words(cfg));
+
+	// the same with a state file recording the configuration
+	std::string statefile = "/tmp/spikeyhal_test_sections_" + to_str(getpid());
+	remove(statefile.c_str());
+	sp.reset(new Spikey(bus, statefile));
+	full = words(cfg);
+	EXPECT_EQ(0u, words(cfg));
+	cfg->vout[0] = 0.5;
+	EXPECT_GT(full / 4, words(cfg));
+	remove(statefile.c_str());
+}
+
+TEST_F(SCEmulator, quiesce)
+{
+	boost::shared_ptr<SpikeyConfig> cfg(new SpikeyConfig(bus->hw_const, SpikeyConfig::ud_weight));
+	cfg->setValid(SpikeyConfig::ud_config, true);
+	for (uint i = 0; i < 2 * SpikeyConfig::num_presyns; i++)
+		cfg->synapse[i].config = (i % 2) ? 0x8 : 0x5;
+	mem->Clear();
+	sp->config(cfg);
+	uint64_t cfgwords = mem->getStats().pbwords;
+
+	// preamble and experiment in one program
+	SpikeTrain st_tx = regularTrain(100, 100), st_rx;
+	mem->Clear();
+	sp->quiesce();
+	run(st_tx, st_rx);
+	EXPECT_EQ(st_tx.d.size(), st_rx.d.size());
+
+	// much shorter than uploading zero weights and the original weights again
+	uint64_t statusreg = sp->statusregToUint64();
+	mem->Clear();
+	sp->quiesce();
+	EXPECT_EQ(statusreg, sp->statusregToUint64());
+	execute();
+	EXPECT_GT(cfgwords / 10, mem->getStats().pbwords);
+
+	// row configuration restored
+	boost::shared_ptr<SynapseControl> sc = sp->getSC();
+	auto checkRows = [&]() {
+		for (uint r = 0; r < SpikeyConfig::num_presyns; r += 51) {
+			sc->read_sram(r, 1 << bus->hw_const->sc_rowconfigbit());
+			execute();
+			uint data = ((r % 2) ? 0x8 : 0x5) * ((1 << bus->hw_const->sc_blockshift()) + 1);
+			EXPECT_TRUE(sc->check_sram(data)) << "row " << r;
+		}
+	};
+	checkRows();
+
+	// row configuration no longer known: only muted with the configuration given
+	sp->invalidateState();
+	auto words = [&](boost::shared_ptr<const SpikeyConfig> c) {
+		mem->Clear();
+		sp->quiesce(10000, c);
+		execute();
+		return mem->getStats().pbwords;
+	};
+	uint64_t unmuted = words(boost::shared_ptr<const SpikeyConfig>());
+	EXPECT_LT(unmuted + 2 * SpikeyConfig::num_presyns, words(cfg));
+	checkRows();
+}
+
+} // namespace spikey2
@@ -0,0 +1,126 @@
+#include "emulatorFixture.h"
+
+static log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("Tst.Cir");
+
+namespace spikey2
+{
+TEST_F(SCEmulator, ciReplies)
+{
+	boost::shared_ptr<Loopback> lb = sp->getLB();
+	boost::shared_ptr<ChipControl> cc = sp->getCC();
+	boost::shared_ptr<SynapseControl> sc = sp->getSC();
+	uint64_t mask = mmm(52);
+
+	// no read issued
+	sp->Clear();
+	cc->setCtrl(0x7d, 20);
+	EXPECT_THROW(cc->reply(), std::runtime_error);
+
+	// reads of several interfaces, mixed with reads received in order
+	vector<CIFuture> lbreply;
+	for (uint i = 0; i < 5; i++) {
+		lb->loopback(0x1000 + i, 0);
+		lbreply.push_back(lb->reply());
+	}
+	sc->write_sram(10, 1 << bus->hw_const->sc_rowconfigbit(), 0x5, 0);
+	sc->read_sram(10, 1 << bus->hw_const->sc_rowconfigbit());
+	CIFuture row = sc->reply();
+	lb->loopback(0x2000, 0); // received via check_test
+	cc->getCtrl();
+	CIFuture ctrl = cc->reply();
+	lb->loopback(0x3000, 0);
+	execute();
+
+	EXPECT_FALSE(ctrl->ready());
+	EXPECT_EQ(0x7dULL, (ctrl->get() >> bus->hw_const->cr_pos()) & mmw(bus->hw_const->cr_width()));
+	EXPECT_TRUE(ctrl->ready());
+	EXPECT_TRUE(lbreply[4]->ready()); // decoded on the way
+	EXPECT_TRUE(lb->check_test(0x2000));
+	EXPECT_TRUE(lb->check_test(0x3000));
+	for (int i = 4; i >= 0; i--)
+		EXPECT_EQ((~(0x1000ULL + i)) & mask, lbreply[i]->get() & mask);
+	uint shift = bus->hw_const->sc_aw() + bus->hw_const->sc_commandwidth();
+	EXPECT_EQ(0x5ULL, (row->get() >> shift) & 0xf);
+
+	// replies of a cleared program are lost
+	lb->loopback(0x4000, 0);
+	CIFuture lost = lb->reply();
+	sp->Clear();
+	EXPECT_THROW(lost->get(), std::runtime_error);
+}
+
+// events decoded while waiting for a reply belong to the chip of the interface
+TEST_F(SCEmulator, ciRepliesChip)
+{
+	sp.reset(new Spikey(bus, 10.0, 1));
+
+	SpikeTrain st_tx = regularTrain(100, 100);
+	sp->Clear();
+	sp->sendSpikeTrain(st_tx);
+	sp->getCC()->getCtrl();
+	CIFuture ctrl = sp->getCC()->reply();
+	execute();
+	ctrl->get();
+	EXPECT_TRUE(mem->rcvd(0)->empty());
+	EXPECT_EQ(st_tx.d.size(), mem->rcvd(1)->size());
+}
+
+TEST_F(SCEmulator, ciTiming)
+{
+	boost::shared_ptr<HardwareConstants> hw = bus->hw_const;
+
+	// analog settling needs more cycles at a faster clock
+	CITiming m10 = CITiming::model(*hw, 10.0), m5 = CITiming::model(*hw, 5.0);
+	EXPECT_EQ(10u, m10.synram);
+	EXPECT_LT(m10.synram, m5.synram);
+	EXPECT_EQ(m10.synramnext, m5.synramnext);
+	EXPECT_EQ(m10.synram, sp->getTiming().synram);
+	EXPECT_EQ(m10.chain, sp->getTiming().chain);
+	// the parameter ram is written with the same delay as before the timing model
+	EXPECT_EQ(6u, m10.pram);
+	EXPECT_EQ(m10.pram, m5.pram);
+
+	// the chip model needs more than the model delay for row accesses
+	emu->setBusyCycles(hw->ci_synrami(), hw->sc_cmd_syn(), 7);
+	emu->setBusyCycles(hw->ci_paramrami(), hw->pr_cmd_ram(), 4);
+	boost::shared_ptr<SynapseControl> sc = sp->getSC();
+	auto writeRow = [&](const CITiming& t) {
+		sp->Clear();
+		sc->write_sram(5, 0, 0x123, t.synram);
+		sc->write_sram(5, 1, 0x456, t.synramnext);
+		sc->close();
+		sc->read_sram(5, 0, t.synread);
+		sc->close();
+		sc->read_sram(5, 1, t.synread);
+		sc->close();
+		execute();
+		try {
+			return sc->check_sram(0x123) && sc->check_sram(0x456);
+		} catch (std::runtime_error& e) {
+			return false;
+		}
+	};
+	EXPECT_FALSE(writeRow(sp->getTiming()));
+
+	std::string file = "/tmp/spikeyhal_test_" + to_str(getpid()) + ".timing";
+	CITiming t = sp->calibrateTiming(file, 1, 4);
+	// command and bus base delay are added to each delay
+	uint base = SpikenetComm::basedelay + ControlInterface::cidelay;
+	EXPECT_EQ(7 - base + 1, t.synram);
+	EXPECT_EQ(7 - base + 1, t.synramnext);
+	EXPECT_EQ(7 - base + 1, t.synread);
+	EXPECT_EQ(4 - base + 1, t.pram);
+	EXPECT_EQ(m10.ar, t.ar);
+	EXPECT_EQ(t.synramnext, sp->getTiming().synramnext);
+	EXPECT_TRUE(writeRow(sp->getTiming()));
+
+	CITiming r;
+	ASSERT_TRUE(r.read(file));
+	EXPECT_EQ(t.revision, r.revision);
+	EXPECT_EQ(t.clockper, r.clockper);
+	EXPECT_EQ(t.synramnext, r.synramnext);
+	EXPECT_EQ(t.pram, r.pram);
+	unlink(file.c_str());
+}
+
+} // namespace spikey2
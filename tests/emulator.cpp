@@ -0,0 +1,162 @@
+#include "emulatorFixture.h"
+
+static log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("Tst.Emu");
+
+namespace spikey2
+{
+TEST_F(SCEmulator, eventLoopback)
+{
+	SpikeTrain st_tx, st_rx;
+	srand(42);
+	uint time_event = 0x200 << 5;
+	for (uint i = 0; i < 2000; i++) {
+		// include gaps that need time stamps in the record memory
+		time_event += (i % 100 == 99) ? (0x1000 << 4) : rand() % 50;
+		uint neuron_index = rand() % 192 + (rand() % 2 * 256);
+		st_tx.d.push_back(IData::Event(neuron_index, time_event));
+	}
+
+	run(st_tx, st_rx);
+
+	// all events sent to the chip are returned with the loopback latency, the order of
+	// simultaneous events on different input buffers is not defined
+	const vector<IData>* ev = emu->ev(0);
+	EXPECT_EQ(st_tx.d.size(), ev->size());
+	ASSERT_EQ(ev->size(), st_rx.d.size());
+	EXPECT_EQ(ev->size(), emu->inputEvents());
+	EXPECT_TRUE(sorted(*ev) == sorted(st_rx.d));
+}
+
+TEST_F(SCEmulator, ciLoopback)
+{
+	boost::shared_ptr<Loopback> lb = sp->getLB();
+	boost::shared_ptr<ChipControl> cc = sp->getCC();
+	uint64_t data = 0x123456789abcULL;
+	lb->loopback(data, 0);
+	cc->setCtrl(0x7d, 20);
+	cc->getCtrl();
+	sp->Flush();
+	sp->Run();
+	EXPECT_TRUE(lb->check_test(data));
+	EXPECT_TRUE(cc->checkCtrl(0x7d));
+}
+
+TEST_F(SCEmulator, expStats)
+{
+	SpikeTrain st_tx = regularTrain(300, 100), st_rx;
+
+	mem->Clear();
+	EXPECT_TRUE(mem->getStats().empty());
+	run(st_tx, st_rx);
+
+	const ExpStats& stats = mem->getStats();
+	EXPECT_EQ(st_tx.d.size(), stats.evencoded);
+	EXPECT_EQ(0u, stats.evdropped);
+	EXPECT_EQ(st_rx.d.size(), stats.evdecoded);
+	EXPECT_EQ(emu->executedWords(), stats.pbwords);
+	EXPECT_EQ(emu->recordWords(), stats.recwords);
+	EXPECT_EQ((stats.pbwords + stats.recwords) * sizeof(uint64_t), stats.usbbytes);
+	EXPECT_LT(0u, stats.polls);
+	EXPECT_NE(string::npos, stats.toJson().find("\"events_decoded\": 300"));
+
+	mem->Clear();
+	EXPECT_TRUE(mem->getStats().empty());
+}
+
+TEST_F(SCEmulator, predictIdle)
+{
+	emu->setRealtime(true);
+
+	// about 20ms of playback
+	SpikeTrain st_tx = regularTrain(1000, 128000), st_rx;
+
+	for (uint notify = 0; notify < 2; notify++) {
+		emu->setIdleNotify(notify);
+		mem->Clear();
+		run(st_tx, st_rx);
+
+		const ExpStats& stats = mem->getStats();
+		double duration = emu->executedCycles() * 5e-9;
+		EXPECT_EQ(st_tx.d.size(), st_rx.d.size());
+		EXPECT_LT(0.015, duration);
+		EXPECT_LT(0.9 * duration, stats.seconds[ExpStats::wait]);
+		// slept until shortly before the end instead of polling all the time
+		EXPECT_LT(0u, stats.wakeups);
+		EXPECT_GE(2u, stats.wakeups); // sleep and notification, not the polls
+		EXPECT_GT(50u, stats.polls);
+		EXPECT_GT(0.5 * duration, fabs(stats.prederr));
+	}
+}
+
+TEST_F(SCEmulator, telemetry)
+{
+	emu->setTemp(30.0);
+	emu->setSupplyVoltage(4.8);
+	emu->startTelemetry(2, vector<uint>(1, 3), 5);
+	ASSERT_TRUE(emu->telemetryRunning());
+	usleep(50000);
+
+	vector<TelemetrySample> h = emu->telemetryHistory();
+	ASSERT_EQ(5u, h.size()); // limited history
+	for (uint i = 0; i < h.size(); i++) {
+		EXPECT_FLOAT_EQ(30.0, h[i].temperature);
+		EXPECT_FLOAT_EQ(4.8, h[i].supply);
+		ASSERT_EQ(1u, h[i].adc.size());
+		if (i) {
+			EXPECT_LT(h[i - 1].time, h[i].time);
+		}
+	}
+
+	// the cached value follows the sensor with the next sample
+	emu->setTemp(40.0);
+	usleep(20000);
+	EXPECT_FLOAT_EQ(40.0, emu->getTempCached());
+
+	// experiments can run while sampling
+	SpikeTrain st_tx = regularTrain(100, 100), st_rx;
+	run(st_tx, st_rx);
+	EXPECT_EQ(st_tx.d.size(), st_rx.d.size());
+
+	emu->stopTelemetry();
+	EXPECT_FALSE(emu->telemetryRunning());
+	// read from the sensor again
+	emu->setTemp(50.0);
+	EXPECT_FLOAT_EQ(50.0, emu->getTempCached());
+}
+
+// register accesses of a transaction are issued in order, reads are available after the commit
+TEST_F(SCEmulator, transaction)
+{
+	boost::shared_ptr<HardwareConstants> hw = emu->hw_const;
+
+	SC_Transaction t = emu->transaction();
+	EXPECT_TRUE(t.accesses().empty());
+	t.setRadr(0x1234);
+	uint hradr = t.getCurRadr();
+	t.setNumRead(~0u);
+	uint hnumread = t.getNumRead();
+	t.setNumRead(0x56);
+	uint hlast = t.read(SC_Transaction::pbc, hw->sg_sc_numread(), 0xf);
+	ASSERT_EQ(6u, t.accesses().size());
+	EXPECT_FALSE(t.committed());
+	EXPECT_THROW(t.result(hradr), std::runtime_error);
+
+	emu->commit(t);
+	ASSERT_TRUE(t.committed());
+	EXPECT_EQ(0x1234u, t.result(hradr));
+	EXPECT_EQ(mmw(hw->sg_sc_numreadw()), t.result(hnumread)); // masked like getNumRead
+	EXPECT_EQ(0x6u, t.result(hlast));
+	EXPECT_THROW(t.result(0), std::runtime_error); // a write
+	uint nr = 0;
+	emu->getNumRead(nr);
+	EXPECT_EQ(0x56u, nr);
+
+	// playback through a transaction as in SC_Mem::Flush and Run
+	uint64_t data = 0x5a5a5a5a5aULL;
+	sp->getLB()->loopback(data, 0);
+	sp->Flush();
+	sp->Run();
+	EXPECT_TRUE(sp->getLB()->check_test(data));
+}
+
+} // namespace spikey2
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#include "common.h"
+
+#include "idata.h"
+#include "sncomm.h"
+#include "sc_sctrl.h"
+#include "sc_emulator.h"
+#include "sc_pbmem.h"
+
+#include "ctrlif.h"
+#include "spikenet.h"
+
+#include "pram_control.h"
+#include "synapse_control.h"
+#include "spikeyconfig.h"
+#include "spikey.h"
+
+#include <algorithm>
+
+namespace spikey2
+{
+// software only, runs without hardware: a Spikey on the playback memory interface of an emulator
+class SCEmulator : public ::testing::Test
+{
+protected:
+	boost::shared_ptr<SC_Emulator> emu;
+	boost::shared_ptr<SC_Mem> mem;
+	boost::shared_ptr<SpikenetComm> bus;
+	boost::shared_ptr<Spikey> sp;
+
+	virtual void SetUp() { attach(boost::shared_ptr<SC_Emulator>(new SC_Emulator())); }
+
+	// replaces the emulator, e.g. by a derived one
+	void attach(boost::shared_ptr<SC_Emulator> e)
+	{
+		sp.reset();
+		emu = e;
+		mem.reset(new SC_Mem(emu));
+		bus = mem;
+		sp.reset(new Spikey(bus));
+	}
+
+	// n events on the neurons i % 192, dt clocks apart
+	static SpikeTrain regularTrain(uint n, uint dt)
+	{
+		SpikeTrain st;
+		for (uint i = 0; i < n; i++)
+			st.d.push_back(IData::Event(i % 192, (0x200 << 5) + i * dt));
+		return st;
+	}
+
+	// executes the pending playback memory program
+	void execute()
+	{
+		sp->Flush();
+		sp->Run();
+		sp->waitPbFinished();
+	}
+
+	// sends st in one playback memory program and receives the events
+	void run(const SpikeTrain& st, SpikeTrain& out)
+	{
+		sp->sendSpikeTrain(st);
+		execute();
+		sp->recSpikeTrain(out);
+	}
+
+	// time and address of the events, sorted: the order of simultaneous events on different input
+	// buffers is not defined
+	static vector<pair<uint, uint> > sorted(const vector<IData>& ev)
+	{
+		vector<pair<uint, uint> > s;
+		for (uint i = 0; i < ev.size(); i++)
+			s.push_back(make_pair(ev[i].time(), ev[i].neuronAdr()));
+		sort(s.begin(), s.end());
+		return s;
+	}
+};
+} // namespace spikey2
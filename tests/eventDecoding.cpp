@@ -0,0 +1,188 @@
+#include "emulatorFixture.h"
+
+static log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("Tst.Dec");
+
+namespace spikey2
+{
+TEST_F(SCEmulator, spikeIndex)
+{
+	boost::shared_ptr<SpikeIndex> idx(new SpikeIndex(384, 20, 64));
+	sp->setSpikeIndex(idx);
+
+	SpikeTrain st_tx, st_rx;
+	srand(randomseed);
+	uint time_event = 0x200 << 5;
+	for (uint i = 0; i < 2000; i++) {
+		time_event += rand() % 50;
+		st_tx.d.push_back(IData::Event(rand() % 192 + (rand() % 2 * 256), time_event));
+	}
+	run(st_tx, st_rx);
+	ASSERT_EQ(2000u, st_rx.d.size());
+
+	// compare with walking the received spike train
+	vector<vector<uint> > times(384);
+	uint outofrange = 0;
+	for (uint i = 0; i < st_rx.d.size(); i++) {
+		if (st_rx.d[i].neuronAdr() < 384)
+			times[st_rx.d[i].neuronAdr()].push_back(st_rx.d[i].time());
+		else
+			outofrange++;
+	}
+	EXPECT_EQ(outofrange, idx->outofrange);
+	for (uint n = 0; n < 384; n++) {
+		ASSERT_EQ(times[n].size(), idx->count[n]);
+		ASSERT_EQ(times[n].size(), idx->offset[n + 1] - idx->offset[n]);
+		for (uint i = 0; i < times[n].size(); i++)
+			EXPECT_EQ(times[n][i], idx->times[idx->offset[n] + i]);
+		if (times[n].size()) {
+			EXPECT_EQ(times[n].front(), idx->first[n]);
+			EXPECT_EQ(times[n].back(), idx->last[n]);
+		}
+	}
+	uint isis = 0;
+	for (uint i = 0; i < idx->isi.size(); i++)
+		isis += idx->isi[i];
+	uint expected = 0;
+	for (uint n = 0; n < 384; n++)
+		expected += times[n].size() ? times[n].size() - 1 : 0;
+	EXPECT_EQ(expected, isis);
+
+	// an index set after decoding is built from the spike train
+	SpikeIndex late;
+	late.finish(st_rx.d);
+	EXPECT_TRUE(late.times == idx->times);
+	EXPECT_TRUE(late.count == idx->count);
+
+	// the index is reused by the next experiment, which starts over at the same times
+	SpikeTrain st_short, st_rx2;
+	st_short.d.assign(st_tx.d.begin(), st_tx.d.begin() + 500);
+	mem->Clear();
+	run(st_short, st_rx2);
+	ASSERT_EQ(500u, st_rx2.d.size());
+	SpikeIndex fresh(384, 20, 64);
+	fresh.finish(st_rx2.d);
+	EXPECT_TRUE(fresh.isi == idx->isi);
+	EXPECT_TRUE(fresh.count == idx->count);
+	for (uint n = 0; n < 384; n++) {
+		if (fresh.count[n]) {
+			EXPECT_EQ(fresh.first[n], idx->first[n]) << "neuron " << n;
+			EXPECT_EQ(fresh.last[n], idx->last[n]) << "neuron " << n;
+		}
+	}
+}
+
+TEST_F(SCEmulator, reorderWindow)
+{
+	mem->setReorderWindow(16);
+
+	// dense input on all buffers, the record memory order of simultaneous events is not defined
+	SpikeTrain st_tx, st_rx;
+	srand(randomseed);
+	uint time_event = 0x200 << 5;
+	for (uint i = 0; i < 3000; i++) {
+		time_event += (i % 500 == 499) ? (0x1000 << 4) : rand() % 20;
+		st_tx.d.push_back(IData::Event(rand() % 192 + (rand() % 2 * 256), time_event));
+	}
+	run(st_tx, st_rx);
+
+	const vector<IData>* ev = emu->ev(0);
+	ASSERT_EQ(ev->size(), st_rx.d.size());
+	for (uint i = 1; i < st_rx.d.size(); i++)
+		ASSERT_LE(st_rx.d[i - 1].time(), st_rx.d[i].time());
+	EXPECT_TRUE(sorted(*ev) == sorted(st_rx.d));
+	EXPECT_EQ(mem->ambiguous(0)->size(), mem->getStats().evambiguous);
+	EXPECT_NE(string::npos, mem->getStats().toJson().find("\"events_late\": "));
+}
+
+// reorders the events in the record memory like the priority encoders of the chip: swaps events
+// across wrap arounds of the event time and moves single events back by two positions
+class ReorderEmulator : public SC_Emulator
+{
+public:
+	uint wraps, moved;
+
+	ReorderEmulator() : wraps(0), moved(0){};
+
+	// only the record memory is read in the tests
+	virtual void readMem(uint adr, uint num, vector<uint64_t>& buf)
+	{
+		uint first = buf.size();
+		SC_Emulator::readMem(adr, num, buf);
+		vector<pair<uint, uint> > pos; // word and slot of each event
+		for (uint w = first; w < buf.size(); w++) {
+			if (!(buf[w] & 1))
+				continue; // time stamp or CI answer
+			for (uint s = 0; s < hw_const->ev_perpacket(); s++)
+				if ((field(buf[w], s) >> (hw_const->sg_datawidth() - hw_const->sg_eadrwidth()) &
+				     mmw(hw_const->sg_eadrwidth() - 1)) < 192)
+					pos.push_back(make_pair(w, s));
+		}
+		for (uint j = 1; j + 2 < pos.size(); j++) {
+			uint c0 = clk(buf, pos[j]), c1 = clk(buf, pos[j + 1]), c2 = clk(buf, pos[j + 2]);
+			if (c0 >= 0xf0 && c1 < 0x10) {
+				swap(buf, pos[j], pos[j + 1]);
+				wraps++;
+				j += 2;
+			} else if (j % 64 == 0 && (c0 & 0xf0) == (c2 & 0xf0) && c0 >= 0x40 && c0 < 0xc0) {
+				swap(buf, pos[j], pos[j + 2]);
+				moved++;
+				j += 3;
+			}
+		}
+	}
+
+private:
+	uint64_t field(uint64_t word, uint s)
+	{
+		return (word >> (s * hw_const->sg_ev_evsize() + hw_const->sg_ev_evbase())) &
+		       mmw(hw_const->sg_datawidth());
+	}
+	uint clk(const vector<uint64_t>& buf, pair<uint, uint> p)
+	{
+		return (buf[p.first] >> (p.second * hw_const->sg_ev_evsize() + hw_const->sg_ev_evbase() +
+		                         hw_const->sg_efinewidth())) &
+		       mmw(hw_const->sg_etimewidth());
+	}
+	void swap(vector<uint64_t>& buf, pair<uint, uint> a, pair<uint, uint> b)
+	{
+		uint sa = a.second * hw_const->sg_ev_evsize() + hw_const->sg_ev_evbase(),
+		     sb = b.second * hw_const->sg_ev_evsize() + hw_const->sg_ev_evbase();
+		uint64_t m = mmw(hw_const->sg_datawidth());
+		uint64_t fa = (buf[a.first] >> sa) & m, fb = (buf[b.first] >> sb) & m;
+		buf[a.first] = (buf[a.first] & ~(m << sa)) | (fb << sa);
+		buf[b.first] = (buf[b.first] & ~(m << sb)) | (fa << sb);
+	}
+};
+
+TEST_F(SCEmulator, reorderedRecords)
+{
+	boost::shared_ptr<ReorderEmulator> reorder(new ReorderEmulator());
+	attach(reorder);
+	mem->setReorderWindow(1);
+
+	SpikeTrain st_tx, st_rx;
+	srand(randomseed);
+	uint time_event = 0x200 << 5;
+	for (uint i = 0; i < 2000; i++) {
+		time_event += (2 + rand() % 8) << 4;
+		st_tx.d.push_back(IData::Event(rand() % 192, time_event));
+	}
+	run(st_tx, st_rx);
+	ASSERT_LT(0u, reorder->wraps);
+	ASSERT_LT(0u, reorder->moved);
+
+	// events swapped across a wrap around are decoded at their time, but flagged
+	const ExpStats& stats = mem->getStats();
+	EXPECT_EQ(reorder->wraps, stats.evambiguous);
+	EXPECT_EQ(reorder->wraps, mem->ambiguous(0)->size());
+	// events moved further back than the window are inserted late
+	EXPECT_EQ(reorder->moved, stats.evlate);
+
+	const vector<IData>* ev = emu->ev(0);
+	ASSERT_EQ(ev->size(), st_rx.d.size());
+	for (uint i = 1; i < st_rx.d.size(); i++)
+		ASSERT_LE(st_rx.d[i - 1].time(), st_rx.d[i].time());
+	EXPECT_TRUE(sorted(*ev) == sorted(st_rx.d));
+}
+
+} // namespace spikey2
@@ -0,0 +1,79 @@
+#include "emulatorFixture.h"
+
+static log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("Tst.Lnk");
+
+namespace spikey2
+{
+// bursts of 100 events exceeding the link capacity
+static SpikeTrain bursts()
+{
+	SpikeTrain st;
+	for (uint i = 0; i < 2000; i++)
+		st.d.push_back(IData::Event(i % 192, (0x200 << 5) + (i / 100) * 0x8000 + (i % 100)));
+	return st;
+}
+
+TEST_F(SCEmulator, shiftLate)
+{
+	SpikeTrain st_tx = bursts(), st_rx, st_err;
+
+	mem->Clear();
+	sp->sendSpikeTrain(st_tx, &st_err);
+	execute();
+	sp->recSpikeTrain(st_rx);
+	uint dropped = mem->getStats().evdropped;
+	EXPECT_LT(0u, dropped);
+	EXPECT_EQ(dropped, st_err.d.size());
+	EXPECT_EQ(st_tx.d.size() - dropped, st_rx.d.size());
+
+	vector<uint> shift;
+	mem->Clear();
+	sp->sendSpikeTrain(st_tx, &st_err, true, &shift);
+	execute();
+	sp->recSpikeTrain(st_rx);
+	EXPECT_EQ(0u, mem->getStats().evdropped);
+	EXPECT_EQ(mem->getStats().evshifted, st_err.d.size());
+	EXPECT_LE(dropped, st_err.d.size());
+	EXPECT_EQ(st_tx.d.size(), st_rx.d.size());
+	ASSERT_EQ(st_err.d.size(), shift.size());
+	for (uint i = 0; i < shift.size(); i++)
+		EXPECT_LT(0u, shift[i]);
+	// the default mode is restored
+	EXPECT_FALSE(mem->getSCTRL()->getShiftLate());
+}
+
+TEST_F(SCEmulator, linkAnalysis)
+{
+	SpikeTrain st_tx = bursts(), st_rx, st_err;
+
+	for (uint dropmod = 0; dropmod < 2; dropmod++) {
+		mem->Clear();
+		uint start = mem->getSCTRL()->pbradr();
+		LinkReport r = sp->analyzeSpikeTrain(st_tx, dropmod);
+		// nothing written
+		EXPECT_EQ(start, mem->getSCTRL()->pbradr());
+
+		sp->sendSpikeTrain(st_tx, &st_err, dropmod);
+		const ExpStats& stats = mem->getStats();
+		EXPECT_EQ(st_tx.d.size(), r.events);
+		EXPECT_EQ(stats.evdropped, r.dropped);
+		EXPECT_EQ(stats.evshifted, r.shifted);
+		EXPECT_EQ(st_err.d.size(), r.dropped + r.shifted);
+		EXPECT_LT(0u, r.commands);
+		EXPECT_LT(r.commands, r.words);
+		EXPECT_LT(0u, r.maxpending);
+		EXPECT_EQ(r.maxpending, r.bufpending[r.maxpendingbuf]);
+		EXPECT_LT(r.end, r.minend); // bursts exceed the link capacity
+		uint bufdropped = 0;
+		for (uint b = 0; b < 16; b++)
+			bufdropped += r.bufdropped[b];
+		EXPECT_EQ(r.dropped, bufdropped);
+	}
+
+	// sparse spike train fits
+	LinkReport r = sp->analyzeSpikeTrain(regularTrain(100, 0x1000));
+	EXPECT_EQ(0u, r.dropped);
+	EXPECT_EQ(r.end, r.minend);
+}
+
+} // namespace spikey2
@@ -0,0 +1,58 @@
+#include "emulatorFixture.h"
+
+#include "sc_pbdisasm.h"
+
+static log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("Tst.Dis");
+
+namespace spikey2
+{
+TEST_F(SCEmulator, pbDisasm)
+{
+	SpikeTrain st_tx = regularTrain(500, 100), st_rx;
+
+	std::string file = "/tmp/spikeyhal_test_" + to_str(getpid()) + ".pb";
+	emu->setProgramDump(file);
+	sp->Clear();
+	for (uint c = 0; c < 32; c++)
+		sp->getSC()->write_sram(3, c, c, c == 0 ? 10 : 2);
+	sp->getSC()->close();
+	sp->getSC()->proc_corr(0, 10, true);
+	run(st_tx, st_rx);
+	emu->setProgramDump("");
+
+	vector<uint64_t> prog;
+	uint revision = 0;
+	ASSERT_TRUE(PbDisassembler::load(file, prog, revision));
+	unlink(file.c_str());
+	EXPECT_EQ(bus->hw_const->revision(), revision);
+	EXPECT_EQ(emu->executedWords(), prog.size());
+
+	// same duration and content as executed by the emulator
+	PbDisassembler dis(bus->hw_const);
+	PbProfile p = dis.profile(prog);
+	EXPECT_EQ(emu->executedCycles(), 2 * p.total);
+	EXPECT_EQ(prog.size(), p.numwords);
+	EXPECT_EQ(emu->inputEvents(), p.numevents);
+	EXPECT_EQ(st_tx.d.size(), p.numevents);
+	uint64_t sum = 0, words = 0;
+	for (uint c = 0; c < PbProfile::numcat; c++) {
+		sum += p.cycles[c];
+		words += p.words[c];
+	}
+	EXPECT_EQ(p.total, sum);
+	EXPECT_EQ(p.numwords, words);
+	EXPECT_LT(0u, p.cycles[PbProfile::ci]);
+	EXPECT_LT(0u, p.cycles[PbProfile::stdp]);
+	EXPECT_LT(0u, p.cycles[PbProfile::syncs]);
+	EXPECT_LE(32u + 2, p.numciwrites);
+	EXPECT_LT(0u, p.cicycles["synram"]);
+
+	std::ostringstream o;
+	dis.print(prog, o);
+	std::string listing = o.str();
+	EXPECT_NE(std::string::npos, listing.find("sync"));
+	EXPECT_NE(std::string::npos, listing.find("(stdp)"));
+	EXPECT_EQ(prog.size(), (size_t)std::count(listing.begin(), listing.end(), '\n'));
+}
+
+} // namespace spikey2
@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include "common.h"
+
+#include "idata.h"
+#include "sncomm.h"
+#include "sc_sctrl.h"
+#include "sc_emulator.h"
+#include "sc_pbmem.h"
+
+#include "ctrlif.h"
+#include "spikenet.h"
+
+#include "pram_control.h"
+#include "synapse_control.h"
+#include "spikeyconfig.h"
+#include "spikey.h"
+#include "spikeyscheduler.h"
+
+static log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("Tst.Sch");
+
+namespace spikey2
+{
+TEST(SpikeyScheduler, run)
+{
+	SpikeyScheduler sched;
+	sched.setCooldown(1);
+	vector<boost::shared_ptr<SC_Emulator> > emus;
+	for (uint i = 0; i < 3; i++) {
+		emus.push_back(boost::shared_ptr<SC_Emulator>(new SC_Emulator()));
+		boost::shared_ptr<SpikenetComm> bus(new SC_Mem(emus[i]));
+		sched.addStation(boost::shared_ptr<Spikey>(new Spikey(bus)), "emu" + to_str(i));
+	}
+	// too hot, must not take any job
+	emus[2]->setTemp(80.0);
+
+	vector<boost::shared_ptr<SpikeyJob> > jobs;
+	for (uint j = 0; j < 20; j++) {
+		SpikeTrain st;
+		for (uint i = 0; i < 100 + j; i++)
+			st.d.push_back(IData::Event(i % 192, (0x200 << 5) + i * 100));
+		jobs.push_back(
+		    boost::shared_ptr<SpikeyJob>(new SpikeyJob(boost::shared_ptr<SpikeyConfig>(), st)));
+	}
+
+	EXPECT_EQ(0u, sched.run(jobs));
+	for (uint j = 0; j < jobs.size(); j++) {
+		EXPECT_TRUE(jobs[j]->done);
+		EXPECT_EQ(jobs[j]->in.d.size(), jobs[j]->out.d.size());
+		EXPECT_NE("emu2", jobs[j]->station);
+	}
+	EXPECT_EQ(jobs.size(), sched.jobsDone(0) + sched.jobsDone(1));
+	EXPECT_EQ(0u, sched.jobsDone(2));
+}
+
+// jobs fail instead of waiting forever if all stations stay too hot
+TEST(SpikeyScheduler, tooHot)
+{
+	SpikeyScheduler sched;
+	sched.setCooldown(1);
+	sched.setMaxWait(20);
+	boost::shared_ptr<SC_Emulator> emu(new SC_Emulator());
+	boost::shared_ptr<SpikenetComm> bus(new SC_Mem(emu));
+	sched.addStation(boost::shared_ptr<Spikey>(new Spikey(bus)), "emu");
+	emu->setTemp(80.0);
+
+	vector<boost::shared_ptr<SpikeyJob> > jobs;
+	for (uint j = 0; j < 3; j++)
+		jobs.push_back(boost::shared_ptr<SpikeyJob>(new SpikeyJob()));
+	EXPECT_EQ(jobs.size(), sched.run(jobs));
+	for (uint j = 0; j < jobs.size(); j++) {
+		EXPECT_FALSE(jobs[j]->done);
+		EXPECT_FALSE(jobs[j]->error.empty());
+	}
+	EXPECT_EQ(0u, sched.jobsDone(0));
+}
+
+} // namespace spikey2
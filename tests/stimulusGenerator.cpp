@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+
+#include "common.h"
+
+#include "idata.h"
+#include "spikeyconfig.h"
+#include "stimulus.h"
+
+#include <algorithm>
+
+static log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("Tst.Stm");
+
+namespace spikey2
+{
+TEST(StimulusGenerator, poisson)
+{
+	// 256 drivers at 10Hz for one minute biological time (speedup 10^4)
+	vector<uint> addr;
+	vector<double> rate;
+	for (uint i = 0; i < 256; i++) {
+		addr.push_back(i);
+		rate.push_back(1e5);
+	}
+	StimulusGenerator gen(42);
+	uint duration = 6e-3 / gen.getTimeunit();
+	SpikeTrain st;
+	gen.poisson(addr, rate, 100, duration, st, 2e-6);
+
+	// sorted, inside interval and rate within 2%
+	for (uint i = 1; i < st.d.size(); i++)
+		ASSERT_LE(st.d[i - 1].time(), st.d[i].time());
+	ASSERT_GE(st.d.front().time(), 100u);
+	ASSERT_LT(st.d.back().time(), 100 + duration);
+	EXPECT_NEAR(st.d.size(), 256 * 600, 256 * 600 * 0.02);
+
+	// a source does not depend on the others
+	SpikeTrain single;
+	gen.poisson(vector<uint>(1, 7), vector<double>(1, 1e5), 100, duration, single, 2e-6);
+	vector<uint> t7;
+	for (uint i = 0; i < st.d.size(); i++)
+		if (st.d[i].neuronAdr() == 7)
+			t7.push_back(st.d[i].time());
+	ASSERT_EQ(single.d.size(), t7.size());
+	for (uint i = 0; i < t7.size(); i++)
+		EXPECT_EQ(single.d[i].time(), t7[i]);
+	// dead time respected
+	uint tref = 2e-6 / gen.getTimeunit();
+	for (uint i = 1; i < t7.size(); i++)
+		EXPECT_GE(t7[i] - t7[i - 1], tref - 1);
+
+	// rate steps from 0 to 2e5 Hz, merged into the existing train
+	SpikeTrain mod = single;
+	vector<vector<double> > profile(1, vector<double>());
+	profile[0].push_back(0);
+	profile[0].push_back(2e5);
+	gen.inhomogeneous(vector<uint>(1, 200), profile, 100, duration / 2, mod);
+	uint n = 0;
+	for (uint i = 0; i < mod.d.size(); i++) {
+		if (i) {
+			ASSERT_LE(mod.d[i - 1].time(), mod.d[i].time());
+		}
+		if (mod.d[i].neuronAdr() == 200) {
+			EXPECT_GE(mod.d[i].time(), 100 + duration / 2);
+			n++;
+		}
+	}
+	EXPECT_NEAR(n, 600, 100);
+}
+
+TEST(SpikeMerger, merge)
+{
+	// per-source streams, merged in parallel and compared to sorting the concatenation
+	vector<vector<IData> > streams(300);
+	vector<IData> all;
+	srand(randomseed);
+	for (uint i = 0; i < streams.size(); i++) {
+		uint t = rand() % 100;
+		for (uint j = 0; j < 1000; j++) {
+			t += rand() % 2000;
+			IData e;
+			e.setEvent(i % 256, t);
+			streams[i].push_back(e);
+			all.push_back(e);
+		}
+	}
+	std::stable_sort(all.begin(), all.end(), [](const IData& a, const IData& b) {
+		return a.time() < b.time() || (a.time() == b.time() && a.neuronAdr() < b.neuronAdr());
+	});
+	SpikeTrain st;
+	SpikeMerger(256, false, 4).merge(streams, st);
+	ASSERT_EQ(all.size(), st.d.size());
+	for (uint i = 0; i < all.size(); i++) {
+		ASSERT_EQ(all[i].time(), st.d[i].time());
+		ASSERT_EQ(all[i].neuronAdr(), st.d[i].neuronAdr());
+	}
+
+	// reduced resolution masks the two lowest bits
+	SpikeMerger(256, true, 3).merge(streams, st);
+	ASSERT_EQ(all.size(), st.d.size());
+	for (uint i = 0; i < st.d.size(); i++) {
+		ASSERT_EQ(0u, st.d[i].time() & 3);
+		if (i) {
+			ASSERT_LE(st.d[i - 1].time(), st.d[i].time());
+		}
+	}
+
+	// ranges of streams owned by the caller, here the second half of each stream
+	vector<const IData*> begin, end;
+	vector<IData> half;
+	for (uint i = 0; i < streams.size(); i++) {
+		begin.push_back(streams[i].data() + 500);
+		end.push_back(streams[i].data() + streams[i].size());
+		half.insert(half.end(), begin.back(), end.back());
+	}
+	std::stable_sort(half.begin(), half.end(), [](const IData& a, const IData& b) {
+		return a.time() < b.time() || (a.time() == b.time() && a.neuronAdr() < b.neuronAdr());
+	});
+	SpikeMerger(256, false, 2).merge(begin, end, st);
+	ASSERT_EQ(half.size(), st.d.size());
+	for (uint i = 0; i < half.size(); i++) {
+		ASSERT_EQ(half[i].time(), st.d[i].time());
+		ASSERT_EQ(half[i].neuronAdr(), st.d[i].neuronAdr());
+	}
+
+	// address range and order are checked
+	EXPECT_THROW(SpikeMerger(128).merge(streams, st), std::runtime_error);
+	streams[5][511].setTime() = 0;
+	EXPECT_THROW(SpikeMerger().merge(begin, end, st), std::runtime_error);
+	EXPECT_THROW(SpikeMerger().merge(streams, st), std::runtime_error);
+}
+
+// many streams shorter than the sampling stride of the slice split
+TEST(SpikeMerger, shortStreams)
+{
+	vector<vector<IData> > streams(512);
+	vector<IData> all;
+	srand(randomseed);
+	for (uint i = 0; i < streams.size(); i++) {
+		uint t = 0;
+		for (uint j = 0; j < 400; j++) {
+			t += rand() % 5000;
+			IData e;
+			e.setEvent(i % 256, t);
+			streams[i].push_back(e);
+			all.push_back(e);
+		}
+	}
+	std::stable_sort(all.begin(), all.end(), [](const IData& a, const IData& b) {
+		return a.time() < b.time() || (a.time() == b.time() && a.neuronAdr() < b.neuronAdr());
+	});
+	for (uint threads = 0; threads < 3; threads++) {
+		SpikeTrain st;
+		SpikeMerger(256, false, threads).merge(streams, st);
+		ASSERT_EQ(all.size(), st.d.size());
+		for (uint i = 0; i < all.size(); i++) {
+			ASSERT_EQ(all[i].time(), st.d[i].time());
+			ASSERT_EQ(all[i].neuronAdr(), st.d[i].neuronAdr());
+		}
+	}
+}
+
+} // namespace spikey2
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include "common.h"
+
+#include "idata.h"
+#include "sncomm.h"
+#include "sc_sctrl.h"
+#include "sc_emulator.h"
+#include "sc_trace.h"
+#include "sc_pbmem.h"
+
+#include "ctrlif.h"
+#include "spikenet.h"
+
+#include "pram_control.h"
+#include "synapse_control.h"
+#include "spikeyconfig.h"
+#include "spikey.h"
+
+static log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("Tst.Trc");
+
+namespace spikey2
+{
+// configures the chip and runs a spike train, returns the received events
+static void runSession(boost::shared_ptr<SC_SlowCtrl> sc, const SpikeTrain& in, SpikeTrain& out)
+{
+	boost::shared_ptr<SC_Mem> mem(new SC_Mem(sc));
+	boost::shared_ptr<SpikenetComm> bus(mem);
+	boost::shared_ptr<Spikey> sp(new Spikey(bus));
+	boost::shared_ptr<SpikeyConfig> cfg(new SpikeyConfig(bus->hw_const, SpikeyConfig::ud_param));
+	cfg->setValid(SpikeyConfig::ud_weight | SpikeyConfig::ud_config | SpikeyConfig::ud_dac, true);
+	for (uint i = 0; i < cfg->weight.size(); i += 11)
+		cfg->weight[i] = i % 16;
+	// the parameter DAC values depend on irefdac
+	cfg->irefdac = 25;
+	cfg->vcasdac = cfg->vm = cfg->vrest = cfg->vstart = 0;
+	sp->config(cfg);
+	mem->Clear();
+	sp->sendSpikeTrain(in);
+	sp->Flush();
+	sp->Run();
+	sp->waitPbFinished();
+	sp->recSpikeTrain(out);
+}
+
+TEST(SCTrace, replay)
+{
+	std::string tracefile = "/tmp/spikeyhal_test_trace_" + to_str(getpid());
+	SpikeTrain in, rec, replayed;
+	for (uint i = 0; i < 500; i++)
+		in.d.push_back(IData::Event(i % 192, (0x200 << 5) + i * 100));
+
+	boost::shared_ptr<SC_TraceRecorder> recorder(
+	    new SC_TraceRecorder(boost::shared_ptr<SC_SlowCtrl>(new SC_Emulator()), tracefile));
+	runSession(recorder, in, rec);
+	EXPECT_EQ(in.d.size(), rec.d.size());
+	uint64_t numrecords = recorder->numRecords();
+	EXPECT_LT(0u, numrecords);
+	recorder.reset();
+
+	vector<TraceRecord> trace;
+	uint revision;
+	ASSERT_TRUE(SC_TraceReplay::load(tracefile, trace, revision));
+	EXPECT_EQ(numrecords, trace.size());
+	EXPECT_EQ(5u, revision);
+
+	// same host code without a board: identical results, all records served
+	boost::shared_ptr<SC_TraceReplay> replay(new SC_TraceReplay(tracefile));
+	runSession(replay, in, replayed);
+	ASSERT_EQ(rec.d.size(), replayed.d.size());
+	for (uint i = 0; i < rec.d.size(); i++) {
+		EXPECT_EQ(rec.d[i].time(), replayed.d[i].time());
+		EXPECT_EQ(rec.d[i].neuronAdr(), replayed.d[i].neuronAdr());
+	}
+	EXPECT_EQ(0u, replay->remaining());
+
+	// different playback memory content is detected
+	in.d[10].setNeuronAdr() = 100;
+	replay.reset(new SC_TraceReplay(tracefile));
+	EXPECT_THROW(runSession(replay, in, replayed), std::runtime_error);
+
+	// diverging register writes are detected unless verification is disabled
+	recorder.reset(
+	    new SC_TraceRecorder(boost::shared_ptr<SC_SlowCtrl>(new SC_Emulator()), tracefile));
+	recorder->writeDelcfg(0x5);
+	recorder->writeDelcfg(0x5);
+	recorder.reset();
+	replay.reset(new SC_TraceReplay(tracefile));
+	EXPECT_THROW(replay->writeDelcfg(0x6), std::runtime_error);
+	replay->setVerifyWrites(false);
+	EXPECT_NO_THROW(replay->writeDelcfg(0x6));
+
+	EXPECT_THROW(SC_TraceReplay("/tmp/spikeyhal_test_notrace"), std::runtime_error);
+	remove(tracefile.c_str());
+}
+
+} // namespace spikey2
@@ -0,0 +1,195 @@
+#include "emulatorFixture.h"
+
+static log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("Tst.Trl");
+
+namespace spikey2
+{
+TEST_F(SCEmulator, trialBatch)
+{
+	vector<SpikeyTrial> trials;
+	for (uint t = 0; t < 5; t++) {
+		SpikeTrain st;
+		for (uint i = 0; i < 50 + 20 * t; i++)
+			st.d.push_back(IData::Event((i + t) % 192, (0x200 << 5) + i * 200));
+		trials.push_back(SpikeyTrial(st));
+	}
+	// configuration change between trials
+	trials[2].cfg.reset(new SpikeyConfig(bus->hw_const, SpikeyConfig::ud_chip));
+
+	// reference: one playback memory program per trial
+	vector<SpikeTrain> single(trials.size());
+	for (uint t = 0; t < trials.size(); t++) {
+		mem->Clear();
+		run(trials[t].in, single[t]);
+	}
+
+	mem->Clear();
+	EXPECT_EQ(MemObj::ok, sp->runTrials(trials)._state);
+	for (uint t = 0; t < trials.size(); t++) {
+		ASSERT_EQ(trials[t].in.d.size(), trials[t].out.d.size());
+		EXPECT_TRUE(trials[t].dropped.d.empty());
+		// times relative to the start of each trial
+		EXPECT_TRUE(sorted(trials[t].out.d) == sorted(single[t].d));
+	}
+
+	// DACs are not written via the playback memory
+	trials[1].cfg.reset(new SpikeyConfig(bus->hw_const, SpikeyConfig::ud_dac));
+	mem->Clear();
+	EXPECT_THROW(sp->runTrials(trials), std::runtime_error);
+}
+
+TEST_F(SCEmulator, repeated)
+{
+	SpikeTrain st_tx = regularTrain(400, 300), st_rx;
+
+	// reference: single presentation
+	mem->Clear();
+	run(st_tx, st_rx);
+	uint64_t pbwords = mem->getStats().pbwords;
+	vector<pair<uint, uint> > ref = sorted(st_rx.d);
+
+	const uint n = 7;
+	vector<SpikeTrain> out;
+	mem->Clear();
+	sp->runRepeated(st_tx, n, out);
+	ASSERT_EQ(n, out.size());
+	for (uint r = 0; r < n; r++)
+		EXPECT_TRUE(sorted(out[r].d) == ref) << "repetition " << r;
+	// program transferred only once
+	EXPECT_EQ(pbwords, mem->getStats().pbwords);
+	EXPECT_EQ(n * st_tx.d.size(), mem->getStats().evdecoded);
+
+	// no repetitions, or more than fit into the record memory
+	mem->Clear();
+	sp->sendSpikeTrain(st_tx);
+	sp->Flush();
+	EXPECT_THROW(mem->runRepeated(0), std::runtime_error);
+	EXPECT_THROW(mem->runRepeated(1 << 20), std::runtime_error);
+	mem->waitIdle();
+
+	// the playback memory is usable as usual afterwards
+	mem->Clear();
+	run(st_tx, st_rx);
+	EXPECT_EQ(st_tx.d.size(), st_rx.d.size());
+}
+
+// stimulus of each segment is a shifted copy of the same train, the received events are kept
+class TestStream : public SpikeyStream
+{
+public:
+	SpikeTrain st;
+	uint num;
+	vector<uint> order;
+	vector<vector<pair<uint, uint> > > out;
+
+	TestStream(const SpikeTrain& st, uint num) : st(st), num(num){};
+	virtual bool next(uint i, SpikeTrain& s)
+	{
+		if (i >= num)
+			return false;
+		s.d = st.d;
+		for (uint e = 0; e < s.d.size(); e++)
+			s.d[e].setTime() += 16 * i;
+		return true;
+	}
+	virtual void received(uint i, SpikeTrain& s)
+	{
+		order.push_back(i);
+		vector<pair<uint, uint> > ev;
+		for (uint e = 0; e < s.d.size(); e++)
+			ev.push_back(make_pair(s.d[e].time() - 16 * i, s.d[e].neuronAdr()));
+		sort(ev.begin(), ev.end());
+		out.push_back(ev);
+	}
+};
+
+TEST_F(SCEmulator, streaming)
+{
+	SpikeTrain st_tx = regularTrain(400, 300), st_rx;
+
+	// reference: single experiment
+	mem->Clear();
+	run(st_tx, st_rx);
+	uint64_t pbwords = mem->getStats().pbwords;
+	vector<pair<uint, uint> > ref = sorted(st_rx.d);
+	ASSERT_EQ(st_tx.d.size(), ref.size());
+
+	const uint n = 5, half = 1 << 12;
+	TestStream stream(st_tx, n);
+	EXPECT_EQ(n, sp->runStream(stream, half, half));
+	ASSERT_EQ(n, stream.out.size());
+	for (uint i = 0; i < n; i++) {
+		EXPECT_EQ(i, stream.order[i]);
+		EXPECT_TRUE(stream.out[i] == ref) << "segment " << i;
+	}
+	EXPECT_FALSE(mem->isStreaming());
+	EXPECT_EQ(n * st_tx.d.size(), mem->getStats().evdecoded);
+	// segments after the first do not reset the neurons
+	EXPECT_GT(n * pbwords, mem->getStats().pbwords);
+
+	// a program exceeding its half of the playback memory is rejected before it is uploaded
+	TestStream toolong(st_tx, 2);
+	EXPECT_THROW(sp->runStream(toolong, 64, half), std::runtime_error);
+	EXPECT_FALSE(mem->isStreaming());
+
+	// the playback memory is usable as usual afterwards
+	mem->Clear();
+	run(st_tx, st_rx);
+	EXPECT_EQ(st_tx.d.size(), st_rx.d.size());
+}
+
+// reacts to the events of each segment, counts them when the next stimulus is requested
+class TestLoop : public TestStream
+{
+public:
+	vector<uint> calls, counts;
+
+	TestLoop(const SpikeTrain& st, uint num) : TestStream(st, num), calls(num), counts(num){};
+	virtual bool next(uint i, SpikeTrain& s)
+	{
+		if (i > 0) {
+			EXPECT_EQ(i, out.size()); // segment i - 1 complete
+		}
+		return TestStream::next(i, s);
+	}
+	virtual void received(uint i, SpikeTrain& s)
+	{
+		calls[i]++;
+		counts[i] += s.d.size();
+		if (out.size() <= i)
+			out.resize(i + 1);
+		for (uint e = 0; e < s.d.size(); e++)
+			out[i].push_back(make_pair(s.d[e].time() - 16 * i, s.d[e].neuronAdr()));
+		sort(out[i].begin(), out[i].end());
+	}
+};
+
+TEST_F(SCEmulator, closedLoop)
+{
+	// about 2ms per segment
+	SpikeTrain st_tx = regularTrain(200, 64000), st_rx;
+
+	mem->Clear();
+	run(st_tx, st_rx);
+	vector<pair<uint, uint> > ref = sorted(st_rx.d);
+
+	const uint n = 4;
+	emu->setRealtime(true);
+	TestLoop loop(st_tx, n);
+	EXPECT_EQ(n, sp->runClosedLoop(loop, 100, 1 << 12, 1 << 12));
+	ASSERT_EQ(n, loop.out.size());
+	for (uint i = 0; i < n; i++) {
+		EXPECT_LE(1u, loop.calls[i]);
+		EXPECT_EQ(st_tx.d.size(), loop.counts[i]);
+		EXPECT_TRUE(loop.out[i] == ref) << "segment " << i;
+	}
+
+	const ExpStats& stats = mem->getStats();
+	EXPECT_EQ(n - 1, stats.restarts);
+	EXPECT_LE(stats.gapmax, stats.gap);
+	EXPECT_LT(stats.gapmax, stats.reactmax);
+	EXPECT_LT(n, stats.polls); // polled while the segments were running
+	EXPECT_FALSE(mem->isStreaming());
+}
+
+} // namespace spikey2
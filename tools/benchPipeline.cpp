@@ -0,0 +1,358 @@
+#include "common.h"
+
+#include "idata.h"
+#include "sncomm.h"
+#include "sc_sctrl.h"
+#include "sc_emulator.h"
+#include "sc_pbmem.h"
+
+#include "ctrlif.h"
+#include "spikenet.h"
+
+#include "pram_control.h"
+#include "synapse_control.h"
+#include "spikeyconfig.h"
+#include "spikey.h"
+#include "stimulus.h"
+
+#include <cmath>
+
+static log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("Tool.BenchPipeline");
+
+using namespace spikey2;
+uint randomseed = 42;
+
+// IData time unit in seconds (200MHz clock cycles with 16 time bins), as the emulator
+static const double timeunit = StimulusGenerator::defaultTimeunit;
+// start of spike trains, see tests/eventLoop.cpp
+static const uint starttime = 0x200 << 5;
+
+// swept input rates in Hz and spike train lengths in seconds (hardware time)
+static const double rates[] = {1e5, 1e6, 1e7};
+static const double lengths[] = {1e-3, 1e-2};
+
+struct Result
+{
+	string stage;
+	double rate, length;
+	uint64_t events, bytes;
+	double seconds;
+};
+
+static string key(const string& stage, double rate, double length)
+{
+	std::ostringstream s;
+	s << stage << "/" << rate << "/" << length;
+	return s.str();
+}
+
+// keep fastest of several repetitions
+static void add(map<string, Result>& res, const Result& r)
+{
+	string k = key(r.stage, r.rate, r.length);
+	if (res.find(k) == res.end() || r.seconds < res[k].seconds)
+		res[k] = r;
+}
+
+// Poisson spike train on all input synapses
+static void genTrain(SpikeTrain& st, double rate, double length, uint seed)
+{
+	srand(seed);
+	st.d.clear();
+	double t = starttime, mean = 1.0 / (rate * timeunit), end = starttime + length / timeunit;
+	while (true) {
+		t += -log(1.0 - rand() / (RAND_MAX + 1.0)) * mean;
+		if (t >= end)
+			break;
+		uint neuron_index = rand() % 192 + (rand() % 2 * 256);
+		st.d.push_back(IData::Event(neuron_index, (uint)t));
+	}
+}
+
+// reads value of "name" from a single line JSON object as written below
+static bool field(const string& line, const string& name, string& val)
+{
+	size_t p = line.find("\"" + name + "\": ");
+	if (p == string::npos)
+		return false;
+	p += name.size() + 4;
+	size_t e = line.find_first_of(",}", p);
+	val = line.substr(p, e - p);
+	if (val.size() >= 2 && val[0] == '"')
+		val = val.substr(1, val.size() - 2);
+	return true;
+}
+
+// tolerances of the regression gate, stored in the baseline file
+struct Tolerance
+{
+	double relative; // a stage fails if it takes longer than baseline * (1 + relative)
+	double minseconds; // baselines below are raised to minseconds: timer and scheduler noise
+	map<string, double> stage; // relative tolerance of single results, e.g. file system bound
+};
+
+static bool readBaseline(const string& filename, string& backend, Tolerance& tol,
+                         map<string, double>& seconds)
+{
+	ifstream in(filename.c_str());
+	if (!in.good())
+		return false;
+	string line, stage, rate, length, sec, val;
+	while (getline(in, line)) {
+		if (!field(line, "stage", stage)) {
+			if (field(line, "backend", val))
+				backend = val;
+			if (field(line, "tolerance", val))
+				tol.relative = atof(val.c_str());
+			if (field(line, "minseconds", val))
+				tol.minseconds = atof(val.c_str());
+			continue;
+		}
+		if (!field(line, "rate", rate) || !field(line, "length", length) ||
+		    !field(line, "seconds", sec))
+			continue;
+		string k = key(stage, atof(rate.c_str()), atof(length.c_str()));
+		seconds[k] = atof(sec.c_str());
+		if (field(line, "tolerance", val))
+			tol.stage[k] = atof(val.c_str());
+	}
+	return true;
+}
+
+static void writeJson(ostream& o, const string& backend, const Tolerance& tol,
+                      const vector<Result>& res)
+{
+	o << "{\n  \"backend\": \"" << backend << "\",\n  \"tolerance\": " << tol.relative
+	  << ",\n  \"minseconds\": " << tol.minseconds << ",\n  \"results\": [\n";
+	for (uint i = 0; i < res.size(); i++) {
+		const Result& r = res[i];
+		double s = r.seconds > 0 ? r.seconds : 1e-9;
+		o << "    {\"stage\": \"" << r.stage << "\", \"rate\": " << r.rate
+		  << ", \"length\": " << r.length << ", \"events\": " << r.events
+		  << ", \"bytes\": " << r.bytes << ", \"seconds\": " << r.seconds
+		  << ", \"events_per_s\": " << r.events / s << ", \"bytes_per_s\": " << r.bytes / s;
+		map<string, double>::const_iterator t = tol.stage.find(key(r.stage, r.rate, r.length));
+		if (t != tol.stage.end())
+			o << ", \"tolerance\": " << t->second;
+		o << "}" << (i + 1 < res.size() ? "," : "") << "\n";
+	}
+	o << "  ]\n}\n";
+}
+
+static uint64_t fileSize(const string& filename)
+{
+	ifstream f(filename.c_str(), ios::binary | ios::ate);
+	return f.good() ? (uint64_t)f.tellg() : 0;
+}
+
+int main(int argc, char* argv[])
+{
+	/*
+	 * Throughput benchmark of the experiment pipeline.
+	 * Times the encoding of spike trains into playback memory commands, their transfer,
+	 * the chip configuration, the readback and decoding of received events and spike train file
+	 * I/O for a sweep of input rates and spike train lengths.
+	 * Runs against SC_Emulator by default, use --hw to benchmark the hardware.
+	 * Results are written as JSON and compared to a baseline file written by a previous run:
+	 * the exit code is 1 if any stage took longer than max(baseline, minseconds) * (1 + tolerance).
+	 * The tolerances are taken from the baseline file, a result may carry its own tolerance.
+	 * -t and -m override the global ones, results written with -b keep the ones of the baseline.
+	 *
+	 * tools/benchPipeline_baseline.json is the reference of the emulator backend, checked by the
+	 * build if tests are enabled (see wscript). It was recorded with the default -O0 build flags;
+	 * its tolerance of 1.0 (twice the baseline time) and minseconds of 1ms allow for different
+	 * build hosts and load, only gross regressions fail. writeToFile is file system bound and
+	 * has a tolerance of 4. If a change is expected to cost time or the reference host changes,
+	 * record a new one in the source directory with
+	 *   benchPipeline -n 5 -b tools/benchPipeline_baseline.json \
+	 *                 -o tools/benchPipeline_baseline.json
+	 *
+	 * usage: benchPipeline [-o out.json] [-b baseline.json] [-t tolerance] [-m minseconds]
+	 *                      [-n repetitions] [-c spikeyconfig] [--hw]
+	 */
+
+	string outname, basename, cfgname = "tests/networks/spikeyconfig_decorrnetwork.out";
+	Tolerance tol = {0.2, 0, map<string, double>()};
+	double cmdtol = -1, cmdmin = -1;
+	uint reps = 3;
+	bool hw = false;
+	for (int i = 1; i < argc; i++) {
+		string arg(argv[i]);
+		if (arg == "--hw")
+			hw = true;
+		else if (i + 1 < argc && arg == "-o")
+			outname = argv[++i];
+		else if (i + 1 < argc && arg == "-b")
+			basename = argv[++i];
+		else if (i + 1 < argc && arg == "-t")
+			cmdtol = atof(argv[++i]);
+		else if (i + 1 < argc && arg == "-m")
+			cmdmin = atof(argv[++i]);
+		else if (i + 1 < argc && arg == "-n")
+			reps = max(1, atoi(argv[++i]));
+		else if (i + 1 < argc && arg == "-c")
+			cfgname = argv[++i];
+		else {
+			cerr << "usage: " << argv[0] << " [-o out.json] [-b baseline.json] [-t tolerance]"
+			     << " [-m minseconds] [-n repetitions] [-c spikeyconfig] [--hw]" << endl;
+			return 2;
+		}
+	}
+
+	boost::shared_ptr<SC_Mem> mem;
+	if (hw)
+		mem = boost::shared_ptr<SC_Mem>(new SC_Mem());
+	else
+		mem = boost::shared_ptr<SC_Mem>(
+		    new SC_Mem(boost::shared_ptr<SC_SlowCtrl>(new SC_Emulator())));
+	boost::shared_ptr<SpikenetComm> bus(mem);
+	boost::shared_ptr<Spikenet> chip(new Spikenet(bus, 0));
+	boost::shared_ptr<Spikey> sp(new Spikey(chip));
+	boost::shared_ptr<SC_SlowCtrl> sc = mem->getSCTRL();
+
+	map<string, Result> res;
+	double t;
+
+	// chip configuration with and without synapse weights
+	boost::shared_ptr<SpikeyConfig> cfg(new SpikeyConfig(bus->hw_const));
+	if (cfg->readParam(cfgname)) {
+		for (uint r = 0; r < reps; r++) {
+			for (uint w = 0; w < 2; w++) {
+				cfg->setValid(SpikeyConfig::ud_all, true);
+				if (w)
+					cfg->setValid(SpikeyConfig::ud_weight, false);
+				mem->Clear();
+				sp->invalidateState(); // otherwise the unchanged config is not written again
+				uint adr = sc->pbradr();
+				t = monotonicTime();
+				sp->config(cfg);
+				Result c = {w ? "configNoWeights" : "config", 0, 0, 0,
+				            (uint64_t)(sc->pbradr() - adr) * sizeof(uint64_t), monotonicTime() - t};
+				add(res, c);
+			}
+		}
+	} else
+		LOG4CXX_WARN(logger, "cannot read " << cfgname << ", skipping configuration benchmark");
+
+	string stfile = "benchPipeline_spiketrain.tmp";
+	for (uint ri = 0; ri < sizeof(rates) / sizeof(rates[0]); ri++) {
+		for (uint li = 0; li < sizeof(lengths) / sizeof(lengths[0]); li++) {
+			double rate = rates[ri], length = lengths[li];
+			SpikeTrain st_tx;
+			genTrain(st_tx, rate, length, randomseed + ri * 100 + li);
+			uint64_t num = st_tx.d.size();
+			LOG4CXX_INFO(logger, "rate " << rate << "Hz, length " << length << "s: " << num
+			                             << " events");
+
+			for (uint r = 0; r < reps; r++) {
+				// encoding only, independent of backend
+				{
+					SC_Emulator enc;
+					vector<IData> in(st_tx.d);
+					uint stime = 0;
+					t = monotonicTime();
+					enc.pbEvt(in, stime, 0, 0);
+					Result e = {"pbEvt", rate, length, num,
+					            (uint64_t)enc.pbradr() * sizeof(uint64_t), monotonicTime() - t};
+					add(res, e);
+				}
+
+				// full experiment
+				mem->Clear();
+				SpikeTrain st_rx;
+				uint start = sc->pbradr();
+				t = monotonicTime();
+				sp->sendSpikeTrain(st_tx);
+				Result s = {"sendSpikeTrain", rate, length, num,
+				            (uint64_t)(sc->pbradr() - start) * sizeof(uint64_t),
+				            monotonicTime() - t};
+				add(res, s);
+
+				t = monotonicTime();
+				sp->Flush();
+				Result f = {"setupSend", rate, length, num,
+				            (uint64_t)(sc->pbradr() - start) * sizeof(uint64_t),
+				            monotonicTime() - t};
+				add(res, f);
+
+				uint wadr = 0;
+				sc->getWadr(wadr);
+				t = monotonicTime();
+				sp->Run();
+				sp->waitPbFinished();
+				Result x = {"run", rate, length, num,
+				            (uint64_t)(sc->curwadr() - wadr) * sizeof(uint64_t),
+				            monotonicTime() - t};
+				add(res, x);
+
+				t = monotonicTime();
+				sp->recSpikeTrain(st_rx);
+				Result d = {"receive", rate, length, st_rx.d.size(), x.bytes, monotonicTime() - t};
+				add(res, d);
+
+				// file I/O
+				t = monotonicTime();
+				st_rx.writeToFile(stfile);
+				Result fw = {"writeToFile", rate, length, st_rx.d.size(), fileSize(stfile),
+				             monotonicTime() - t};
+				add(res, fw);
+
+				SpikeTrain st_file;
+				t = monotonicTime();
+				st_file.readFromFile(stfile);
+				Result fr = {"readFromFile", rate, length, st_file.d.size(), fw.bytes,
+				             monotonicTime() - t};
+				add(res, fr);
+			}
+		}
+	}
+	remove(stfile.c_str());
+
+	vector<Result> results;
+	for (map<string, Result>::iterator it = res.begin(); it != res.end(); ++it)
+		results.push_back(it->second);
+
+	string backend = hw ? "hardware" : "emulator";
+
+	// regression gate
+	map<string, double> baseline;
+	if (!basename.empty()) {
+		string basebackend;
+		if (!readBaseline(basename, basebackend, tol, baseline)) {
+			LOG4CXX_ERROR(logger, "cannot read baseline " << basename);
+			return 2;
+		}
+		if (basebackend != backend) {
+			LOG4CXX_ERROR(logger, "baseline " << basename << " is of the " << basebackend
+			                                  << " backend, not the " << backend << " backend");
+			return 2;
+		}
+	}
+	if (cmdtol >= 0)
+		tol.relative = cmdtol;
+	if (cmdmin >= 0)
+		tol.minseconds = cmdmin;
+
+	if (outname.empty())
+		writeJson(cout, backend, tol, results);
+	else {
+		ofstream out(outname.c_str());
+		writeJson(out, backend, tol, results);
+	}
+
+	bool failed = false;
+	for (uint i = 0; i < results.size(); i++) {
+		const Result& r = results[i];
+		map<string, double>::iterator b = baseline.find(key(r.stage, r.rate, r.length));
+		if (b == baseline.end())
+			continue;
+		map<string, double>::iterator t = tol.stage.find(b->first);
+		double relative = t != tol.stage.end() ? t->second : tol.relative;
+		if (r.seconds > max(b->second, tol.minseconds) * (1 + relative)) {
+			LOG4CXX_ERROR(logger, "regression in " << b->first << ": " << r.seconds
+			                                       << "s, baseline " << b->second << "s");
+			failed = true;
+		}
+	}
+	return failed ? 1 : 0;
+}
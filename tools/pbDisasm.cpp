@@ -0,0 +1,49 @@
+#include "common.h"
+
+#include "idata.h"
+#include "sncomm.h"
+#include "sc_pbdisasm.h"
+
+static log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("Tool.PbDisasm");
+
+using namespace spikey2;
+uint randomseed = 42;
+
+// disassembles and profiles a playback memory program saved by SC_SlowCtrl::setProgramDump
+int main(int argc, char* argv[])
+{
+	if (argc < 2) {
+		cerr << "usage: " << argv[0] << " program [--profile|--json]" << endl;
+		return 1;
+	}
+	std::string mode = argc > 2 ? argv[2] : "";
+
+	vector<uint64_t> prog;
+	uint revision;
+	if (!PbDisassembler::load(argv[1], prog, revision)) {
+		LOG4CXX_ERROR(logger, "Could not read program file " << argv[1]);
+		return 1;
+	}
+	boost::shared_ptr<HardwareConstants> hw;
+	if (revision == 4)
+		hw = boost::shared_ptr<HardwareConstants>(new HardwareConstantsRev4USB());
+	else if (revision == 5)
+		hw = boost::shared_ptr<HardwareConstants>(new HardwareConstantsRev5USB());
+	else {
+		LOG4CXX_ERROR(logger, "Unsupported chip revision " << revision);
+		return 1;
+	}
+
+	PbDisassembler dis(hw);
+	PbProfile p = dis.profile(prog);
+	if (mode == "--json")
+		cout << p.toJson() << endl;
+	else {
+		if (mode != "--profile") {
+			dis.print(prog, cout);
+			cout << endl;
+		}
+		p.print(cout);
+	}
+	return 0;
+}